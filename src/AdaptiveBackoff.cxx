@@ -0,0 +1,94 @@
+// Copyright CERN and copyright holders of ALICE O2. This software is
+// distributed under the terms of the GNU General Public License v3 (GPL
+// Version 3), copied verbatim in the file "COPYING".
+//
+// See http://alice-o2.web.cern.ch/license for full licensing information.
+//
+// In applying this license CERN does not waive the privileges and immunities
+// granted to it by virtue of its status as an Intergovernmental Organization
+// or submit itself to any jurisdiction.
+
+#include "AdaptiveBackoff.h"
+
+#include <chrono>
+#include <sched.h>
+#include <thread>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define cpuRelax() _mm_pause()
+#else
+#define cpuRelax()
+#endif
+
+// current time, in nanoseconds
+static inline uint64_t getTimeNs() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+AdaptiveBackoff::AdaptiveBackoff(int vSpinTime, int vYieldTime,
+                                 int vMinSleepTime, int vMaxSleepTime) {
+  spinTime = (vSpinTime > 0) ? vSpinTime * 1000ULL : 0;
+  yieldTime = (vYieldTime > 0) ? vYieldTime * 1000ULL : 0;
+  minSleepTime = (vMinSleepTime > 0) ? vMinSleepTime * 1000ULL : 1000;
+  maxSleepTime = (vMaxSleepTime > 0) ? vMaxSleepTime * 1000ULL : 1000;
+  if (maxSleepTime < minSleepTime) {
+    maxSleepTime = minSleepTime;
+  }
+  reset();
+}
+
+void AdaptiveBackoff::reset() {
+  lastActiveTime = getTimeNs();
+  activityInterval = 0;
+  currentSleepTime = minSleepTime;
+}
+
+uint64_t AdaptiveBackoff::getActivityInterval() { return activityInterval; }
+
+void AdaptiveBackoff::setActive() {
+  uint64_t now = getTimeNs();
+  uint64_t interval = now - lastActiveTime;
+  lastActiveTime = now;
+  currentSleepTime = minSleepTime;
+  // exponential moving average, weight 1/8 for the new value
+  if (activityInterval == 0) {
+    activityInterval = interval;
+  } else {
+    activityInterval = activityInterval - activityInterval / 8 + interval / 8;
+  }
+}
+
+uint64_t AdaptiveBackoff::idle(WaitType &waitType) {
+  uint64_t t0 = getTimeNs();
+  uint64_t idleTime = t0 - lastActiveTime;
+
+  // spin, if activity is expected soon
+  if ((idleTime < spinTime) && (activityInterval < spinTime)) {
+    waitType = Spin;
+    const int spinLoops = 64;
+    for (int i = 0; i < spinLoops; i++) {
+      cpuRelax();
+    }
+    return getTimeNs() - t0;
+  }
+
+  // yield, if activity is expected soon
+  if ((idleTime < spinTime + yieldTime) &&
+      (activityInterval < spinTime + yieldTime)) {
+    waitType = Yield;
+    sched_yield();
+    return getTimeNs() - t0;
+  }
+
+  // sleep, for a longer time at each call
+  waitType = Sleep;
+  std::this_thread::sleep_for(std::chrono::nanoseconds(currentSleepTime));
+  currentSleepTime *= 2;
+  if (currentSleepTime > maxSleepTime) {
+    currentSleepTime = maxSleepTime;
+  }
+  return getTimeNs() - t0;
+}
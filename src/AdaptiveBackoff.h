@@ -0,0 +1,64 @@
+// Copyright CERN and copyright holders of ALICE O2. This software is
+// distributed under the terms of the GNU General Public License v3 (GPL
+// Version 3), copied verbatim in the file "COPYING".
+//
+// See http://alice-o2.web.cern.ch/license for full licensing information.
+//
+// In applying this license CERN does not waive the privileges and immunities
+// granted to it by virtue of its status as an Intergovernmental Organization
+// or submit itself to any jurisdiction.
+
+/// \file AdaptiveBackoff.h
+/// \brief Waiting policy for a polling loop, adapted to the rate of activity.
+/// \descr When a poll finds nothing to do, the loop first spins (CPU pause),
+/// then yields the CPU, then sleeps with an exponentially growing period.
+/// Spin and yield phases are used only if the measured interval between
+/// active iterations is short enough for new data to be expected during these
+/// phases, so that an idle loop quickly goes to sleep and uses almost no CPU,
+/// while a loop with frequent activity keeps a low latency.
+
+#ifndef _ADAPTIVEBACKOFF_H
+#define _ADAPTIVEBACKOFF_H
+
+#include <stdint.h>
+
+class AdaptiveBackoff {
+public:
+  // constructor
+  // spinTime: max time (microseconds) spent spinning after last activity
+  // yieldTime: max time (microseconds) spent yielding after spin phase
+  // minSleepTime, maxSleepTime: range of sleep period (microseconds)
+  AdaptiveBackoff(int spinTime, int yieldTime, int minSleepTime,
+                  int maxSleepTime);
+
+  // the different ways of waiting
+  enum WaitType { Spin = 0, Yield = 1, Sleep = 2 };
+
+  // to be called after an iteration which did something
+  // resets the backoff, and updates the activity rate estimate
+  void setActive();
+
+  // to be called after an iteration which did nothing
+  // waits a bit, according to the current phase
+  // returns the time waited (nanoseconds), and how in waitType
+  uint64_t idle(WaitType &waitType);
+
+  // reset state, e.g. before a new run
+  void reset();
+
+  // get estimated average interval between active iterations (nanoseconds)
+  uint64_t getActivityInterval();
+
+private:
+  uint64_t spinTime;     // spin phase duration, in nanoseconds
+  uint64_t yieldTime;    // yield phase duration, in nanoseconds
+  uint64_t minSleepTime; // first sleep period, in nanoseconds
+  uint64_t maxSleepTime; // maximum sleep period, in nanoseconds
+
+  uint64_t lastActiveTime = 0;   // time of last active iteration
+  uint64_t activityInterval = 0; // moving average of interval between active
+                                 // iterations (0 if unknown)
+  uint64_t currentSleepTime = 0; // next sleep period
+};
+
+#endif // #ifndef _ADAPTIVEBACKOFF_H
@@ -10,6 +10,27 @@
 
 #include "Consumer.h"
 
+Consumer::Consumer(ConfigFile &cfg, std::string cfgEntryPoint) {
+  // configuration parameter: | consumer-* | cpuAffinity | string | | Placement
+  // of the threads created by the consumer (e.g. processing threads, TCP
+  // senders, periodic statistics). One of: none (default, not pinned), numa:N
+  // (pinned on the CPUs of NUMA node N), or a list of CPU indexes (e.g.
+  // 0-3,8). Actual placement is logged when the threads start. |
+  std::string cfgCpuAffinity;
+  cfg.getOptionalValue<std::string>(cfgEntryPoint + ".cpuAffinity",
+                                    cfgCpuAffinity);
+  if (threadPlacement.setFromString(cfgCpuAffinity)) {
+    throw "Wrong cpuAffinity " + cfgCpuAffinity + " for " + cfgEntryPoint;
+  }
+  threadPlacementName = cfgEntryPoint;
+}
+
+void Consumer::applyThreadPlacement(const std::string &suffix) {
+  if (threadPlacement.isEnabled()) {
+    threadPlacement.apply(threadPlacementName + suffix);
+  }
+}
+
 int Consumer::pushData(DataSetReference &bc) {
   int success = 0;
   int error = 0;
@@ -17,13 +17,15 @@
 
 #include <memory>
 
+#include "ThreadPlacement.h"
+
 #include <InfoLogger/InfoLogger.hxx>
 using namespace AliceO2::InfoLogger;
 extern InfoLogger theLog;
 
 class Consumer {
 public:
-  Consumer(ConfigFile &, std::string){};
+  Consumer(ConfigFile &cfg, std::string cfgEntryPoint);
   virtual ~Consumer(){};
   virtual int pushData(DataBlockContainerReference &b) = 0;
 
@@ -53,6 +55,15 @@ public:
                    // occuring in the consumer
   bool isErrorReported =
       false; // flag to keep track of error reports for this consumer
+
+protected:
+  ThreadPlacement threadPlacement; // placement of the threads created by
+                                   // this consumer, if any
+  std::string threadPlacementName; // consumer name used in placement logs
+
+  // apply thread placement (if configured) to the calling thread
+  // suffix: appended to consumer name in logs, to identify the thread
+  void applyThreadPlacement(const std::string &suffix = "");
 };
 
 std::unique_ptr<Consumer> getUniqueConsumerStats(ConfigFile &cfg,
@@ -73,3 +84,5 @@ std::unique_ptr<Consumer> getUniqueConsumerTCP(ConfigFile &cfg,
                                                std::string cfgEntryPoint);
 std::unique_ptr<Consumer> getUniqueConsumerRDMA(ConfigFile &cfg,
                                                 std::string cfgEntryPoint);
+std::unique_ptr<Consumer> getUniqueConsumerMemfd(ConfigFile &cfg,
+                                                 std::string cfgEntryPoint);
@@ -9,6 +9,7 @@
 // or submit itself to any jurisdiction.
 
 #include "Consumer.h"
+#include "MemoryPagesPool.h"
 
 #include <dlfcn.h>
 #include <memory>
@@ -45,12 +46,18 @@ public:
   // - fifoSize: size of input and output FIFOs for incoming/output data blocks
   // - idleSleepTime: idle sleep time (in microseconds), when input fifo empty
   // or output fifo full, before retrying.
+  // - placement: placement of the thread (CPU affinity / NUMA node), and name
+  // used in logs.
   //
   // The constructor initialize the member variables and create the processing
   // thread.
   processThread(PtrProcessFunction f, int id, unsigned int fifoSize = 10,
-                unsigned int idleSleepTime = 100) {
+                unsigned int idleSleepTime = 100,
+                ThreadPlacement placement = ThreadPlacement(),
+                std::string placementName = "") {
     shutdown = 0;
+    threadPlacement = placement;
+    threadPlacementName = placementName;
     fProcess = f;
     cfgIdleSleepTime = idleSleepTime;
     threadId = id;
@@ -93,6 +100,9 @@ public:
     // printf("processing thread %d starting\n",threadId);
     // printf("outputfifo=%p\n",outputFifo.get());
     // if (outputFifo==nullptr) return;
+    if (threadPlacement.isEnabled()) {
+      threadPlacement.apply(threadPlacementName);
+    }
     for (; !shutdown;) {
       bool isActive = 0;
       // printf("thread %d loop\n",threadId);
@@ -129,6 +139,8 @@ private:
                                      // fifos empty or full, before retrying
   PtrProcessFunction fProcess = nullptr; // the process function to be used
   int threadId = 0;                      // id of the thread
+  ThreadPlacement threadPlacement;       // placement of the thread
+  std::string threadPlacementName;       // name of the thread, for logs
 };
 
 // A consumer class allowing to call a function from a dynamically loaded
@@ -226,7 +238,8 @@ public:
     theLog.log("Using %d thread(s) for processing", numberOfThreads);
     for (int i = 0; i < numberOfThreads; i++) {
       threadPool.push_back(std::make_unique<processThread>(
-          processBlock, i + 1, cfgFifoSize, cfgIdleSleepTime));
+          processBlock, i + 1, cfgFifoSize, cfgIdleSleepTime, threadPlacement,
+          threadPlacementName + " processing thread " + std::to_string(i + 1)));
     }
 
     // create a FIFO to keep track of incoming page IDs
@@ -318,6 +331,8 @@ public:
       if (threadIndex == numberOfThreads) {
         threadIndex = 0;
       }
+      MemoryPagesPool::setPageStage(b->getData(),
+                                    MemoryPagesPool::StageProcessor);
       //      if (threadPool[threadIndex]->inputFifo->isFull()) {continue;
       //      if (debug) {printf("pushing %p to thread
       //      %d\n",b.get(),threadIndex+1);}
@@ -362,6 +377,7 @@ public:
 
   // collector thread loop: handle the output of processing threads
   void loopOutput(void) {
+    applyThreadPlacement(" output thread");
 
     bool isActive = 0;
 
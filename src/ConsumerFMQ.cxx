@@ -144,7 +144,10 @@ public:
   }
 
 private:
-  void runDevice() { sender.RunStateMachine(); }
+  void runDevice() {
+    applyThreadPlacement();
+    sender.RunStateMachine();
+  }
 };
 
 std::unique_ptr<Consumer> getUniqueConsumerFMQ(ConfigFile &cfg,
@@ -12,6 +12,8 @@
 #include "MemoryBank.h"
 #include "MemoryBankManager.h"
 #include "MemoryPagesPool.h"
+#include "MemoryPagesPoolSizeClasses.h"
+#include "RdhUtils.h"
 #include "ReadoutStats.h"
 #include "ReadoutUtils.h"
 
@@ -37,10 +39,27 @@ private:
       memBank; // a dedicated memory bank allocated by FMQ mechanism
   std::shared_ptr<MemoryPagesPool>
       mp; // a memory pool from which to allocate data pages
+  std::shared_ptr<MemoryPagesPoolSizeClasses>
+      mpSizeClasses; // if defined, a set of pools used instead of mp
 
   int memoryPoolPageSize;
   int memoryPoolNumberOfPages;
 
+  // get a new block with (at least) the given payload size, from the
+  // memory pool(s). Returns nullptr if none available.
+  DataBlockContainerReference getNewBlock(size_t size) {
+    DataBlockContainerReference newBlock = nullptr;
+    try {
+      if (mpSizeClasses != nullptr) {
+        newBlock = mpSizeClasses->getNewDataBlockContainer(size);
+      } else if (size + sizeof(DataBlock) <= (size_t)memoryPoolPageSize) {
+        newBlock = mp->getNewDataBlockContainer();
+      }
+    } catch (...) {
+    }
+    return newBlock;
+  }
+
 public:
   std::vector<FairMQMessagePtr>
       messagesToSend;          // collect HBF messages of each update
@@ -193,15 +212,42 @@ public:
         cfgMemoryPoolPageSize.c_str());
     cfg.getOptionalValue<int>(cfgEntryPoint + ".memoryPoolNumberOfPages",
                               memoryPoolNumberOfPages);
-    mp = theMemoryBankManager.getPagedPool(
-        memoryPoolPageSize, memoryPoolNumberOfPages, memoryBankName);
-    if (mp == nullptr) {
-      throw "ConsumerFMQ: failed to get memory pool from " + memoryBankName +
-          " for " + std::to_string(memoryPoolNumberOfPages) + " pages x " +
-          std::to_string(memoryPoolPageSize) + " bytes";
+
+    // configuration parameter: | consumer-FairMQchannel-* |
+    // memoryPoolSizeClasses | string | | If set, a set of pools with different
+    // page sizes is used instead of memoryPoolPageSize/NumberOfPages, and each
+    // header or data frame copy uses the smallest page big enough. Format:
+    // comma-separated list of pageSize:numberOfPages, e.g.
+    // 4k:1000,64k:100,1M:20 |
+    std::string cfgMemoryPoolSizeClasses = "";
+    cfg.getOptionalValue<std::string>(cfgEntryPoint + ".memoryPoolSizeClasses",
+                                      cfgMemoryPoolSizeClasses);
+    if (cfgMemoryPoolSizeClasses.length() > 0) {
+      std::vector<std::pair<size_t, size_t>> sizeClasses;
+      if (ReadoutUtils::getSizeClassesFromString(cfgMemoryPoolSizeClasses,
+                                                 sizeClasses)) {
+        throw "ConsumerFMQ: wrong memoryPoolSizeClasses " +
+            cfgMemoryPoolSizeClasses;
+      }
+      mpSizeClasses = theMemoryBankManager.getPagedPoolSizeClasses(
+          sizeClasses, memoryBankName);
+      if (mpSizeClasses == nullptr) {
+        throw "ConsumerFMQ: failed to get memory pools from " +
+            memoryBankName + " for " + cfgMemoryPoolSizeClasses;
+      }
+      theLog.log("Using memory pools with size classes %s",
+                 cfgMemoryPoolSizeClasses.c_str());
+    } else {
+      mp = theMemoryBankManager.getPagedPool(
+          memoryPoolPageSize, memoryPoolNumberOfPages, memoryBankName);
+      if (mp == nullptr) {
+        throw "ConsumerFMQ: failed to get memory pool from " + memoryBankName +
+            " for " + std::to_string(memoryPoolNumberOfPages) + " pages x " +
+            std::to_string(memoryPoolPageSize) + " bytes";
+      }
+      theLog.log("Using memory pool %d pages x %d bytes",
+                 memoryPoolNumberOfPages, memoryPoolPageSize);
     }
-    theLog.log("Using memory pool %d pages x %d bytes", memoryPoolNumberOfPages,
-               memoryPoolPageSize);
 
     sendingChannel->Bind(cfgChannelAddress);
 
@@ -213,6 +259,7 @@ public:
   ~ConsumerFMQchannel() {
     // release in reverse order
     mp = nullptr;
+    mpSizeClasses = nullptr;
     memoryBuffer = nullptr; // warning: data range may still be referenced in
                             // memory bank manager
     sendingChannel = nullptr;
@@ -224,6 +271,13 @@ public:
     return -1;
   }
 
+  int stop() {
+    if (mpSizeClasses != nullptr) {
+      mpSizeClasses->logStats();
+    }
+    return 0;
+  }
+
   int pushData(DataSetReference &bc) {
 
     if (disableSending) {
@@ -237,6 +291,7 @@ public:
         DataBlock *b = br->getData();
         DataBlockContainerReference *blockRef =
             new DataBlockContainerReference(br);
+        MemoryPagesPool::setPageStage(b, MemoryPagesPool::StageFairMQ);
         void *hint = (void *)blockRef;
         void *blobPtr = b->data;
         size_t blobSize = (size_t)b->header.dataSize;
@@ -253,14 +308,8 @@ public:
     // data page
 
     // we iterate a first time to count number of HB
-    if (memoryPoolPageSize < (int)sizeof(SubTimeframe)) {
-      return -1;
-    }
-    DataBlockContainerReference headerBlock = nullptr;
-    try {
-      headerBlock = mp->getNewDataBlockContainer();
-    } catch (...) {
-    }
+    DataBlockContainerReference headerBlock =
+        getNewBlock(sizeof(SubTimeframe));
     if (headerBlock == nullptr) {
       return -1;
     }
@@ -295,29 +344,20 @@ public:
       // printf("block %d tf %d link
       // %d\n",ix,b->header.timeframeId,b->header.linkId);
 
-      for (int offset = 0;
-           offset + sizeof(o2::Header::RAWDataHeader) <= b->header.dataSize;) {
-        // printf("checking %p : %d\n",b,offset);
-        o2::Header::RAWDataHeader *rdh =
-            (o2::Header::RAWDataHeader *)&b->data[offset];
-        if (rdh->heartbeatOrbit != lastHBid) {
+      RdhPageIndex *index =
+          getRdhPageIndex(b, RdhBlockHandle::ScanUnchecked);
+      for (const RdhPacketInfo &p : index->packets) {
+        if (p.hbOrbit != lastHBid) {
           stfHeader->numberOfHBF++;
-          lastHBid = rdh->heartbeatOrbit;
+          lastHBid = p.hbOrbit;
           // printf("offset %d now %d HBF -
           // HBid=%d\n",offset,stfHeader->numberOfHBF,lastHBid);
         }
-        if (stfHeader->linkId != rdh->linkId) {
+        if (stfHeader->linkId != p.linkId) {
           printf("Warning: TF%d link Id mismatch %d != %d @ page offset %d\n",
                  (int)stfHeader->timeframeId, (int)stfHeader->linkId,
-                 (int)rdh->linkId, (int)offset);
-          // dumpRDH(rdh);
-          // printf("block %p : offset %d = %p\n",b,offset,rdh);
-        }
-        uint16_t offsetNextPacket = rdh->offsetNextPacket;
-        if (offsetNextPacket == 0) {
-          break;
+                 (int)p.linkId, (int)p.offset);
         }
-        offset += offsetNextPacket;
       }
     }
 
@@ -358,6 +398,8 @@ public:
       // reference is kept alive until this new object is destroyed in the
       // cleanupCallback
       pf.blockRef = new DataBlockContainerReference(br);
+      MemoryPagesPool::setPageStage(br->getData(),
+                                    MemoryPagesPool::StageFairMQ);
       // printf("allocating blockRef %p for %p\n",pf.blockRef,br);
       pendingFrames.push_back(pf);
     };
@@ -403,18 +445,9 @@ public:
         // allocate
         // todo: same code as for header -> create func/lambda
         // todo: send empty message if no page left in buffer
-        if (memoryPoolPageSize < totalSize) {
-          printf("error page size too small %d < %d\n", memoryPoolPageSize,
-                 totalSize);
-          return;
-        }
-        DataBlockContainerReference copyBlock = nullptr;
-        try {
-          copyBlock = mp->getNewDataBlockContainer();
-        } catch (...) {
-        }
+        DataBlockContainerReference copyBlock = getNewBlock(totalSize);
         if (copyBlock == nullptr) {
-          printf("error: no page left\n");
+          printf("error: no page left for %d bytes\n", totalSize);
           return;
         }
         auto blockRef = new DataBlockContainerReference(copyBlock);
@@ -453,15 +486,14 @@ public:
     for (auto &br : *bc) {
       DataBlock *b = br->getData();
       unsigned int HBstart = 0;
-      for (int offset = 0;
-           offset + sizeof(o2::Header::RAWDataHeader) <= b->header.dataSize;) {
-        o2::Header::RAWDataHeader *rdh =
-            (o2::Header::RAWDataHeader *)&b->data[offset];
+      RdhPageIndex *index =
+          getRdhPageIndex(b, RdhBlockHandle::ScanUnchecked);
+      for (const RdhPacketInfo &p : index->packets) {
         // printf("CRU block %p = HB %d link %d @
-        // %d\n",b,(int)rdh->heartbeatOrbit,(int)rdh->linkId,offset);
-        if (rdh->heartbeatOrbit != lastHBid) {
+        // %d\n",b,(int)p.hbOrbit,(int)p.linkId,p.offset);
+        if (p.hbOrbit != lastHBid) {
           // printf("new HBf detected\n");
-          int HBlength = offset - HBstart;
+          int HBlength = p.offset - HBstart;
 
           if (HBlength) {
             // add previous block to pending frames
@@ -471,14 +503,9 @@ public:
           pendingFramesCollect();
 
           // update new HB frame
-          HBstart = offset;
-          lastHBid = rdh->heartbeatOrbit;
-        }
-        uint16_t offsetNextPacket = rdh->offsetNextPacket;
-        if (offsetNextPacket == 0) {
-          break;
+          HBstart = p.offset;
+          lastHBid = p.hbOrbit;
         }
-        offset += offsetNextPacket;
       }
 
       // keep last piece for later, HBframe may continue in next block(s)
@@ -505,16 +505,6 @@ public:
       throw __LINE__;
     };
 
-    // basic RDH check
-    auto checkRdh = [&](RdhHandle &h) {
-      std::string errorDescription;
-      if (h.validateRdh(errorDescription)) {
-        invalidRDH++;
-        throw __LINE__;
-      }
-      return;
-    };
-
     auto isEmptyHBstop = [&](RdhHandle &h) {
       if ((h.getStopBit()) && (h.getHeaderSize() == h.getMemorySize())) {
         return true;
@@ -562,20 +552,13 @@ public:
       } else {
         // we have to check packet by packet and discard empty HBstart/HBstop
         // pairs
+        // RDH are validated when building the page index
         size_t blockSize = b->getData()->header.dataSize;
         uint8_t *baseAddress = (uint8_t *)(b->getData()->data);
-        for (size_t pageOffset = 0; pageOffset < blockSize;) {
-          // validate RDH
+        RdhPageIndex *index = getRdhPageIndex(b->getData());
+        for (const RdhPacketInfo &p : index->packets) {
+          size_t pageOffset = p.offset;
           RdhHandle h(baseAddress + pageOffset);
-          try {
-            checkRdh(h);
-          } catch (...) {
-            // stop for this page on first RDH error
-            // cleanup stored previous packet
-            previousPacket.clear();
-            // write previous
-            break;
-          }
 
           // check we still have a valid file handle
           if (fpUsed == nullptr) {
@@ -586,7 +569,6 @@ public:
           if (previousPacket.isEmptyHBStart && isEmptyHBstop(h)) {
             // yes, let's skip it
             previousPacket.clear();
-            pageOffset += h.getOffsetNextPacket();
             emptyPacketsDropped += 2;
             continue;
           }
@@ -601,8 +583,8 @@ public:
           // is this an empty HBstart ?
           if (isEmptyHBstart(h)) {
             // keep it aside for later
-            previousPacket.size = h.getOffsetNextPacket();
-            if (pageOffset + h.getOffsetNextPacket() < blockSize) {
+            previousPacket.size = p.offsetNextPacket;
+            if (pageOffset + p.offsetNextPacket < blockSize) {
               // not end of page, keep a simple reference
               previousPacket.address = baseAddress + pageOffset;
               previousPacket.isCopy = false;
@@ -622,17 +604,16 @@ public:
             // write packet
             // use offsetNextPacket instead of memorySize for file to be
             // consistent
-            writeToFile(baseAddress + pageOffset,
-                        (size_t)h.getOffsetNextPacket(), 0);
+            writeToFile(baseAddress + pageOffset, (size_t)p.offsetNextPacket,
+                        0);
             packetsRecorded++;
           }
-
-          pageOffset += h.getOffsetNextPacket();
-
-          // infinite loop protection, just in case
-          if (h.getOffsetNextPacket() == 0) {
-            break;
-          }
+        }
+        if (index->error) {
+          // page stopped on first RDH error
+          // cleanup stored previous packet
+          invalidRDH++;
+          previousPacket.clear();
         }
       }
     } catch (...) {
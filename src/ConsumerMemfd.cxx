@@ -0,0 +1,339 @@
+// Copyright CERN and copyright holders of ALICE O2. This software is
+// distributed under the terms of the GNU General Public License v3 (GPL
+// Version 3), copied verbatim in the file "COPYING".
+//
+// See http://alice-o2.web.cern.ch/license for full licensing information.
+//
+// In applying this license CERN does not waive the privileges and immunities
+// granted to it by virtue of its status as an Intergovernmental Organization
+// or submit itself to any jurisdiction.
+
+// A consumer giving access to data pages to a local client process, without
+// copy. Pages should be allocated from a memory bank of type memfd, which
+// file descriptor is passed to the client on a unix socket. Then, for each
+// page, a descriptor is sent to the client, and the page is kept until the
+// client releases it, or until the end of run. See MemfdProtocol.h for
+// details.
+
+#include "Consumer.h"
+#include "MemfdProtocol.h"
+#include "MemoryBankManager.h"
+
+#include <atomic>
+#include <errno.h>
+#include <mutex>
+#include <poll.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <thread>
+#include <unistd.h>
+#include <unordered_map>
+
+class ConsumerMemfd : public Consumer {
+public:
+  ConsumerMemfd(ConfigFile &cfg, std::string cfgEntryPoint)
+      : Consumer(cfg, cfgEntryPoint) {
+
+    // configuration parameter: | consumer-memfd-* | socketPath | string |
+    // /tmp/readout-memfd | Path of the unix socket where a client process can
+    // connect to get the data pages. |
+    cfg.getOptionalValue<std::string>(cfgEntryPoint + ".socketPath",
+                                      cfgSocketPath);
+
+    // configuration parameter: | consumer-memfd-* | memoryBankName | string |
+    // | Name of the memory bank shared with the client. It should be of type
+    // memfd, and used by the equipments to allocate their data pages. If not
+    // set, the first bank is used. Pages from other banks are not sent. |
+    std::string cfgMemoryBankName = "";
+    cfg.getOptionalValue<std::string>(cfgEntryPoint + ".memoryBankName",
+                                      cfgMemoryBankName);
+
+    // configuration parameter: | consumer-memfd-* | maxPagesInFlight | int |
+    // 1024 | Maximum number of pages sent to the client and not released yet.
+    // New pages are dropped when reached. |
+    cfg.getOptionalValue<int>(cfgEntryPoint + ".maxPagesInFlight",
+                              cfgMaxPagesInFlight);
+    if (cfgMaxPagesInFlight <= 0) {
+      throw std::string("ConsumerMemfd: wrong maxPagesInFlight");
+    }
+
+    // get the bank to be shared
+    bank = theMemoryBankManager.getBank(cfgMemoryBankName);
+    if (bank == nullptr) {
+      throw "ConsumerMemfd: memory bank " + cfgMemoryBankName + " not found";
+    }
+    if (bank->getSharedFileDescriptor() < 0) {
+      throw "ConsumerMemfd: memory bank " + bank->getDescription() +
+          " can not be shared, should be of type memfd";
+    }
+    bankBaseAddress = (char *)bank->getBaseAddress();
+    bankSize = bank->getSize();
+    pagesInFlight.reserve(cfgMaxPagesInFlight);
+
+    // create listening socket
+    struct sockaddr_un addr;
+    bzero(&addr, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (cfgSocketPath.length() >= sizeof(addr.sun_path)) {
+      throw "ConsumerMemfd: socket path too long " + cfgSocketPath;
+    }
+    strcpy(addr.sun_path, cfgSocketPath.c_str());
+    listenFd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+    if (listenFd < 0) {
+      throw std::string("ConsumerMemfd: failed to create socket");
+    }
+    unlink(cfgSocketPath.c_str());
+    if ((bind(listenFd, (struct sockaddr *)&addr, sizeof(addr))) ||
+        (listen(listenFd, 1))) {
+      std::string err = strerror(errno);
+      close(listenFd);
+      throw "ConsumerMemfd: failed to listen on " + cfgSocketPath + ": " + err;
+    }
+
+    theLog.log("Sharing memory bank %s (%ld bytes) on %s, max %d pages in "
+               "flight",
+               bank->getDescription().c_str(), (long)bankSize,
+               cfgSocketPath.c_str(), cfgMaxPagesInFlight);
+
+    // start thread to handle client connection
+    shutdownRequest = false;
+    serverThread = std::thread(&ConsumerMemfd::run, this);
+  }
+
+  ~ConsumerMemfd() {
+    shutdownRequest = true;
+    if (serverThread.joinable()) {
+      serverThread.join();
+    }
+    closeClient();
+    close(listenFd);
+    unlink(cfgSocketPath.c_str());
+    theLog.log("Memfd consumer: %llu pages sent, %llu released, %llu dropped",
+               (unsigned long long)nPagesSent,
+               (unsigned long long)nPagesReleased,
+               (unsigned long long)nPagesDropped);
+  }
+
+  int pushData(DataBlockContainerReference &b) {
+    DataBlock *db = b->getData();
+    if ((db == nullptr) || (db->data == nullptr)) {
+      return -1;
+    }
+    char *data = db->data;
+    size_t size = db->header.dataSize;
+    if ((data < bankBaseAddress) || (data + size > bankBaseAddress + bankSize)) {
+      // page not in shared bank
+      nPagesDropped++;
+      return -1;
+    }
+
+    std::unique_lock<std::mutex> lock(clientMutex);
+    if (clientFd < 0) {
+      // nobody to send to
+      nPagesDropped++;
+      return 0;
+    }
+    if (pagesInFlight.size() >= (size_t)cfgMaxPagesInFlight) {
+      nPagesDropped++;
+      return -1;
+    }
+
+    MemfdProtocol::Message msg;
+    bzero(&msg, sizeof(msg));
+    msg.type = MemfdProtocol::Page;
+    msg.version = MemfdProtocol::protocolVersion;
+    msg.pageId = ++pageIdCounter;
+    msg.offset = data - bankBaseAddress;
+    msg.size = size;
+    msg.timeframeId = db->header.timeframeId;
+    msg.equipmentId = db->header.equipmentId;
+    msg.linkId = db->header.linkId;
+    if (send(clientFd, &msg, sizeof(msg), MSG_DONTWAIT | MSG_NOSIGNAL) !=
+        sizeof(msg)) {
+      if ((errno != EAGAIN) && (errno != EWOULDBLOCK)) {
+        theLog.log(InfoLogger::Severity::Warning,
+                   "Memfd consumer: failed to send to client: %s",
+                   strerror(errno));
+        closeClientLocked();
+      }
+      nPagesDropped++;
+      return -1;
+    }
+    // keep page until client releases it
+    pagesInFlight[msg.pageId] = b;
+    nPagesSent++;
+    return 0;
+  }
+
+  int stop() {
+    std::unique_lock<std::mutex> lock(clientMutex);
+    if (clientFd >= 0) {
+      MemfdProtocol::Message msg;
+      bzero(&msg, sizeof(msg));
+      msg.type = MemfdProtocol::EndOfRun;
+      msg.version = MemfdProtocol::protocolVersion;
+      // don't wait for a client not reading its socket
+      if (send(clientFd, &msg, sizeof(msg), MSG_DONTWAIT | MSG_NOSIGNAL) !=
+          sizeof(msg)) {
+        theLog.log(InfoLogger::Severity::Warning,
+                   "Memfd consumer: failed to send end of run to client: %s",
+                   strerror(errno));
+        closeClientLocked();
+      }
+    }
+    // pages not released by client are given back to readout at end of run
+    if (pagesInFlight.size()) {
+      theLog.log("Memfd consumer: end of run, %d pages not released by client",
+                 (int)pagesInFlight.size());
+      nPagesReleased += pagesInFlight.size();
+      pagesInFlight.clear();
+    }
+    return 0;
+  }
+
+private:
+  std::string cfgSocketPath = "/tmp/readout-memfd";
+  int cfgMaxPagesInFlight = 1024;
+
+  std::shared_ptr<MemoryBank> bank; // the bank shared with client
+  char *bankBaseAddress = nullptr;  // base address of bank
+  size_t bankSize = 0;              // size of bank
+
+  int listenFd = -1;         // socket waiting for client connection
+  int clientFd = -1;         // socket connected to client, if any
+  std::mutex clientMutex;    // lock for client variables below
+  uint64_t pageIdCounter = 0; // to assign page ids
+  std::unordered_map<uint64_t, DataBlockContainerReference>
+      pagesInFlight; // pages sent to client, not released yet
+
+  std::thread serverThread;          // thread handling client connection
+  std::atomic<bool> shutdownRequest; // flag to terminate thread
+
+  uint64_t nPagesSent = 0;                  // number of pages sent
+  std::atomic<uint64_t> nPagesReleased{0}; // number of pages released
+  uint64_t nPagesDropped = 0;               // number of pages not sent
+
+  // close connection with client, and release pages in use
+  // to be called with clientMutex held
+  void closeClientLocked() {
+    if (clientFd >= 0) {
+      close(clientFd);
+      clientFd = -1;
+      if (pagesInFlight.size()) {
+        theLog.log("Memfd consumer: client disconnected, %d pages released",
+                   (int)pagesInFlight.size());
+      }
+      nPagesReleased += pagesInFlight.size();
+      pagesInFlight.clear();
+    }
+  }
+
+  void closeClient() {
+    std::unique_lock<std::mutex> lock(clientMutex);
+    closeClientLocked();
+  }
+
+  // send bank description and file descriptor to new client
+  int sendBankInfo(int fd) {
+    MemfdProtocol::Message msg;
+    bzero(&msg, sizeof(msg));
+    msg.type = MemfdProtocol::BankInfo;
+    msg.version = MemfdProtocol::protocolVersion;
+    msg.size = bankSize;
+    strncpy(msg.bankName, bank->getDescription().c_str(),
+            sizeof(msg.bankName) - 1);
+
+    struct iovec iov;
+    iov.iov_base = &msg;
+    iov.iov_len = sizeof(msg);
+    char control[CMSG_SPACE(sizeof(int))];
+    bzero(control, sizeof(control));
+    struct msghdr mh;
+    bzero(&mh, sizeof(mh));
+    mh.msg_iov = &iov;
+    mh.msg_iovlen = 1;
+    mh.msg_control = control;
+    mh.msg_controllen = sizeof(control);
+    struct cmsghdr *cm = CMSG_FIRSTHDR(&mh);
+    cm->cmsg_level = SOL_SOCKET;
+    cm->cmsg_type = SCM_RIGHTS;
+    cm->cmsg_len = CMSG_LEN(sizeof(int));
+    int sharedFd = bank->getSharedFileDescriptor();
+    memcpy(CMSG_DATA(cm), &sharedFd, sizeof(int));
+    if (sendmsg(fd, &mh, MSG_NOSIGNAL) != sizeof(msg)) {
+      return -1;
+    }
+    return 0;
+  }
+
+  // loop to accept client connection and get released pages
+  void run() {
+    applyThreadPlacement();
+    const int pollTimeout = 100; // in milliseconds
+    while (!shutdownRequest) {
+      int currentClientFd;
+      {
+        std::unique_lock<std::mutex> lock(clientMutex);
+        currentClientFd = clientFd;
+      }
+      if (currentClientFd < 0) {
+        // wait for new client
+        struct pollfd pfd = {listenFd, POLLIN, 0};
+        if (poll(&pfd, 1, pollTimeout) <= 0) {
+          continue;
+        }
+        int fd = accept4(listenFd, nullptr, nullptr, SOCK_CLOEXEC);
+        if (fd < 0) {
+          continue;
+        }
+        if (sendBankInfo(fd)) {
+          theLog.log(InfoLogger::Severity::Warning,
+                     "Memfd consumer: failed to send bank info to client: %s",
+                     strerror(errno));
+          close(fd);
+          continue;
+        }
+        theLog.log("Memfd consumer: client connected");
+        std::unique_lock<std::mutex> lock(clientMutex);
+        clientFd = fd;
+        continue;
+      }
+
+      // get released pages from client
+      struct pollfd pfd = {currentClientFd, POLLIN, 0};
+      if (poll(&pfd, 1, pollTimeout) <= 0) {
+        continue;
+      }
+      MemfdProtocol::Message msg;
+      ssize_t n = recv(pfd.fd, &msg, sizeof(msg), MSG_DONTWAIT);
+      if ((n < 0) && ((errno == EAGAIN) || (errno == EWOULDBLOCK))) {
+        continue;
+      }
+      if (n != sizeof(msg)) {
+        // disconnected, or protocol error
+        closeClient();
+        continue;
+      }
+      if (msg.type == MemfdProtocol::Release) {
+        DataBlockContainerReference b = nullptr;
+        {
+          std::unique_lock<std::mutex> lock(clientMutex);
+          auto it = pagesInFlight.find(msg.pageId);
+          if (it != pagesInFlight.end()) {
+            b = it->second;
+            pagesInFlight.erase(it);
+            nPagesReleased++;
+          }
+        }
+        // page given back to pool here, outside of lock
+        b = nullptr;
+      }
+    }
+  }
+};
+
+std::unique_ptr<Consumer> getUniqueConsumerMemfd(ConfigFile &cfg,
+                                                 std::string cfgEntryPoint) {
+  return std::make_unique<ConsumerMemfd>(cfg, cfgEntryPoint);
+}
@@ -172,6 +172,7 @@ private:
   bool periodicUpdateThreadShutdown; // flag to stop periodicUpdateThread
   void periodicUpdate() {
     periodicUpdateThreadShutdown = 0;
+    applyThreadPlacement();
 
     // periodic update
     for (; !periodicUpdateThreadShutdown;) {
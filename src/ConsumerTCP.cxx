@@ -46,7 +46,8 @@ public:
 
     for (int i = 0; i < cfgNcx; i++) {
       int p = cfgPort + i;
-      tx.push_back(std::make_unique<SocketTx>("Readout", cfgHost.c_str(), p));
+      tx.push_back(std::make_unique<SocketTx>("Readout", cfgHost.c_str(), p,
+                                              threadPlacement));
     }
   }
   ~ConsumerTCP() {
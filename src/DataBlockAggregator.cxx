@@ -9,14 +9,18 @@
 // or submit itself to any jurisdiction.
 
 #include "DataBlockAggregator.h"
+#include "MemoryPagesPool.h"
+
+#include <algorithm>
 
 #include <InfoLogger/InfoLogger.hxx>
 using namespace AliceO2::InfoLogger;
 extern InfoLogger theLog;
 
-DataBlockAggregator::DataBlockAggregator(
-    AliceO2::Common::Fifo<DataSetReference> *v_output, std::string name) {
+DataBlockAggregator::DataBlockAggregator(FifoSPSC<DataSetReference> *v_output,
+                                         std::string name) {
   output = v_output;
+  aggregatorName = name;
   aggregateThread = std::make_unique<Thread>(
       DataBlockAggregator::threadCallback, this, name, 1000);
   isIncompletePending = 0;
@@ -27,7 +31,7 @@ DataBlockAggregator::~DataBlockAggregator() {
 }
 
 int DataBlockAggregator::addInput(
-    std::shared_ptr<AliceO2::Common::Fifo<DataBlockContainerReference>> input) {
+    std::shared_ptr<FifoSPSC<DataBlockContainerReference>> input) {
   // inputs.push_back(input);
   inputs.push_back(input);
   slicers.push_back(DataBlockSlicer());
@@ -40,6 +44,12 @@ Thread::CallbackResult DataBlockAggregator::threadCallback(void *arg) {
     return Thread::CallbackResult::Error;
   }
 
+  // apply thread placement, on first iteration
+  if (!dPtr->isThreadPlaced) {
+    dPtr->threadPlacement.apply(dPtr->aggregatorName);
+    dPtr->isThreadPlaced = true;
+  }
+
   if (dPtr->output->isFull()) {
     return Thread::CallbackResult::Idle;
   }
@@ -53,6 +63,7 @@ void DataBlockAggregator::start() {
   }
   doFlush = 0;
   timeNow.reset();
+  isThreadPlaced = false;
   aggregateThread->start();
 }
 
@@ -96,51 +107,67 @@ Thread::CallbackResult DataBlockAggregator::executeCallback() {
   // get time once per iteration
   double now = timeNow.getTime();
 
+  // space available in output fifo. It can only grow while we fill it.
+  int nOutputFree = output->getNumberOfFreeSlots();
+
   for (unsigned int ix = 0; ix < nInputs; ix++) {
     int i = (ix + nextIndex) % nInputs;
 
     if (disableSlicing) {
       // no slicing... pass through
-      if (output->isFull()) {
-        return Thread::CallbackResult::Idle;
-      }
-      if (inputs[i]->isEmpty()) {
-        continue;
+      int nBlocks = inputs[i]->popBatch(
+          inputBatch, std::min(maxBatchSize, nOutputFree - (int)nSlicesOut));
+      for (int k = 0; k < nBlocks; k++) {
+        DataBlockContainerReference &b = inputBatch[k];
+        nBlocksIn++;
+        totalBlocksIn++;
+        MemoryPagesPool::setPageStage(b->getData(),
+                                      MemoryPagesPool::StageAggregator);
+        DataSetReference bcv = nullptr;
+        try {
+          bcv = std::make_shared<DataSet>();
+        } catch (...) {
+          flushOutputBatch();
+          clearInputBatch();
+          return Thread::CallbackResult::Error;
+        }
+        bcv->push_back(std::move(b));
+        outputBatch[outputBatchSize++] = std::move(bcv);
+        nSlicesOut++;
       }
-      DataBlockContainerReference b = nullptr;
-      inputs[i]->pop(b);
-      nBlocksIn++;
-      totalBlocksIn++;
-      DataSetReference bcv = nullptr;
-      try {
-        bcv = std::make_shared<DataSet>();
-      } catch (...) {
-        return Thread::CallbackResult::Error;
+      flushOutputBatch();
+      if ((int)nSlicesOut >= nOutputFree) {
+        return Thread::CallbackResult::Idle;
       }
-      bcv->push_back(b);
-      output->push(bcv);
-      nSlicesOut++;
       continue;
     }
 
     const int maxLoop = 1024;
 
     // populate slices
-    for (int j = 0; j < maxLoop; j++) {
-      if (inputs[i]->isEmpty()) {
+    for (int j = 0; j < maxLoop;) {
+      int nBlocks =
+          inputs[i]->popBatch(inputBatch, std::min(maxBatchSize, maxLoop - j));
+      if (nBlocks == 0) {
         break;
       }
-      DataBlockContainerReference b = nullptr;
-      inputs[i]->pop(b);
-      nBlocksIn++;
-      totalBlocksIn++;
-      // printf("Got block %d from dev %d eq %d link %d tf
-      // %d\n",(int)(b->getData()->header.blockId),
-      // i,(int)(b->getData()->header.equipmentId),
-      // (int)(b->getData()->header.linkId),
-      // (int)(b->getData()->header.timeframeId));
-      if (slicers[i].appendBlock(b, now) <= 0) {
-        return Thread::CallbackResult::Error;
+      j += nBlocks;
+      for (int k = 0; k < nBlocks; k++) {
+        DataBlockContainerReference &b = inputBatch[k];
+        nBlocksIn++;
+        totalBlocksIn++;
+        MemoryPagesPool::setPageStage(b->getData(),
+                                      MemoryPagesPool::StageAggregator);
+        // printf("Got block %d from dev %d eq %d link %d tf
+        // %d\n",(int)(b->getData()->header.blockId),
+        // i,(int)(b->getData()->header.equipmentId),
+        // (int)(b->getData()->header.linkId),
+        // (int)(b->getData()->header.timeframeId));
+        if (slicers[i].appendBlock(b, now) <= 0) {
+          clearInputBatch();
+          return Thread::CallbackResult::Error;
+        }
+        b = nullptr;
       }
     }
 
@@ -151,7 +178,8 @@ Thread::CallbackResult DataBlockAggregator::executeCallback() {
 
     // retrieve completed slices
     for (int j = 0; j < maxLoop; j++) {
-      if (output->isFull()) {
+      if ((int)nSlicesOut >= nOutputFree) {
+        flushOutputBatch();
         return Thread::CallbackResult::Idle;
       }
       bool includeIncomplete = 0;
@@ -162,11 +190,15 @@ Thread::CallbackResult DataBlockAggregator::executeCallback() {
       if (bcv == nullptr) {
         break;
       }
-      output->push(bcv);
+      outputBatch[outputBatchSize++] = std::move(bcv);
+      if (outputBatchSize == maxBatchSize) {
+        flushOutputBatch();
+      }
       nSlicesOut++;
       nextIndex = i + 1;
       // printf("Pushed STF : %d chunks\n",(int)bcv->size());
     }
+    flushOutputBatch();
   }
 
   if ((nBlocksIn == 0) && (nSlicesOut == 0)) {
@@ -179,6 +211,24 @@ Thread::CallbackResult DataBlockAggregator::executeCallback() {
   return Thread::CallbackResult::Ok;
 }
 
+void DataBlockAggregator::flushOutputBatch() {
+  if (outputBatchSize == 0) {
+    return;
+  }
+  // space was checked before filling the batch, all slices fit
+  output->pushBatch(outputBatch, outputBatchSize);
+  for (int i = 0; i < outputBatchSize; i++) {
+    outputBatch[i] = nullptr;
+  }
+  outputBatchSize = 0;
+}
+
+void DataBlockAggregator::clearInputBatch() {
+  for (int i = 0; i < maxBatchSize; i++) {
+    inputBatch[i] = nullptr;
+  }
+}
+
 DataBlockSlicer::DataBlockSlicer() {}
 
 DataBlockSlicer::~DataBlockSlicer() {}
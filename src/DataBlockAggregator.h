@@ -21,6 +21,9 @@
 #include <memory>
 #include <queue>
 
+#include "FifoSPSC.h"
+#include "ThreadPlacement.h"
+
 using namespace AliceO2::Common;
 
 /*
@@ -91,13 +94,12 @@ private:
 
 class DataBlockAggregator {
 public:
-  DataBlockAggregator(AliceO2::Common::Fifo<DataSetReference> *output,
+  DataBlockAggregator(FifoSPSC<DataSetReference> *output,
                       std::string name = "Aggregator");
   ~DataBlockAggregator();
 
-  int addInput(
-      std::shared_ptr<AliceO2::Common::Fifo<DataBlockContainerReference>>
-          input); // add a FIFO to be used as input
+  int addInput(std::shared_ptr<FifoSPSC<DataBlockContainerReference>>
+                   input); // add a FIFO to be used as input
 
   void start(); // starts processing thread
   void stop(int waitStopped =
@@ -117,13 +119,23 @@ public:
   bool doFlush = 0; // when set, flush slices including incomplete ones
                     // the flag is reset automatically when done
 
+  ThreadPlacement threadPlacement; // placement of the aggregator thread
+
 private:
-  std::vector<
-      std::shared_ptr<AliceO2::Common::Fifo<DataBlockContainerReference>>>
-      inputs;
-  AliceO2::Common::Fifo<DataSetReference> *output; // todo: unique_ptr
+  std::vector<std::shared_ptr<FifoSPSC<DataBlockContainerReference>>> inputs;
+  FifoSPSC<DataSetReference> *output; // todo: unique_ptr
+
+  // blocks and slices are transferred from inputs / to output by batches
+  static const int maxBatchSize = 64;
+  DataBlockContainerReference inputBatch[maxBatchSize];
+  DataSetReference outputBatch[maxBatchSize];
+  int outputBatchSize = 0;
+  void flushOutputBatch(); // push to output fifo the slices in outputBatch
+  void clearInputBatch();  // release blocks left in inputBatch
 
   std::unique_ptr<Thread> aggregateThread;
+  std::string aggregatorName;  // name of aggregator, as given to constructor
+  bool isThreadPlaced = false; // set once placement applied in thread
   AliceO2::Common::Timer incompletePendingTimer;
   AliceO2::Common::Timer timeNow; // a time counter, used to timestamp slices
 
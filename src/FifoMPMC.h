@@ -0,0 +1,148 @@
+// Copyright CERN and copyright holders of ALICE O2. This software is
+// distributed under the terms of the GNU General Public License v3 (GPL
+// Version 3), copied verbatim in the file "COPYING".
+//
+// See http://alice-o2.web.cern.ch/license for full licensing information.
+//
+// In applying this license CERN does not waive the privileges and immunities
+// granted to it by virtue of its status as an Intergovernmental Organization
+// or submit itself to any jurisdiction.
+
+/// \file FifoMPMC.h
+/// \brief Bounded lock-free FIFO, safe for multiple producers and consumers.
+/// \descr Ring buffer with one sequence number per slot (D. Vyukov design).
+/// Same push()/pop() conventions as Common::Fifo, so that both can be used
+/// interchangeably.
+
+#ifndef _FIFOMPMC_H
+#define _FIFOMPMC_H
+
+#include <atomic>
+#include <memory>
+#include <stddef.h>
+#include <stdint.h>
+
+template <class T> class FifoMPMC {
+
+public:
+  // constructor
+  // size: minimum number of elements which can be stored in the fifo.
+  // Actual capacity is rounded up to the next power of 2.
+  FifoMPMC(size_t size) {
+    capacity = 1;
+    while (capacity < size) {
+      capacity *= 2;
+    }
+    indexMask = capacity - 1;
+    slots = std::make_unique<Slot[]>(capacity);
+    for (size_t i = 0; i < capacity; i++) {
+      slots[i].sequence.store(i, std::memory_order_relaxed);
+    }
+    indexIn.store(0, std::memory_order_relaxed);
+    indexOut.store(0, std::memory_order_relaxed);
+  }
+
+  ~FifoMPMC() {}
+
+  // insert an element. Returns 0 on success, -1 if fifo full.
+  int push(const T &item) {
+    Slot *s;
+    size_t pos = indexIn.load(std::memory_order_relaxed);
+    for (;;) {
+      s = &slots[pos & indexMask];
+      size_t seq = s->sequence.load(std::memory_order_acquire);
+      intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+      if (diff == 0) {
+        // slot free for this position, try to reserve it
+        if (indexIn.compare_exchange_weak(pos, pos + 1,
+                                          std::memory_order_relaxed)) {
+          break;
+        }
+      } else if (diff < 0) {
+        // slot still in use by previous round
+        // this is really full only if no pop in progress on this slot
+        // (otherwise, wait for it to complete)
+        if ((intptr_t)(pos - indexOut.load(std::memory_order_acquire)) >=
+            (intptr_t)capacity) {
+          return -1;
+        }
+        pos = indexIn.load(std::memory_order_relaxed);
+      } else {
+        // another producer took this position, retry with latest one
+        pos = indexIn.load(std::memory_order_relaxed);
+      }
+    }
+    s->item = item;
+    s->sequence.store(pos + 1, std::memory_order_release);
+    return 0;
+  }
+
+  // retrieve an element. Returns 0 on success, -1 if fifo empty.
+  int pop(T &item) {
+    Slot *s;
+    size_t pos = indexOut.load(std::memory_order_relaxed);
+    for (;;) {
+      s = &slots[pos & indexMask];
+      size_t seq = s->sequence.load(std::memory_order_acquire);
+      intptr_t diff = (intptr_t)seq - (intptr_t)(pos + 1);
+      if (diff == 0) {
+        // slot filled for this position, try to reserve it
+        if (indexOut.compare_exchange_weak(pos, pos + 1,
+                                           std::memory_order_relaxed)) {
+          break;
+        }
+      } else if (diff < 0) {
+        // slot not written yet
+        // this is really empty only if no push in progress on this slot
+        // (otherwise, wait for it to complete)
+        if ((intptr_t)(indexIn.load(std::memory_order_acquire) - pos) <= 0) {
+          return -1;
+        }
+        pos = indexOut.load(std::memory_order_relaxed);
+      } else {
+        // another consumer took this position, retry with latest one
+        pos = indexOut.load(std::memory_order_relaxed);
+      }
+    }
+    item = s->item;
+    s->sequence.store(pos + indexMask + 1, std::memory_order_release);
+    return 0;
+  }
+
+  // access to occupancy
+  // NB: when used concurrently, values are only a snapshot and may be
+  // slightly off
+  int getNumberOfUsedSlots() {
+    size_t nOut = indexOut.load(std::memory_order_relaxed);
+    size_t nIn = indexIn.load(std::memory_order_relaxed);
+    if (nIn < nOut) {
+      return 0;
+    }
+    return (int)(nIn - nOut);
+  }
+  int getNumberOfFreeSlots() {
+    return (int)capacity - getNumberOfUsedSlots();
+  }
+  bool isEmpty() { return getNumberOfUsedSlots() == 0; }
+  bool isFull() { return getNumberOfFreeSlots() == 0; }
+  size_t getCapacity() { return capacity; }
+
+private:
+  struct Slot {
+    std::atomic<size_t> sequence; // position for which the slot is ready
+    T item;                       // stored element
+  };
+
+  static const int cacheLineSize = 64;
+
+  std::unique_ptr<Slot[]> slots; // array of slots
+  size_t capacity;               // number of slots
+  size_t indexMask;              // capacity - 1
+
+  // write and read positions, kept on separate cache lines
+  alignas(cacheLineSize) std::atomic<size_t> indexIn;
+  alignas(cacheLineSize) std::atomic<size_t> indexOut;
+  char padding[cacheLineSize - sizeof(std::atomic<size_t>)];
+};
+
+#endif // #ifndef _FIFOMPMC_H
@@ -0,0 +1,184 @@
+// Copyright CERN and copyright holders of ALICE O2. This software is
+// distributed under the terms of the GNU General Public License v3 (GPL
+// Version 3), copied verbatim in the file "COPYING".
+//
+// See http://alice-o2.web.cern.ch/license for full licensing information.
+//
+// In applying this license CERN does not waive the privileges and immunities
+// granted to it by virtue of its status as an Intergovernmental Organization
+// or submit itself to any jurisdiction.
+
+/// \file FifoSPSC.h
+/// \brief Bounded lock-free FIFO, for one producer thread and one consumer
+/// thread, with batch operations.
+/// \descr Same push()/pop() conventions as Common::Fifo, so that both can be
+/// used interchangeably. In addition, pushBatch()/popBatch() transfer several
+/// elements with a single update of the shared index.
+/// Read and write indexes are kept on separate cache lines, and each side
+/// keeps a local copy of the index of the other side, which is refreshed only
+/// when the fifo looks full (producer) or empty (consumer).
+/// Elements are moved out of the fifo when retrieved, so that no reference is
+/// kept on them (e.g. for shared pointers).
+
+#ifndef _FIFOSPSC_H
+#define _FIFOSPSC_H
+
+#include <atomic>
+#include <memory>
+#include <stddef.h>
+#include <stdint.h>
+#include <utility>
+
+template <class T> class FifoSPSC {
+
+public:
+  // constructor
+  // size: number of elements which can be stored in the fifo.
+  FifoSPSC(size_t size) {
+    capacity = size;
+    size_t n = 1;
+    while (n < size) {
+      n *= 2;
+    }
+    indexMask = n - 1;
+    slots = std::make_unique<T[]>(n);
+    indexIn.store(0, std::memory_order_relaxed);
+    indexOut.store(0, std::memory_order_relaxed);
+    cachedIndexIn = 0;
+    cachedIndexOut = 0;
+  }
+
+  ~FifoSPSC() {}
+
+  // functions for producer thread
+
+  // insert an element. Returns 0 on success, -1 if fifo full.
+  int push(const T &item) {
+    uint64_t in = indexIn.load(std::memory_order_relaxed);
+    if (getFreeSlotsProducer(in, 1) == 0) {
+      return -1;
+    }
+    slots[in & indexMask] = item;
+    indexIn.store(in + 1, std::memory_order_release);
+    return 0;
+  }
+
+  // insert up to n elements, moved from the given array.
+  // Returns number of elements inserted (less than n if fifo full).
+  size_t pushBatch(T *items, size_t n) {
+    uint64_t in = indexIn.load(std::memory_order_relaxed);
+    size_t nFree = getFreeSlotsProducer(in, n);
+    if (n > nFree) {
+      n = nFree;
+    }
+    for (size_t i = 0; i < n; i++) {
+      slots[(in + i) & indexMask] = std::move(items[i]);
+    }
+    if (n) {
+      indexIn.store(in + n, std::memory_order_release);
+    }
+    return n;
+  }
+
+  bool isFull() { return getNumberOfFreeSlots() == 0; }
+
+  // functions for consumer thread
+
+  // retrieve an element. Returns 0 on success, -1 if fifo empty.
+  int pop(T &item) {
+    uint64_t out = indexOut.load(std::memory_order_relaxed);
+    if (getUsedSlotsConsumer(out, 1) == 0) {
+      return -1;
+    }
+    item = std::move(slots[out & indexMask]);
+    slots[out & indexMask] = T();
+    indexOut.store(out + 1, std::memory_order_release);
+    return 0;
+  }
+
+  // retrieve up to n elements, moved to the given array.
+  // Returns number of elements retrieved (less than n if fifo empty).
+  size_t popBatch(T *items, size_t n) {
+    uint64_t out = indexOut.load(std::memory_order_relaxed);
+    size_t nUsed = getUsedSlotsConsumer(out, n);
+    if (n > nUsed) {
+      n = nUsed;
+    }
+    for (size_t i = 0; i < n; i++) {
+      items[i] = std::move(slots[(out + i) & indexMask]);
+      slots[(out + i) & indexMask] = T();
+    }
+    if (n) {
+      indexOut.store(out + n, std::memory_order_release);
+    }
+    return n;
+  }
+
+  bool isEmpty() { return getNumberOfUsedSlots() == 0; }
+
+  // remove all elements. Should be called only by consumer thread, or when
+  // producer is stopped.
+  void clear() {
+    T item;
+    while (pop(item) == 0) {
+      item = T();
+    }
+  }
+
+  // access to occupancy
+  // NB: when used concurrently, values are only a snapshot
+  int getNumberOfUsedSlots() {
+    uint64_t out = indexOut.load(std::memory_order_acquire);
+    uint64_t in = indexIn.load(std::memory_order_acquire);
+    if (in < out) {
+      return 0;
+    }
+    return (int)(in - out);
+  }
+  int getNumberOfFreeSlots() {
+    return (int)capacity - getNumberOfUsedSlots();
+  }
+  size_t getCapacity() { return capacity; }
+
+private:
+  // number of free slots, seen from producer side
+  // the index of consumer is reloaded only if less than n slots known free
+  size_t getFreeSlotsProducer(uint64_t in, size_t n) {
+    size_t nFree = capacity - (size_t)(in - cachedIndexOut);
+    if (nFree < n) {
+      cachedIndexOut = indexOut.load(std::memory_order_acquire);
+      nFree = capacity - (size_t)(in - cachedIndexOut);
+    }
+    return nFree;
+  }
+
+  // number of used slots, seen from consumer side
+  // the index of producer is reloaded only if less than n slots known used
+  size_t getUsedSlotsConsumer(uint64_t out, size_t n) {
+    size_t nUsed = (size_t)(cachedIndexIn - out);
+    if (nUsed < n) {
+      cachedIndexIn = indexIn.load(std::memory_order_acquire);
+      nUsed = (size_t)(cachedIndexIn - out);
+    }
+    return nUsed;
+  }
+
+  static const int cacheLineSize = 64;
+
+  std::unique_ptr<T[]> slots; // array of slots (size: power of 2)
+  size_t capacity;            // max number of elements stored
+  size_t indexMask;           // number of slots - 1
+
+  // producer side: write position, and last known read position
+  alignas(cacheLineSize) std::atomic<uint64_t> indexIn;
+  uint64_t cachedIndexOut;
+
+  // consumer side: read position, and last known write position
+  alignas(cacheLineSize) std::atomic<uint64_t> indexOut;
+  uint64_t cachedIndexIn;
+
+  char padding[cacheLineSize - sizeof(std::atomic<uint64_t>) -
+               sizeof(uint64_t)];
+};
+
+#endif // #ifndef _FIFOSPSC_H
@@ -0,0 +1,187 @@
+// Copyright CERN and copyright holders of ALICE O2. This software is
+// distributed under the terms of the GNU General Public License v3 (GPL
+// Version 3), copied verbatim in the file "COPYING".
+//
+// See http://alice-o2.web.cern.ch/license for full licensing information.
+//
+// In applying this license CERN does not waive the privileges and immunities
+// granted to it by virtue of its status as an Intergovernmental Organization
+// or submit itself to any jurisdiction.
+
+#include "FileReadAhead.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// alignment of buffers and reads, for direct I/O
+static const size_t alignment = 4096;
+
+static size_t alignSize(size_t sz) {
+  return ((sz + alignment - 1) / alignment) * alignment;
+}
+
+FileReadAhead::FileReadAhead(const std::string &path, size_t vBufferSize,
+                             int numberOfBuffers, size_t maxDataSize,
+                             bool vDirectIO) {
+  isRunning = false;
+  carrySize = alignSize(maxDataSize);
+  bufferSize = alignSize(vBufferSize);
+  if (bufferSize < carrySize) {
+    bufferSize = carrySize;
+  }
+  if (numberOfBuffers < 2) {
+    numberOfBuffers = 2;
+  }
+
+  if (vDirectIO) {
+    fd = open(path.c_str(), O_RDONLY | O_DIRECT);
+    directIO = (fd >= 0);
+  }
+  if (fd < 0) {
+    fd = open(path.c_str(), O_RDONLY);
+  }
+  if (fd < 0) {
+    throw std::string("open ") + path + " failed: " + strerror(errno);
+  }
+  struct stat st;
+  if (fstat(fd, &st)) {
+    std::string err = std::string("stat ") + path + " failed: " + strerror(errno);
+    close(fd);
+    throw err;
+  }
+  fileSize = (size_t)st.st_size;
+
+  memorySize = (carrySize + bufferSize) * numberOfBuffers;
+  void *ptr = mmap(nullptr, memorySize, PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (ptr == MAP_FAILED) {
+    close(fd);
+    throw std::string("staging buffers allocation failed: ") + strerror(errno);
+  }
+  memory = (char *)ptr;
+  buffers.resize(numberOfBuffers);
+  for (int i = 0; i < numberOfBuffers; i++) {
+    buffers[i].data = &memory[(carrySize + bufferSize) * i + carrySize];
+  }
+  buffersFree = std::make_unique<FifoSPSC<int>>(numberOfBuffers);
+  buffersReady = std::make_unique<FifoSPSC<int>>(numberOfBuffers);
+}
+
+FileReadAhead::~FileReadAhead() {
+  stop();
+  close(fd);
+  munmap(memory, memorySize);
+}
+
+void FileReadAhead::start() {
+  stop();
+  buffersFree->clear();
+  buffersReady->clear();
+  for (int i = 0; i < (int)buffers.size(); i++) {
+    buffersFree->push(i);
+  }
+  currentBuffer = -1;
+  dataPtr = nullptr;
+  dataSize = 0;
+  errorFound = false;
+  isRunning = true;
+  readThread = std::make_unique<std::thread>(&FileReadAhead::run, this);
+}
+
+void FileReadAhead::stop() {
+  isRunning = false;
+  if (readThread != nullptr) {
+    readThread->join();
+    readThread = nullptr;
+  }
+}
+
+void FileReadAhead::run() {
+  uint64_t offset = 0;
+  while (isRunning) {
+    int i;
+    if (buffersFree->pop(i)) {
+      usleep(100);
+      continue;
+    }
+    Buffer &b = buffers[i];
+    size_t n = 0;
+    b.isError = false;
+    while (n < bufferSize) {
+      ssize_t r = pread(fd, &b.data[n], bufferSize - n, offset + n);
+      if (r < 0) {
+        if (errno == EINTR) {
+          continue;
+        }
+        b.isError = true;
+        break;
+      }
+      if (r == 0) {
+        break;
+      }
+      n += r;
+    }
+    offset += n;
+    b.size = n;
+    b.isLast = (b.isError) || (offset >= fileSize) || (n < bufferSize);
+    buffersReady->push(i);
+    if (b.isLast) {
+      break;
+    }
+  }
+}
+
+int FileReadAhead::getData(size_t minBytes) {
+  if (minBytes > carrySize) {
+    minBytes = carrySize;
+  }
+  for (;;) {
+    if (currentBuffer >= 0) {
+      Buffer &b = buffers[currentBuffer];
+      if (b.isError) {
+        errorFound = true;
+        return -1;
+      }
+      if ((dataSize >= minBytes) || (b.isLast)) {
+        return (dataSize == 0) ? -1 : 0;
+      }
+    }
+    int next;
+    if (buffersReady->pop(next)) {
+      return 1;
+    }
+    Buffer &nb = buffers[next];
+    if (currentBuffer >= 0) {
+      // carry over the end of current buffer in front of the next one
+      memcpy(nb.data - dataSize, dataPtr, dataSize);
+      buffersFree->push(currentBuffer);
+    }
+    dataPtr = nb.data - dataSize;
+    dataSize += nb.size;
+    currentBuffer = next;
+  }
+}
+
+const char *FileReadAhead::getDataPointer() { return dataPtr; }
+
+size_t FileReadAhead::getDataSize() { return dataSize; }
+
+void FileReadAhead::consume(size_t nBytes) {
+  if (nBytes > dataSize) {
+    nBytes = dataSize;
+  }
+  dataPtr += nBytes;
+  dataSize -= nBytes;
+}
+
+bool FileReadAhead::isError() { return errorFound; }
+
+size_t FileReadAhead::getFileSize() { return fileSize; }
+
+size_t FileReadAhead::getBufferSize() { return bufferSize; }
+
+bool FileReadAhead::isDirectIO() { return directIO; }
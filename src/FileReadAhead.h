@@ -0,0 +1,94 @@
+// Copyright CERN and copyright holders of ALICE O2. This software is
+// distributed under the terms of the GNU General Public License v3 (GPL
+// Version 3), copied verbatim in the file "COPYING".
+//
+// See http://alice-o2.web.cern.ch/license for full licensing information.
+//
+// In applying this license CERN does not waive the privileges and immunities
+// granted to it by virtue of its status as an Intergovernmental Organization
+// or submit itself to any jurisdiction.
+
+/// \file FileReadAhead.h
+/// \brief Sequential read of a file in a separate thread, into large staging
+/// buffers.
+/// \descr The file is read with pread() into a ring of page-aligned buffers,
+/// with O_DIRECT if requested and supported. The consumer thread gets a
+/// pointer to contiguous data, and consumes it by any amount. Each buffer is
+/// preceded by an area where the data left at the end of the previous buffer
+/// is copied when moving to the next one, so that data can be cut at any
+/// boundary (e.g. packets) without reading it again nor seeking in the file.
+
+#ifndef _FILEREADAHEAD_H
+#define _FILEREADAHEAD_H
+
+#include <atomic>
+#include <memory>
+#include <stddef.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "FifoSPSC.h"
+
+class FileReadAhead {
+public:
+  // open file and allocate buffers
+  // - bufferSize: size of each buffer (rounded up to 4kB)
+  // - numberOfBuffers: number of buffers (at least 2)
+  // - maxDataSize: maximum amount of contiguous data requested with
+  // getData(). Buffers are at least this size.
+  // - directIO: if set, file opened with O_DIRECT (if possible)
+  // throws a std::string on error
+  FileReadAhead(const std::string &path, size_t bufferSize, int numberOfBuffers,
+                size_t maxDataSize, bool directIO);
+  ~FileReadAhead();
+
+  void start(); // start reading from beginning of file
+  void stop();  // stop reading (data not consumed yet is dropped)
+
+  // functions for consumer thread
+
+  // make available at least minBytes of contiguous data, or what is left
+  // before end of file
+  // returns 0 on success, 1 if not available yet, -1 on end of file or error
+  int getData(size_t minBytes);
+
+  const char *getDataPointer(); // data available
+  size_t getDataSize();         // number of bytes available
+  void consume(size_t nBytes);  // release bytes at beginning of data
+
+  bool isError(); // set if the file could not be read
+
+  size_t getFileSize();
+  size_t getBufferSize();
+  bool isDirectIO();
+
+private:
+  struct Buffer {
+    char *data = nullptr; // file data, aligned for direct I/O
+    size_t size = 0;      // number of bytes read
+    bool isLast = false;  // set if end of file reached, or error
+    bool isError = false; // set if read error
+  };
+  std::vector<Buffer> buffers;
+  char *memory = nullptr;      // memory allocated for all buffers
+  size_t memorySize = 0;       // size of memory allocated
+  size_t bufferSize = 0;       // size of data area of each buffer
+  size_t carrySize = 0;        // size of area before each buffer
+  std::unique_ptr<FifoSPSC<int>> buffersFree;  // buffers to be filled
+  std::unique_ptr<FifoSPSC<int>> buffersReady; // buffers filled
+  int fd = -1;                                 // file descriptor
+  size_t fileSize = 0;                         // file size
+  bool directIO = false;                       // set if O_DIRECT used
+  bool errorFound = false;                     // set on read error
+
+  std::unique_ptr<std::thread> readThread; // the read thread
+  std::atomic<bool> isRunning;             // cleared to stop read thread
+  void run();                              // loop of the read thread
+
+  int currentBuffer = -1;        // buffer in use by consumer
+  const char *dataPtr = nullptr; // current position in buffer
+  size_t dataSize = 0;           // number of bytes available from dataPtr
+};
+
+#endif // #ifndef _FILEREADAHEAD_H
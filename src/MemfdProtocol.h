@@ -0,0 +1,59 @@
+// Copyright CERN and copyright holders of ALICE O2. This software is
+// distributed under the terms of the GNU General Public License v3 (GPL
+// Version 3), copied verbatim in the file "COPYING".
+//
+// See http://alice-o2.web.cern.ch/license for full licensing information.
+//
+// In applying this license CERN does not waive the privileges and immunities
+// granted to it by virtue of its status as an Intergovernmental Organization
+// or submit itself to any jurisdiction.
+
+/// \file MemfdProtocol.h
+/// \brief Messages exchanged between readout and a local client process, to
+/// access data pages of a memfd memory bank without copy.
+/// \descr The messages are sent on a unix socket of type SOCK_SEQPACKET, one
+/// message per packet.
+/// - readout (server) sends a BankInfo message when a client connects. The
+/// read-only file descriptor of the bank is attached to it (SCM_RIGHTS), the
+/// client maps it to access the data.
+/// - readout sends a Page message for each new data page available: the
+/// data is at the given offset from the beginning of the bank mapping.
+/// - the client sends back a Release message (with the same pageId) when done
+/// with a page. The page can then be reused by readout.
+/// - readout sends an EndOfRun message when data taking stops. The pages not
+/// released by the client at this point are reused by readout, the client
+/// should not access them anymore.
+/// When the client disconnects, all the pages it did not release are released.
+
+#ifndef _MEMFDPROTOCOL_H
+#define _MEMFDPROTOCOL_H
+
+#include <stdint.h>
+
+namespace MemfdProtocol {
+
+const uint32_t protocolVersion = 1;
+
+enum MessageType : uint32_t {
+  BankInfo = 1, // description of the memory bank, with its file descriptor
+  Page = 2,     // a new data page is available
+  Release = 3,  // a data page is not used anymore by the client
+  EndOfRun = 4  // end of data taking
+};
+
+struct Message {
+  uint32_t type;        // one of MessageType
+  uint32_t version;     // protocol version
+  uint64_t pageId;      // Page, Release: page unique identifier
+  uint64_t offset;      // Page: offset of data from beginning of bank
+  uint64_t size;        // Page: size of data. BankInfo: size of bank.
+  uint64_t timeframeId; // Page: timeframe id of data
+  uint16_t equipmentId; // Page: equipment id of data
+  uint16_t linkId;      // Page: link id of data
+  uint32_t reserved;    // for future use, set to zero
+  char bankName[64];    // BankInfo: name of bank (NUL-terminated)
+};
+
+} // namespace MemfdProtocol
+
+#endif // #ifndef _MEMFDPROTOCOL_H
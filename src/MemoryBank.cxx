@@ -16,13 +16,55 @@
 #include <ReadoutCard/Exception.h>
 #include <ReadoutCard/MemoryMappedFile.h>
 #include <algorithm>
+#include <chrono>
+#include <errno.h>
+#include <fcntl.h>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <thread>
+#include <unistd.h>
 #include <utility>
 #include <vector>
 
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#ifdef WITH_NUMA
+#include <numa.h>
+#include <numaif.h>
+#endif
+
 #include <InfoLogger/InfoLogger.hxx>
 using namespace AliceO2::InfoLogger;
 extern InfoLogger theLog;
 
+// definitions which may be missing in older system headers
+#ifndef MAP_HUGE_SHIFT
+#define MAP_HUGE_SHIFT 26
+#endif
+#ifndef MFD_CLOEXEC
+#define MFD_CLOEXEC 0x0001U
+#endif
+#ifndef MFD_ALLOW_SEALING
+#define MFD_ALLOW_SEALING 0x0002U
+#endif
+#ifndef MFD_HUGETLB
+#define MFD_HUGETLB 0x0004U
+#endif
+#ifndef F_ADD_SEALS
+#define F_ADD_SEALS 1033
+#define F_SEAL_SEAL 0x0001
+#define F_SEAL_SHRINK 0x0002
+#define F_SEAL_GROW 0x0004
+#endif
+#ifndef F_SEAL_FUTURE_WRITE
+#define F_SEAL_FUTURE_WRITE 0x0010
+#endif
+
 /// generic base class
 
 MemoryBank::MemoryBank(std::string v_description) {
@@ -53,6 +95,307 @@ void MemoryBank::clear() {
   return;
 }
 
+// write zeroes in memory range, bypassing the cache if possible
+static void clearNonTemporal(char *ptr, size_t size) {
+#ifdef __SSE2__
+  // head, up to 16-byte boundary
+  size_t head = (16 - ((size_t)ptr % 16)) % 16;
+  if (head > size) {
+    head = size;
+  }
+  std::memset(ptr, 0, head);
+  ptr += head;
+  size -= head;
+  // aligned body, with streaming stores
+  __m128i zero = _mm_setzero_si128();
+  size_t nBlocks = size / 64;
+  for (size_t i = 0; i < nBlocks; i++) {
+    __m128i *p = (__m128i *)&ptr[i * 64];
+    _mm_stream_si128(&p[0], zero);
+    _mm_stream_si128(&p[1], zero);
+    _mm_stream_si128(&p[2], zero);
+    _mm_stream_si128(&p[3], zero);
+  }
+  _mm_sfence();
+  // tail
+  std::memset(&ptr[nBlocks * 64], 0, size - nBlocks * 64);
+#else
+  std::memset(ptr, 0, size);
+#endif
+}
+
+int MemoryBank::prefault(const std::string &mode, int nThreads,
+                         bool nonTemporal) {
+  int modeId = 0; // 0=zero, 1=touch
+  if (mode == "zero") {
+    modeId = 0;
+  } else if (mode == "touch") {
+    modeId = 1;
+  } else if (mode == "skip") {
+    theLog.log("Memory bank %s : prefault skipped", description.c_str());
+    return 0;
+  } else {
+    theLog.log(InfoLogger::Severity::Error,
+               "Memory bank %s : unknown prefault mode %s", description.c_str(),
+               mode.c_str());
+    return -1;
+  }
+  if ((baseAddress == nullptr) || (size == 0)) {
+    return 0;
+  }
+
+  // number of threads: by default, number of cores on the NUMA node (or
+  // machine), within limits
+  const int maxThreads = 16;
+  if (nThreads <= 0) {
+    nThreads = std::thread::hardware_concurrency();
+#ifdef WITH_NUMA
+    if ((numaNode >= 0) && (numa_available() >= 0)) {
+      struct bitmask *cpus = numa_allocate_cpumask();
+      if (cpus != nullptr) {
+        if (numa_node_to_cpus(numaNode, cpus) == 0) {
+          nThreads = numa_bitmask_weight(cpus);
+        }
+        numa_free_cpumask(cpus);
+      }
+    }
+#endif
+    if (nThreads > maxThreads) {
+      nThreads = maxThreads;
+    }
+  }
+  if (nThreads < 1) {
+    nThreads = 1;
+  }
+
+  // split range in chunks, aligned on huge page size
+  const size_t chunkAlign = 2 * 1024 * 1024;
+  size_t chunkSize = (size + nThreads - 1) / nThreads;
+  chunkSize = ((chunkSize + chunkAlign - 1) / chunkAlign) * chunkAlign;
+  size_t pageSize = getpagesize();
+
+  auto worker = [&](size_t begin, size_t end) {
+#ifdef WITH_NUMA
+    // allocate and execute on the node where memory is bound
+    if (numaNode >= 0) {
+      numa_run_on_node(numaNode);
+    }
+#endif
+    char *ptr = &((char *)baseAddress)[begin];
+    size_t sz = end - begin;
+    if (modeId == 1) {
+      for (size_t i = 0; i < sz; i += pageSize) {
+        ((volatile char *)ptr)[i] = 0;
+      }
+    } else if (nonTemporal) {
+      clearNonTemporal(ptr, sz);
+    } else {
+      std::memset(ptr, 0, sz);
+    }
+  };
+
+  auto t0 = std::chrono::steady_clock::now();
+  std::vector<std::thread> threads;
+  for (size_t begin = 0; begin < size; begin += chunkSize) {
+    size_t end = std::min(begin + chunkSize, size);
+    threads.push_back(std::thread(worker, begin, end));
+  }
+  for (auto &t : threads) {
+    t.join();
+  }
+  double t =
+      std::chrono::duration<double>(std::chrono::steady_clock::now() - t0)
+          .count();
+
+  double sizeGB = size / (1024.0 * 1024.0 * 1024.0);
+  theLog.log("Memory bank %s : prefault mode %s%s, %d threads, %.2f GB in "
+             "%.2fs = %.2f GB/s",
+             description.c_str(), mode.c_str(),
+             ((modeId == 0) && nonTemporal) ? " (non-temporal)" : "",
+             (int)threads.size(), sizeGB, t, (t > 0) ? sizeGB / t : 0.0);
+  return 0;
+}
+
+int MemoryBank::getNumaNode() { return numaNode; }
+
+int MemoryBank::getSharedFileDescriptor() { return -1; }
+
+int bindMemoryToNumaNode(void *address, size_t size, int node,
+                         bool strictMove, const std::string &description) {
+#ifdef WITH_NUMA
+  if ((numa_available() < 0) || (node < 0) || (node > numa_max_node())) {
+    theLog.log(InfoLogger::Severity::Error, "%s : invalid NUMA node %d",
+               description.c_str(), node);
+    return -1;
+  }
+  struct bitmask *nodemask = numa_allocate_nodemask();
+  if (nodemask == nullptr) {
+    return -1;
+  }
+  numa_bitmask_clearall(nodemask);
+  numa_bitmask_setbit(nodemask, node);
+  // bind range, and move pages already allocated elsewhere (if any)
+  unsigned int flags = MPOL_MF_MOVE;
+  if (strictMove) {
+    flags |= MPOL_MF_STRICT;
+  }
+  int err = mbind(address, size, MPOL_BIND, nodemask->maskp,
+                  nodemask->size + 1, flags);
+  numa_free_nodemask(nodemask);
+  if (err) {
+    theLog.log(InfoLogger::Severity::Error,
+               "%s : failed to bind to NUMA node %d: %s", description.c_str(),
+               node, strerror(errno));
+    return -1;
+  }
+  theLog.log("%s : %ld bytes @ %p bound to NUMA node %d", description.c_str(),
+             (long)size, address, node);
+  return 0;
+#else
+  (void)address;
+  (void)size;
+  (void)strictMove;
+  theLog.log(InfoLogger::Severity::Error,
+             "%s : NUMA support not available, can not bind to node %d",
+             description.c_str(), node);
+  return -1;
+#endif
+}
+
+int MemoryBank::bindToNumaNode(int node, bool strictMove) {
+  if (bindMemoryToNumaNode(baseAddress, size, node, strictMove,
+                           "Memory bank " + description)) {
+    return -1;
+  }
+  numaNode = node;
+  return 0;
+}
+
+int MemoryBank::checkNumaPlacement() {
+#ifdef WITH_NUMA
+  if ((baseAddress == nullptr) || (size == 0) || (numa_available() < 0)) {
+    return -1;
+  }
+  // query location of a sample of pages (up to 1024, evenly spaced)
+  const size_t maxSamples = 1024;
+  size_t pageSize = getpagesize();
+  size_t nPages = (size + pageSize - 1) / pageSize;
+  size_t step = 1;
+  if (nPages > maxSamples) {
+    step = nPages / maxSamples;
+  }
+  std::vector<void *> pages;
+  for (size_t i = 0; i < nPages; i += step) {
+    pages.push_back(&((char *)baseAddress)[i * pageSize]);
+  }
+  std::vector<int> status(pages.size(), -1);
+  if (move_pages(0, pages.size(), pages.data(), nullptr, status.data(), 0)) {
+    theLog.log(InfoLogger::Severity::Warning,
+               "Memory bank %s : failed to get NUMA placement: %s",
+               description.c_str(), strerror(errno));
+    return -1;
+  }
+  std::map<int, int> pagesPerNode; // number of pages found per node
+  int nUnknown = 0;                // pages not allocated yet, or error
+  for (auto st : status) {
+    if (st >= 0) {
+      pagesPerNode[st]++;
+    } else {
+      nUnknown++;
+    }
+  }
+  std::string placement;
+  for (auto &n : pagesPerNode) {
+    placement += " node " + std::to_string(n.first) + " = " +
+                 std::to_string(n.second * 100 / status.size()) + "%";
+  }
+  if (nUnknown) {
+    placement += " unknown = " + std::to_string(nUnknown * 100 / status.size()) +
+                 "%";
+  }
+  int actualNode = -1;
+  if ((pagesPerNode.size() == 1) && (nUnknown == 0)) {
+    actualNode = pagesPerNode.begin()->first;
+  }
+  if ((numaNode >= 0) && (actualNode != numaNode)) {
+    theLog.log(InfoLogger::Severity::Warning,
+               "Memory bank %s : NUMA node %d requested, pages found on%s",
+               description.c_str(), numaNode, placement.c_str());
+  } else {
+    theLog.log("Memory bank %s : pages found on%s", description.c_str(),
+               placement.c_str());
+  }
+  return actualNode;
+#else
+  return -1;
+#endif
+}
+
+int MemoryBank::checkHugePages() {
+  if (baseAddress == nullptr) {
+    return -1;
+  }
+  // look for the memory mapping containing the bank in /proc/self/smaps
+  std::ifstream smaps("/proc/self/smaps");
+  if (!smaps.is_open()) {
+    return -1;
+  }
+  bool found = false;
+  size_t kernelPageSize = 0; // kB
+  size_t rss = 0;            // kB
+  size_t hugeSize = 0;       // kB
+  std::string line;
+  while (std::getline(smaps, line)) {
+    unsigned long long vBegin, vEnd;
+    char dash;
+    std::istringstream is(line);
+    if ((line.find(':') == std::string::npos) ||
+        (line.find('-') < line.find(':'))) {
+      // header line of a mapping: begin-end perms ...
+      if ((is >> std::hex >> vBegin >> dash >> vEnd) && (dash == '-')) {
+        if (found) {
+          break; // end of our mapping
+        }
+        if (((size_t)baseAddress >= vBegin) && ((size_t)baseAddress < vEnd)) {
+          found = true;
+        }
+        continue;
+      }
+    }
+    if (!found) {
+      continue;
+    }
+    std::string key;
+    size_t value = 0;
+    if (!(is >> key >> value)) {
+      continue;
+    }
+    if (key == "KernelPageSize:") {
+      kernelPageSize = value;
+    } else if (key == "Rss:") {
+      rss = value;
+    } else if ((key == "AnonHugePages:") || (key == "Private_Hugetlb:") ||
+               (key == "Shared_Hugetlb:") || (key == "ShmemPmdMapped:")) {
+      hugeSize += value;
+    }
+  }
+  if (!found) {
+    return -1;
+  }
+  // hugetlb mappings have a big kernel page size, THP use PMD size (2MB)
+  size_t hugePageSize = 2048;
+  if (kernelPageSize > 4) {
+    hugePageSize = kernelPageSize;
+  }
+  int nHugePages = (int)(hugeSize / hugePageSize);
+  size_t sizeKb = size / 1024;
+  theLog.log("Memory bank %s : %d huge pages of %ld kB (%.1f%% of bank), rss "
+             "%ld kB",
+             description.c_str(), nHugePages, hugePageSize,
+             sizeKb ? hugeSize * 100.0 / sizeKb : 0.0, rss);
+  return nHugePages;
+}
+
 /// MemoryBank implementation with malloc()
 
 class MemoryBankMalloc : public MemoryBank {
@@ -61,6 +404,42 @@ public:
   ~MemoryBankMalloc();
 };
 
+/// MemoryBank implementation with anonymous mmap(), bound to a NUMA node
+/// used instead of malloc() when a NUMA node is specified, so that the memory
+/// is not shared with other allocations and can be bound before first access.
+
+class MemoryBankNuma : public MemoryBank {
+public:
+  MemoryBankNuma(size_t size, std::string description, int numaNode);
+  ~MemoryBankNuma();
+};
+
+MemoryBankNuma::MemoryBankNuma(size_t v_size, std::string v_description,
+                               int v_numaNode)
+    : MemoryBank(v_description) {
+  baseAddress = mmap(nullptr, v_size, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (baseAddress == MAP_FAILED) {
+    baseAddress = nullptr;
+    throw std::bad_alloc();
+  }
+  size = v_size;
+  if (v_description.length() == 0) {
+    description = "Bank NUMA";
+  }
+  if (bindToNumaNode(v_numaNode)) {
+    munmap(baseAddress, size);
+    baseAddress = nullptr;
+    throw __LINE__;
+  }
+}
+
+MemoryBankNuma::~MemoryBankNuma() {
+  if (baseAddress != nullptr) {
+    munmap(baseAddress, size);
+  }
+}
+
 MemoryBankMalloc::MemoryBankMalloc(size_t v_size, std::string v_description)
     : MemoryBank(v_description) {
   baseAddress = malloc(v_size);
@@ -79,10 +458,136 @@ MemoryBankMalloc::~MemoryBankMalloc() {
   }
 }
 
+/// MemoryBank implementation with anonymous memory mapping, using huge pages
+/// without the need of a hugetlbfs mount point.
+/// Tries explicit huge pages (MAP_HUGETLB, 1GB then 2MB pages), and falls
+/// back on transparent huge pages (madvise(MADV_HUGEPAGE)) if none available.
+
+class MemoryBankMemoryMappedAnonymous : public MemoryBank {
+public:
+  MemoryBankMemoryMappedAnonymous(size_t size, std::string description,
+                                  int numaNode = -1, bool populate = false,
+                                  bool lock = false);
+  ~MemoryBankMemoryMappedAnonymous();
+
+private:
+  void *mapAddress = nullptr; // beginning of memory mapping
+  size_t mapSize = 0;         // size of memory mapping
+};
+
+MemoryBankMemoryMappedAnonymous::MemoryBankMemoryMappedAnonymous(
+    size_t v_size, std::string v_description, int v_numaNode, bool v_populate,
+    bool v_lock)
+    : MemoryBank(v_description) {
+
+  const size_t hugePageSize2M = 2 * 1024 * 1024;
+  const size_t hugePageSize1G = 1024 * 1024 * 1024;
+  const int mapHuge2M = 21 << MAP_HUGE_SHIFT;
+  const int mapHuge1G = 30 << MAP_HUGE_SHIFT;
+
+  // pre-fault pages at mapping time only if there is no NUMA binding to do
+  // before, otherwise touch them after
+  int populateFlag = 0;
+  if ((v_populate) && (v_numaNode < 0)) {
+    populateFlag = MAP_POPULATE;
+  }
+
+  // try explicit huge pages, biggest first if size allows
+  std::string mode;
+  std::vector<std::pair<size_t, int>> hpt;
+  if (v_size % hugePageSize1G == 0) {
+    hpt.push_back({hugePageSize1G, mapHuge1G});
+  }
+  hpt.push_back({hugePageSize2M, mapHuge2M});
+  for (auto &h : hpt) {
+    size_t sz = ((v_size + h.first - 1) / h.first) * h.first;
+    void *ptr = mmap(nullptr, sz, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | h.second |
+                         populateFlag,
+                     -1, 0);
+    if (ptr != MAP_FAILED) {
+      mapAddress = ptr;
+      mapSize = sz;
+      baseAddress = ptr;
+      mode = "MAP_HUGETLB " + std::to_string(h.first / (1024 * 1024)) + "MB";
+      break;
+    }
+  }
+
+  // fallback: transparent huge pages
+  // map with some margin to align the range on a huge page boundary
+  if (mapAddress == nullptr) {
+    size_t sz = v_size + hugePageSize2M;
+    void *ptr = mmap(nullptr, sz, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (ptr == MAP_FAILED) {
+      theLog.log(InfoLogger::Severity::Error,
+                 "Memory bank %s : failed to map %ld bytes: %s",
+                 v_description.c_str(), v_size, strerror(errno));
+      throw std::bad_alloc();
+    }
+    mapAddress = ptr;
+    mapSize = sz;
+    size_t excess = ((size_t)ptr) % hugePageSize2M;
+    baseAddress = &((char *)ptr)[excess ? (hugePageSize2M - excess) : 0];
+    mode = "THP";
+    if (madvise(baseAddress, v_size, MADV_HUGEPAGE)) {
+      theLog.log(InfoLogger::Severity::Warning,
+                 "Memory bank %s : madvise(MADV_HUGEPAGE) failed: %s",
+                 v_description.c_str(), strerror(errno));
+      mode = "normal pages";
+    }
+    if (v_populate) {
+      populateFlag = 0; // not done at mapping time, do it below
+    }
+  }
+  size = v_size;
+  if (v_description.length() == 0) {
+    description = "Bank MemoryMappedAnonymous";
+  }
+  theLog.log("Memory bank %s : mapped %ld bytes using %s", description.c_str(),
+             size, mode.c_str());
+
+  // bind to NUMA node, if specified
+  if (v_numaNode >= 0) {
+    if (bindToNumaNode(v_numaNode)) {
+      munmap(mapAddress, mapSize);
+      mapAddress = nullptr;
+      throw __LINE__;
+    }
+  }
+
+  // allocate memory now, if not done at mapping time
+  if ((v_populate) && (populateFlag == 0)) {
+    size_t pageSize = getpagesize();
+    for (size_t i = 0; i < size; i += pageSize) {
+      ((volatile char *)baseAddress)[i] = 0;
+    }
+  }
+
+  // lock memory in RAM
+  if (v_lock) {
+    if (mlock(baseAddress, size)) {
+      theLog.log(InfoLogger::Severity::Warning,
+                 "Memory bank %s : mlock() failed: %s", description.c_str(),
+                 strerror(errno));
+    } else {
+      theLog.log("Memory bank %s : memory locked", description.c_str());
+    }
+  }
+}
+
+MemoryBankMemoryMappedAnonymous::~MemoryBankMemoryMappedAnonymous() {
+  if (mapAddress != nullptr) {
+    munmap(mapAddress, mapSize);
+  }
+}
+
 /// MemoryBank implementation with hugepages
 class MemoryBankMemoryMappedFile : public MemoryBank {
 public:
-  MemoryBankMemoryMappedFile(size_t size, std::string description);
+  MemoryBankMemoryMappedFile(size_t size, std::string description,
+                             int numaNode = -1);
   ~MemoryBankMemoryMappedFile();
 
 private:
@@ -90,7 +595,7 @@ private:
 };
 
 MemoryBankMemoryMappedFile::MemoryBankMemoryMappedFile(
-    size_t v_size, std::string v_description)
+    size_t v_size, std::string v_description, int v_numaNode)
     : MemoryBank(v_description) {
 
   // declare available huge page size types and path suffix
@@ -144,18 +649,190 @@ MemoryBankMemoryMappedFile::MemoryBankMemoryMappedFile(
   size = mMemoryMappedFile->getSize();
   baseAddress = (void *)mMemoryMappedFile->getAddress();
   description = v_description;
+
+  // bind to NUMA node, if specified
+  // The mapping is created (and possibly populated) by the ReadoutCard library,
+  // and huge pages already allocated may not be movable: they are left in
+  // place, and reported afterwards by checkNumaPlacement().
+  if (v_numaNode >= 0) {
+    if (bindToNumaNode(v_numaNode, false)) {
+      throw __LINE__;
+    }
+  }
 }
 
 MemoryBankMemoryMappedFile::~MemoryBankMemoryMappedFile() {}
 
+/// MemoryBank implementation with a memory file descriptor (memfd_create)
+/// The memory can be shared with other local processes, by passing them a
+/// read-only file descriptor (c.f. getSharedFileDescriptor()). The size of the
+/// file is sealed, and so is any write access other than the mapping of
+/// readout (F_SEAL_FUTURE_WRITE, Linux >= 5.1), so that the memory can not be
+/// modified through the shared descriptor. Huge pages are used if available.
+
+class MemoryBankMemfd : public MemoryBank {
+public:
+  MemoryBankMemfd(size_t size, std::string description, int numaNode = -1,
+                  bool populate = false, bool lock = false);
+  ~MemoryBankMemfd();
+
+  int getSharedFileDescriptor();
+
+private:
+  int fd = -1;         // the memory file descriptor (read-write)
+  int fdReadOnly = -1; // a read-only descriptor of the same memory, to share
+  size_t mapSize = 0;  // size of memory mapping
+};
+
+MemoryBankMemfd::MemoryBankMemfd(size_t v_size, std::string v_description,
+                                 int v_numaNode, bool v_populate, bool v_lock)
+    : MemoryBank(v_description) {
+
+  const size_t hugePageSize2M = 2 * 1024 * 1024;
+  if (v_description.length() == 0) {
+    description = "Bank memfd";
+  }
+  std::string fdName = "readout-" + description;
+
+  // map memory, populate at mapping time only if there is no NUMA binding to
+  // do before, otherwise touch pages after
+  int populateFlag = 0;
+  if ((v_populate) && (v_numaNode < 0)) {
+    populateFlag = MAP_POPULATE;
+  }
+
+  // try huge pages first, if size allows, then normal pages
+  // memfd_create() called with syscall(), as not available in older libc
+  std::vector<std::pair<unsigned int, std::string>> modes;
+  if (v_size % hugePageSize2M == 0) {
+    modes.push_back({MFD_HUGETLB, "huge pages"});
+  }
+  modes.push_back({0, "normal pages"});
+  std::string mode;
+  void *ptr = MAP_FAILED;
+  mapSize = v_size;
+  for (auto &m : modes) {
+    fd = syscall(SYS_memfd_create, fdName.c_str(),
+                 MFD_CLOEXEC | MFD_ALLOW_SEALING | m.first);
+    if (fd < 0) {
+      continue;
+    }
+    if (ftruncate(fd, mapSize) == 0) {
+      ptr = mmap(nullptr, mapSize, PROT_READ | PROT_WRITE,
+                 MAP_SHARED | populateFlag, fd, 0);
+      if (ptr != MAP_FAILED) {
+        mode = m.second;
+        break;
+      }
+    }
+    close(fd);
+    fd = -1;
+  }
+  if (ptr == MAP_FAILED) {
+    theLog.log(InfoLogger::Severity::Error,
+               "Memory bank %s : failed to create memfd of %ld bytes: %s",
+               description.c_str(), mapSize, strerror(errno));
+    throw std::bad_alloc();
+  }
+
+  // make size immutable
+  if (fcntl(fd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW)) {
+    theLog.log(InfoLogger::Severity::Warning,
+               "Memory bank %s : failed to seal memfd: %s",
+               description.c_str(), strerror(errno));
+  }
+  // now that our own mapping exists, forbid any new write access (writable
+  // mapping or write()), so that receivers can not modify the data, even by
+  // reopening the shared descriptor read-write
+  if (fcntl(fd, F_ADD_SEALS, F_SEAL_FUTURE_WRITE)) {
+    theLog.log(InfoLogger::Severity::Warning,
+               "Memory bank %s : failed to seal memfd for writing (%s), "
+               "receivers may be able to modify the shared memory",
+               description.c_str(), strerror(errno));
+  }
+  fcntl(fd, F_ADD_SEALS, F_SEAL_SEAL);
+
+  // read-only descriptor of the same file, to be shared
+  std::string fdPath = "/proc/self/fd/" + std::to_string(fd);
+  fdReadOnly = open(fdPath.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fdReadOnly < 0) {
+    theLog.log(InfoLogger::Severity::Error,
+               "Memory bank %s : failed to open read-only memfd: %s",
+               description.c_str(), strerror(errno));
+    munmap(ptr, mapSize);
+    close(fd);
+    throw __LINE__;
+  }
+  baseAddress = ptr;
+  size = v_size;
+  theLog.log("Memory bank %s : memfd of %ld bytes mapped using %s",
+             description.c_str(), size, mode.c_str());
+
+  // bind to NUMA node, if specified
+  if (v_numaNode >= 0) {
+    if (bindToNumaNode(v_numaNode)) {
+      munmap(baseAddress, mapSize);
+      close(fdReadOnly);
+      close(fd);
+      baseAddress = nullptr;
+      throw __LINE__;
+    }
+  }
+
+  // allocate memory now, if not done at mapping time
+  if ((v_populate) && (populateFlag == 0)) {
+    size_t pageSize = getpagesize();
+    for (size_t i = 0; i < size; i += pageSize) {
+      ((volatile char *)baseAddress)[i] = 0;
+    }
+  }
+
+  // lock memory in RAM
+  if (v_lock) {
+    if (mlock(baseAddress, size)) {
+      theLog.log(InfoLogger::Severity::Warning,
+                 "Memory bank %s : mlock() failed: %s", description.c_str(),
+                 strerror(errno));
+    } else {
+      theLog.log("Memory bank %s : memory locked", description.c_str());
+    }
+  }
+}
+
+MemoryBankMemfd::~MemoryBankMemfd() {
+  if (baseAddress != nullptr) {
+    munmap(baseAddress, mapSize);
+  }
+  if (fdReadOnly >= 0) {
+    close(fdReadOnly);
+  }
+  if (fd >= 0) {
+    close(fd);
+  }
+}
+
+int MemoryBankMemfd::getSharedFileDescriptor() { return fdReadOnly; }
+
 /// MemoryBank factory based on type
 std::shared_ptr<MemoryBank> getMemoryBank(size_t size, std::string type,
-                                          std::string description) {
+                                          std::string description,
+                                          int numaNode, bool populate,
+                                          bool lock) {
 
   if (type == "malloc") {
+    if (numaNode >= 0) {
+      return std::make_shared<MemoryBankNuma>(size, description, numaNode);
+    }
     return std::make_shared<MemoryBankMalloc>(size, description);
   } else if (type == "MemoryMappedFile") {
-    return std::make_shared<MemoryBankMemoryMappedFile>(size, description);
+    return std::make_shared<MemoryBankMemoryMappedFile>(size, description,
+                                                        numaNode);
+  } else if (type == "MemoryMappedAnonymous") {
+    return std::make_shared<MemoryBankMemoryMappedAnonymous>(
+        size, description, numaNode, populate, lock);
+  } else if (type == "memfd") {
+    return std::make_shared<MemoryBankMemfd>(size, description, numaNode,
+                                             populate, lock);
   }
   return nullptr;
 }
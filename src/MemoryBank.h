@@ -37,21 +37,73 @@ public:
 
   void clear(); // write zeroes into the whole memory range
 
+  // allocate the memory pages of the bank, using several threads in parallel
+  // (pinned on the NUMA node of the bank, if defined). Rate is logged.
+  // mode: zero (write zeroes into the whole memory range), touch (write one
+  // byte per page), skip (do nothing).
+  // nThreads: number of threads to use. If 0, set automatically.
+  // nonTemporal: if set, use non-temporal stores to write zeroes (bypass cache)
+  // returns 0 on success, -1 on error
+  int prefault(const std::string &mode, int nThreads = 0,
+               bool nonTemporal = false);
+
+  // check on which NUMA node(s) the memory pages of the bank are, and log it.
+  // Pages should have been accessed before (e.g. with clear()).
+  // Returns the node where all pages are, or -1 if unknown or mixed.
+  int checkNumaPlacement();
+
+  int getNumaNode(); // get the NUMA node requested for this bank (-1 if none)
+
+  // check how much of the bank memory is backed by huge pages, and log it.
+  // Pages should have been accessed before (e.g. with clear()).
+  // Returns the number of huge pages found, or -1 on error.
+  int checkHugePages();
+
+  // get a file descriptor of the bank memory, which can be passed to other
+  // processes (e.g. with SCM_RIGHTS) to map it read-only.
+  // Returns -1 if not available for this type of bank.
+  virtual int getSharedFileDescriptor();
+
 protected:
   void *baseAddress;       // base address (virtual) of buffer
   std::size_t size;        // size of buffer, in bytes
   std::string description; // description of the memory bank (type/sypport, etc)
+  int numaNode = -1;       // NUMA node where memory is bound (-1 if none)
+
+  // bind memory range of the bank to given NUMA node. Returns 0 on success.
+  // If strictMove is set, it fails if pages already allocated can not be
+  // moved to the node. Otherwise, they may stay where they are (this is
+  // reported by checkNumaPlacement()).
+  int bindToNumaNode(int node, bool strictMove = true);
   ReleaseCallback
       releaseCallback; // an optional user-callback to be called in destructor,
                        // when overloaded constructor has been used
 };
 
+// bind a memory range to a NUMA node (MPOL_BIND). Pages already allocated
+// elsewhere are moved. If strictMove is set, it fails if some pages can not be
+// moved. description: prefix used in logs.
+// Returns 0 on success, -1 on error (or if no NUMA support).
+int bindMemoryToNumaNode(void *address, size_t size, int node,
+                         bool strictMove, const std::string &description);
+
 // factory function to create a MemoryBank instance of a given type
 // size: size of the bank, in bytes
 // support: type of support to be used. Available choices: malloc,
-// MemoryMappedFile description: optional description for the memory bank
+// MemoryMappedFile, MemoryMappedAnonymous, memfd
+// description: optional description for the memory bank
+// numaNode: NUMA node where the memory should be allocated. -1 if unspecified.
+// When set, the memory range is bound to the node (mbind), before it is
+// accessed, without changing the memory policy of the process.
+// populate: if set, memory is allocated immediately (MemoryMappedAnonymous,
+// memfd).
+// lock: if set, memory is locked in RAM with mlock() (MemoryMappedAnonymous,
+// memfd).
 
 std::shared_ptr<MemoryBank> getMemoryBank(size_t size, std::string support,
-                                          std::string description = "");
+                                          std::string description = "",
+                                          int numaNode = -1,
+                                          bool populate = false,
+                                          bool lock = false);
 
 #endif // #ifndef _MEMORYBANKMANAGER_H
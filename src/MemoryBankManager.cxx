@@ -28,7 +28,7 @@ int MemoryBankManager::addBank(std::shared_ptr<MemoryBank> bankPtr,
     if (name.length() == 0) {
       name = bankPtr->getDescription();
     }
-    banks.push_back({name, bankPtr, {}});
+    banks.push_back({name, bankPtr, {}, ++bankIdCounter});
   } catch (...) {
     return -1;
   }
@@ -39,12 +39,14 @@ int MemoryBankManager::addBank(std::shared_ptr<MemoryBank> bankPtr,
 std::shared_ptr<MemoryPagesPool>
 MemoryBankManager::getPagedPool(size_t pageSize, size_t pageNumber,
                                 std::string bankName, size_t firstPageOffset,
-                                size_t blockAlign) {
+                                size_t blockAlign,
+                                MemoryPagesPool::FifoType fifoType) {
 
   void *baseAddress =
       nullptr;          // base address of bank from which the block is taken
   size_t offset = 0;    // offset of new block (relative to baseAddress)
   size_t blockSize = 0; // size of new block (in bytes)
+  uint64_t bankId = 0;  // id of bank from which the block is taken
 
   // disable concurrent execution of this block
   // automatic release of lock when going out of scope
@@ -89,49 +91,173 @@ MemoryBankManager::getPagedPool(size_t pageSize, size_t pageNumber,
 
     // reserve space from big block
     baseAddress = banks[ix].bank->getBaseAddress();
-    offset = 0;
-    blockSize = pageSize * pageNumber; // this is the maximum space to use...
-                                       // may loose some pages for alignment
-
-    // alloc new block after existing ranges already in use
-    for (auto it = banks[ix].rangesInUse.begin();
-         it != banks[ix].rangesInUse.end(); ++it) {
-      size_t maxOffset = it->offset + it->size;
-      if (maxOffset > offset) {
-        offset = maxOffset;
+    bankId = banks[ix].bankId;
+    size_t bankSize = banks[ix].bank->getSize();
+    size_t maxBlockSize = pageSize * pageNumber; // this is the maximum space to
+                                                 // use... may loose some pages
+                                                 // for alignment
+
+    // look for first free range big enough for new block
+    // free ranges are the gaps between the (sorted) ranges in use
+    auto &ranges = banks[ix].rangesInUse;
+    bool rangeFound = false;
+    size_t rangeBegin = 0; // beginning of current free range
+    size_t rangeIx;        // index of first range in use after free range
+    for (rangeIx = 0; rangeIx <= ranges.size(); rangeIx++) {
+      size_t rangeEnd =
+          (rangeIx < ranges.size()) ? ranges[rangeIx].offset : bankSize;
+      offset = rangeBegin;
+      blockSize = maxBlockSize;
+
+      // align beginning of block as specified
+      if (blockAlign > 0) {
+        size_t bytesExcess = (((size_t)baseAddress) + offset) % blockAlign;
+        if (bytesExcess) {
+          size_t alignOffset = blockAlign - bytesExcess;
+          offset += alignOffset; // advance to next aligned address
+          if (alignOffset >= blockSize) {
+            blockSize = 0;
+          } else {
+            blockSize -=
+                alignOffset; // decrease block size to respect initial limit
+          }
+        }
       }
-    }
 
-    // align beginning of block as specified
-    if (blockAlign > 0) {
-      size_t bytesExcess = (((size_t)baseAddress) + offset) % blockAlign;
-      if (bytesExcess) {
-        size_t alignOffset = blockAlign - bytesExcess;
-        offset += alignOffset; // advance to next aligned address
-        blockSize -=
-            alignOffset; // decrease block size to respect initial limit
+      // check it fits in free range
+      if ((blockSize > 0) && (offset + blockSize <= rangeEnd)) {
+        rangeFound = true;
+        break;
+      }
+      if (rangeIx < ranges.size()) {
+        rangeBegin = ranges[rangeIx].offset + ranges[rangeIx].size;
       }
     }
 
-    // check not exceeding bank size
-    if (offset + blockSize > banks[ix].bank->getSize()) {
-      theLog.log(
-          InfoLogger::Severity::Error,
-          "Not enough space left in memory bank '%s' (need %ld bytes more)",
-          banks[ix].name.c_str(),
-          offset + blockSize - banks[ix].bank->getSize());
+    if (!rangeFound) {
+      bankUsage usage;
+      getBankUsage(banks[ix], usage);
+      theLog.log(InfoLogger::Severity::Error,
+                 "Not enough space left in memory bank '%s' (need %ld bytes, "
+                 "%ld bytes free, largest free range %ld bytes)",
+                 banks[ix].name.c_str(), maxBlockSize, usage.bytesFree,
+                 usage.largestFreeRange);
       throw std::bad_alloc();
     }
 
     // keep track of this new block
-    banks[ix].rangesInUse.push_back({offset, blockSize});
+    ranges.insert(ranges.begin() + rangeIx, {offset, blockSize});
   }
   // end of locked block
 
   // create pool of pages from new block
-  return std::make_shared<MemoryPagesPool>(pageSize, pageNumber,
-                                           &(((char *)baseAddress)[offset]),
-                                           blockSize, nullptr, firstPageOffset);
+  // the block is given back to the bank when the pool is destroyed
+  auto releaseCallback = [this, bankId, offset](void *) -> void {
+    this->releaseRange(bankId, offset);
+  };
+  std::shared_ptr<MemoryPagesPool> pool;
+  try {
+    pool = std::make_shared<MemoryPagesPool>(
+        pageSize, pageNumber, &(((char *)baseAddress)[offset]), blockSize,
+        releaseCallback, firstPageOffset, fifoType);
+  } catch (...) {
+    releaseRange(bankId, offset);
+    throw;
+  }
+  return pool;
+}
+
+std::shared_ptr<MemoryPagesPoolSizeClasses>
+MemoryBankManager::getPagedPoolSizeClasses(
+    std::vector<std::pair<size_t, size_t>> &sizeClasses, std::string bankName,
+    size_t blockAlign) {
+  // create one pool per size class
+  // pools already created are released automatically if one fails
+  std::vector<std::shared_ptr<MemoryPagesPool>> pools;
+  for (auto &c : sizeClasses) {
+    auto mp = getPagedPool(c.first, c.second, bankName, 0, blockAlign);
+    if (mp == nullptr) {
+      return nullptr;
+    }
+    pools.push_back(mp);
+  }
+  return std::make_shared<MemoryPagesPoolSizeClasses>(pools);
+}
+
+std::shared_ptr<MemoryBank> MemoryBankManager::getBank(std::string bankName) {
+  std::unique_lock<std::mutex> lock(bankMutex);
+  for (auto &b : banks) {
+    if ((bankName.size() == 0) || (b.name == bankName)) {
+      return b.bank;
+    }
+  }
+  return nullptr;
+}
+
+void MemoryBankManager::releaseRange(uint64_t bankId, size_t offset) {
+  std::unique_lock<std::mutex> lock(bankMutex);
+  for (auto &b : banks) {
+    if (b.bankId != bankId) {
+      continue;
+    }
+    for (auto it = b.rangesInUse.begin(); it != b.rangesInUse.end(); ++it) {
+      if (it->offset == offset) {
+        b.rangesInUse.erase(it);
+        return;
+      }
+    }
+    return;
+  }
+  // bank not found: it was already released
+}
+
+void MemoryBankManager::getBankUsage(bankDescriptor &b, bankUsage &usage) {
+  usage.name = b.name;
+  usage.size = b.bank->getSize();
+  usage.bytesInUse = 0;
+  usage.bytesFree = 0;
+  usage.largestFreeRange = 0;
+  usage.numberOfRangesInUse = b.rangesInUse.size();
+  usage.numberOfFreeRanges = 0;
+  size_t rangeBegin = 0;
+  for (size_t i = 0; i <= b.rangesInUse.size(); i++) {
+    size_t rangeEnd =
+        (i < b.rangesInUse.size()) ? b.rangesInUse[i].offset : usage.size;
+    if (rangeEnd > rangeBegin) {
+      size_t freeSize = rangeEnd - rangeBegin;
+      usage.bytesFree += freeSize;
+      usage.numberOfFreeRanges++;
+      if (freeSize > usage.largestFreeRange) {
+        usage.largestFreeRange = freeSize;
+      }
+    }
+    if (i < b.rangesInUse.size()) {
+      usage.bytesInUse += b.rangesInUse[i].size;
+      rangeBegin = b.rangesInUse[i].offset + b.rangesInUse[i].size;
+    }
+  }
+}
+
+int MemoryBankManager::getBanksUsage(std::vector<bankUsage> &usage) {
+  std::unique_lock<std::mutex> lock(bankMutex);
+  usage.clear();
+  for (auto &b : banks) {
+    bankUsage u;
+    getBankUsage(b, u);
+    usage.push_back(u);
+  }
+  return 0;
+}
+
+void MemoryBankManager::logBanksUsage() {
+  std::vector<bankUsage> usage;
+  getBanksUsage(usage);
+  for (auto &u : usage) {
+    theLog.log("Bank %s: %ld bytes, %ld in use (%ld ranges), %ld free (%ld "
+               "ranges, largest %ld)",
+               u.name.c_str(), u.size, u.bytesInUse, u.numberOfRangesInUse,
+               u.bytesFree, u.numberOfFreeRanges, u.largestFreeRange);
+  }
 }
 
 // a global MemoryBankManager instance
@@ -155,6 +281,11 @@ void MemoryBankManager::reset() {
     int useCount = it.bank.use_count();
     theLog.log("Releasing bank %s%s", it.name.c_str(),
                (useCount == 1) ? "" : "warning - still in use elsewhere !");
+    if (it.rangesInUse.size()) {
+      theLog.log(InfoLogger::Severity::Warning,
+                 "Bank %s: %d memory pools not released",
+                 it.name.c_str(), (int)it.rangesInUse.size());
+    }
   }
   banks.clear();
 }
@@ -20,6 +20,7 @@
 
 #include "MemoryBank.h"
 #include "MemoryPagesPool.h"
+#include "MemoryPagesPoolSizeClasses.h"
 #include <map>
 #include <memory>
 #include <mutex>
@@ -44,13 +45,27 @@ public:
   // - firstPageOffset: to control alignment of first page in pool. With zero,
   // start from beginning of big block.
   // - blockAlign: alignment of beginning of big memory block from which pool is
-  // created. Pool will start at a multiple of this value. NB: trivial
-  // implementation, once a region from a bank has been used, it can not be
-  // reused after the corresponding pool of pages has been release
-  //    ... don't want to deal with fragmentation etc
+  // created. Pool will start at a multiple of this value.
+  // The region is taken from the first free range of the bank big enough
+  // (first-fit), and is given back to the bank when the pool is destroyed.
+  // - fifoType: type of fifo used by the pool to keep track of free pages.
   std::shared_ptr<MemoryPagesPool>
   getPagedPool(size_t pageSize, size_t pageNumber, std::string bankName = "",
-               size_t firstPageOffset = 0, size_t blockAlign = 0);
+               size_t firstPageOffset = 0, size_t blockAlign = 0,
+               MemoryPagesPool::FifoType fifoType = MemoryPagesPool::MPMC);
+
+  // get a set of pools of pages with different page sizes, using the banks
+  // available
+  // parameters:
+  // - sizeClasses: list of (pageSize, numberOfPages) for each pool
+  // - bankName, blockAlign: c.f. getPagedPool()
+  std::shared_ptr<MemoryPagesPoolSizeClasses>
+  getPagedPoolSizeClasses(std::vector<std::pair<size_t, size_t>> &sizeClasses,
+                          std::string bankName = "", size_t blockAlign = 0);
+
+  // get a bank by name (or the first one if name not specified)
+  // returns nullptr if not found
+  std::shared_ptr<MemoryBank> getBank(std::string bankName = "");
 
   // a struct to define a memory range
   struct memoryRange {
@@ -65,12 +80,30 @@ public:
     std::shared_ptr<MemoryBank> bank; // reference to bank instance
     std::vector<memoryRange>
         rangesInUse; // list of ranges (with reference to bank base address)
-                     // currently used in the bank
+                     // currently used in the bank, sorted by offset
+    uint64_t bankId; // unique id, to identify bank when releasing ranges
   };
 
   // get list of memory regions currently registered
   int getMemoryRegions(std::vector<memoryRange> &ranges);
 
+  // a struct to report usage and fragmentation of a bank
+  struct bankUsage {
+    std::string name;           // bank name
+    size_t size;                // bank size (bytes)
+    size_t bytesInUse;          // total size of ranges in use (bytes)
+    size_t bytesFree;           // total size of free ranges (bytes)
+    size_t largestFreeRange;    // size of biggest free range (bytes)
+    size_t numberOfRangesInUse; // number of ranges in use
+    size_t numberOfFreeRanges;  // number of free ranges
+  };
+
+  // get usage of all banks
+  int getBanksUsage(std::vector<bankUsage> &usage);
+
+  // print usage of all banks in log
+  void logBanksUsage();
+
   // reset bank manager in fresh state, in particular: clear all banks
   void reset();
 
@@ -78,6 +111,13 @@ private:
   std::vector<bankDescriptor> banks; // list of registered memory banks
   std::mutex
       bankMutex; // instance mutex to handle concurrent access to public methods
+  uint64_t bankIdCounter = 0; // counter to assign unique bank ids
+
+  // give back to a bank a range previously allocated with getPagedPool()
+  void releaseRange(uint64_t bankId, size_t offset);
+
+  // compute usage of a bank. To be called with lock held.
+  void getBankUsage(bankDescriptor &b, bankUsage &usage);
 };
 
 // a global MemoryBankManager instance
@@ -9,12 +9,313 @@
 // or submit itself to any jurisdiction.
 
 #include "MemoryPagesPool.h"
+#include "MemoryBank.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <errno.h>
+#include <mutex>
+#include <string.h>
+#include <unistd.h>
+#include <vector>
+
+#ifdef WITH_NUMA
+#include <numa.h>
+#include <numaif.h>
+#endif
+
+#include <InfoLogger/InfoLogger.hxx>
+using namespace AliceO2::InfoLogger;
+extern InfoLogger theLog;
+
+// shared list of free pages
+struct MemoryPagesPool::SharedFreePages {
+  SharedFreePages(size_t size) : fifo(size) {}
+  FifoMPMC<void *> fifo; // the free pages
+  std::atomic<size_t> pagesInThreadCaches{
+      0}; // number of free pages kept in thread caches
+};
+
+// unique pool id generator, so that thread caches of a destroyed pool are
+// never confused with a new pool created at the same address
+static std::atomic<uint64_t> poolIdCounter(0);
+
+// tracking information of the pages of a pool
+struct MemoryPagesPool::PageTracker {
+  PageTracker(size_t numberOfPages, const std::string &vName)
+      : name(vName), pages(std::make_unique<PageInfo[]>(numberOfPages)) {}
+
+  // state of a page
+  struct PageInfo {
+    std::atomic<uint64_t> timeAcquired{0}; // when page given, 0 if not in use
+    std::atomic<uint64_t> timeStage{0};    // when page entered current stage
+    std::atomic<int> stage{-1};            // current stage, -1 if not in use
+  };
+
+  // histogram of time spent in a stage
+  // bin 0 is for t < 1us, bin i for 2^(i-1) <= t < 2^i us
+  static const int numberOfBins = 40;
+  struct TimeHistogram {
+    std::atomic<uint64_t> bins[numberOfBins] = {};
+    std::atomic<uint64_t> count{0};
+    std::atomic<uint64_t> sum{0}; // in nanoseconds
+    std::atomic<uint64_t> max{0}; // in nanoseconds
+
+    void fill(uint64_t t) {
+      uint64_t us = t / 1000;
+      int bin = 0;
+      while ((us > 0) && (bin < numberOfBins - 1)) {
+        us >>= 1;
+        bin++;
+      }
+      bins[bin].fetch_add(1, std::memory_order_relaxed);
+      count.fetch_add(1, std::memory_order_relaxed);
+      sum.fetch_add(t, std::memory_order_relaxed);
+      uint64_t m = max.load(std::memory_order_relaxed);
+      while ((t > m) &&
+             !max.compare_exchange_weak(m, t, std::memory_order_relaxed)) {
+      }
+    }
+
+    // upper bound of the bin containing the given fraction of entries,
+    // in seconds
+    double getQuantile(double fraction) {
+      uint64_t n = count.load(std::memory_order_relaxed);
+      uint64_t threshold = (uint64_t)(n * fraction);
+      uint64_t sumBins = 0;
+      for (int i = 0; i < numberOfBins; i++) {
+        sumBins += bins[i].load(std::memory_order_relaxed);
+        if (sumBins > threshold) {
+          return (1ULL << i) / 1000000.0;
+        }
+      }
+      return (1ULL << (numberOfBins - 1)) / 1000000.0;
+    }
+  };
+
+  std::string name;                     // name used in reports
+  std::unique_ptr<PageInfo[]> pages;    // info for each page
+  TimeHistogram stages[numberOfPageStages]; // time spent in each stage
+  TimeHistogram total;                  // total time in use
+};
+
+// current time, in nanoseconds
+static inline uint64_t getTrackingTime() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+// a list of pools, to find the owner of a page
+// The address range of each pool is kept in the list: a lookup only accesses
+// the pool owning the page, which exists as long as the page is in use. Other
+// pools can be removed and destroyed while lookups are done by other threads.
+// Each slot has a sequence number (odd while the slot is updated), so that a
+// lookup reads a consistent set of pool and range without locking.
+struct MemoryPagesPoolRegistry {
+  static const int maxPools = 64;
+  struct Slot {
+    std::atomic<uint64_t> sequence{0};            // odd while being updated
+    std::atomic<MemoryPagesPool *> pool{nullptr}; // pool, nullptr if free
+    std::atomic<uintptr_t> firstPage{0};          // address of first page
+    std::atomic<uintptr_t> lastPage{0};           // address of last page
+  };
+  Slot slots[maxPools];
+  std::atomic<int> indexMax{0}; // upper bound of used slots
+  std::mutex updateMutex;       // serializes add(), remove() and iterations
+
+  // add a pool. Returns 0 on success, -1 if list full
+  int add(MemoryPagesPool *pool, void *firstPage, void *lastPage) {
+    std::unique_lock<std::mutex> lock(updateMutex);
+    for (int i = 0; i < maxPools; i++) {
+      if (slots[i].pool.load(std::memory_order_relaxed) == nullptr) {
+        update(slots[i], pool, (uintptr_t)firstPage, (uintptr_t)lastPage);
+        if (indexMax.load(std::memory_order_relaxed) < i + 1) {
+          indexMax.store(i + 1, std::memory_order_release);
+        }
+        return 0;
+      }
+    }
+    return -1;
+  }
+
+  // remove a pool. After return, lookups can not return it anymore.
+  void remove(MemoryPagesPool *pool) {
+    std::unique_lock<std::mutex> lock(updateMutex);
+    for (int i = 0; i < maxPools; i++) {
+      if (slots[i].pool.load(std::memory_order_relaxed) == pool) {
+        update(slots[i], nullptr, 0, 0);
+      }
+    }
+  }
+
+  // get the pool owning a page, or nullptr
+  MemoryPagesPool *find(void *page) {
+    uintptr_t address = (uintptr_t)page;
+    int iMax = indexMax.load(std::memory_order_acquire);
+    for (int i = 0; i < iMax; i++) {
+      Slot &s = slots[i];
+      for (;;) {
+        uint64_t sequence = s.sequence.load(std::memory_order_acquire);
+        MemoryPagesPool *p = s.pool.load(std::memory_order_relaxed);
+        uintptr_t firstPage = s.firstPage.load(std::memory_order_relaxed);
+        uintptr_t lastPage = s.lastPage.load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if ((sequence & 1) ||
+            (s.sequence.load(std::memory_order_relaxed) != sequence)) {
+          continue; // slot being updated, read again
+        }
+        if ((p != nullptr) && (address >= firstPage) && (address <= lastPage)) {
+          // page in range: p is the owner, safe to access
+          return p->isPageValid(page) ? p : nullptr;
+        }
+        break;
+      }
+    }
+    return nullptr;
+  }
+
+  // call a function for each pool. Pools can not be removed meanwhile.
+  template <class F> void forEach(F f) {
+    std::unique_lock<std::mutex> lock(updateMutex);
+    for (int i = 0; i < maxPools; i++) {
+      MemoryPagesPool *p = slots[i].pool.load(std::memory_order_relaxed);
+      if (p != nullptr) {
+        f(p);
+      }
+    }
+  }
+
+private:
+  // set content of a slot, to be called with updateMutex held
+  void update(Slot &s, MemoryPagesPool *pool, uintptr_t firstPage,
+              uintptr_t lastPage) {
+    uint64_t sequence = s.sequence.load(std::memory_order_relaxed);
+    s.sequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    s.pool.store(pool, std::memory_order_relaxed);
+    s.firstPage.store(firstPage, std::memory_order_relaxed);
+    s.lastPage.store(lastPage, std::memory_order_relaxed);
+    s.sequence.store(sequence + 2, std::memory_order_release);
+  }
+};
+static MemoryPagesPoolRegistry trackedPools; // pools with tracking enabled
+static MemoryPagesPoolRegistry cachedPools;  // pools with page cache enabled
+
+namespace {
+
+// a per-thread cache of free pages for a given pool
+struct ThreadMagazine {
+  uint64_t poolId; // pool id owning the pages
+  std::weak_ptr<MemoryPagesPool::SharedFreePages>
+      freePages;              // where to give back the pages
+  std::vector<void *> pages;  // pages currently cached
+  size_t pagesPublished = 0;  // number of cached pages accounted in
+                              // freePages->pagesInThreadCaches
+  MemoryPagesPool::SharedFreePages *freePagesPtr; // fast access, valid while
+                                                  // the pool exists
+
+  // move n pages (or all if n=0) to the shared list
+  void flush(MemoryPagesPool::SharedFreePages *f, size_t n = 0) {
+    if ((n == 0) || (n > pages.size())) {
+      n = pages.size();
+    }
+    for (size_t i = 0; i < n; i++) {
+      f->fifo.push(pages.back());
+      pages.pop_back();
+    }
+    publish(f);
+  }
+
+  // update the number of cached pages accounted in the shared list
+  void publish(MemoryPagesPool::SharedFreePages *f) {
+    f->pagesInThreadCaches += pages.size() - pagesPublished;
+    pagesPublished = pages.size();
+  }
+};
+
+// all the magazines of a thread, one per pool used
+// pages are given back to their pool on thread exit
+struct ThreadCache {
+  std::vector<ThreadMagazine> magazines;
+  ~ThreadCache() {
+    for (auto &m : magazines) {
+      auto f = m.freePages.lock();
+      if (f != nullptr) {
+        m.flush(f.get());
+      }
+    }
+  }
+};
+
+thread_local ThreadCache threadCache;
+
+// allocator used to create the DataBlockContainer of a page
+// it returns the storage slot reserved for this page (or falls back to heap if
+// slot too small for the object), and puts back the page in the pool when the
+// storage is released, i.e. after the container is destroyed.
+// isAllocated is set when storage is handed out: from then on, the page is
+// released by deallocate(), also if construction fails. It should be valid
+// until the container is created (allocate() is called only then).
+template <class T> class PageContainerAllocator {
+public:
+  using value_type = T;
+
+  PageContainerAllocator(MemoryPagesPool *vPool, void *vPage, void *vSlot,
+                         size_t vSlotSize, bool *vIsAllocated)
+      : pool(vPool), page(vPage), slot(vSlot), slotSize(vSlotSize),
+        isAllocated(vIsAllocated) {}
+  template <class U>
+  PageContainerAllocator(const PageContainerAllocator<U> &a)
+      : pool(a.pool), page(a.page), slot(a.slot), slotSize(a.slotSize),
+        isAllocated(a.isAllocated) {}
+
+  T *allocate(size_t n) {
+    T *ptr = (T *)slot;
+    if ((n * sizeof(T) > slotSize) || (alignof(T) > 64)) {
+      ptr = (T *)::operator new(n * sizeof(T));
+    }
+    *isAllocated = true;
+    return ptr;
+  }
+
+  void deallocate(T *ptr, size_t n) {
+    if ((void *)ptr != slot) {
+      ::operator delete(ptr);
+    }
+    pool->releasePage(page);
+  }
+
+  MemoryPagesPool *pool; // pool owning the page
+  void *page;            // the page associated to the container
+  void *slot;            // storage reserved for the container
+  size_t slotSize;       // size of storage
+  bool *isAllocated;     // set when storage handed out
+};
+
+template <class T, class U>
+bool operator==(const PageContainerAllocator<T> &a,
+                const PageContainerAllocator<U> &b) {
+  return a.slot == b.slot;
+}
+template <class T, class U>
+bool operator!=(const PageContainerAllocator<T> &a,
+                const PageContainerAllocator<U> &b) {
+  return a.slot != b.slot;
+}
+
+} // namespace
 
 MemoryPagesPool::MemoryPagesPool(size_t vPageSize, size_t vNumberOfPages,
                                  void *vBaseAddress, size_t vBaseSize,
                                  ReleaseCallback vCallback,
-                                 size_t firstPageOffset) {
+                                 size_t firstPageOffset,
+                                 FifoType vFifoType) {
   // initialize members from parameters
+  fifoType = vFifoType;
+  poolId = ++poolIdCounter;
+  threadCacheSize = 0;
   pageSize = vPageSize;
   numberOfPages = vNumberOfPages;
   baseBlockAddress = vBaseAddress;
@@ -40,20 +341,39 @@ MemoryPagesPool::MemoryPagesPool(size_t vPageSize, size_t vNumberOfPages,
   }
 
   // create a fifo and store list of pages available
-  pagesAvailable =
-      std::make_unique<AliceO2::Common::Fifo<void *>>(numberOfPages);
+  if (fifoType == MPMC) {
+    pagesAvailableMPMC = std::make_shared<SharedFreePages>(numberOfPages);
+  } else {
+    pagesAvailable =
+        std::make_unique<AliceO2::Common::Fifo<void *>>(numberOfPages);
+  }
   void *ptr = nullptr;
   for (size_t i = 0; i < numberOfPages; i++) {
     ptr = &((char *)baseBlockAddress)[firstPageOffset + i * pageSize];
-    pagesAvailable->push(ptr);
+    if (fifoType == MPMC) {
+      pagesAvailableMPMC->fifo.push(ptr);
+    } else {
+      pagesAvailable->push(ptr);
+    }
     if (i == 0) {
       firstPageAddress = ptr;
     }
   }
   lastPageAddress = ptr;
+
+  // create storage for containers
+  containerSlots = std::make_unique<ContainerSlot[]>(numberOfPages);
 }
 
 MemoryPagesPool::~MemoryPagesPool() {
+  // remove from lists of tracked / cached pools
+  if (tracker != nullptr) {
+    trackedPools.remove(this);
+  }
+  if (pageCache != nullptr) {
+    cachedPools.remove(this);
+  }
+
   // if defined, use provided callback to release base block
   if ((releaseBaseBlockCallback != nullptr) && (baseBlockAddress != nullptr)) {
     releaseBaseBlockCallback(baseBlockAddress);
@@ -63,7 +383,18 @@ MemoryPagesPool::~MemoryPagesPool() {
 void *MemoryPagesPool::getPage() {
   // get a page from fifo, if available
   void *ptr = nullptr;
-  pagesAvailable->pop(ptr);
+  if (fifoType == MPMC) {
+    if (threadCacheSize) {
+      ptr = getPageFromThreadCache();
+    } else {
+      pagesAvailableMPMC->fifo.pop(ptr);
+    }
+  } else {
+    pagesAvailable->pop(ptr);
+  }
+  if ((tracker != nullptr) && (ptr != nullptr)) {
+    trackPageAcquired(ptr);
+  }
   return ptr;
 }
 
@@ -73,8 +404,25 @@ void MemoryPagesPool::releasePage(void *address) {
     throw __LINE__;
   }
 
+  if (tracker != nullptr) {
+    trackPageReleased(address);
+  }
+  if (pageCache != nullptr) {
+    // invalidate data cached for this page
+    pageCache[((char *)address - (char *)firstPageAddress) / pageSize]
+        .pageUseCount++;
+  }
+
   // put back page in list of available pages
-  pagesAvailable->push(address);
+  if (fifoType == MPMC) {
+    if (threadCacheSize) {
+      releasePageToThreadCache(address);
+      return;
+    }
+    pagesAvailableMPMC->fifo.push(address);
+  } else {
+    pagesAvailable->push(address);
+  }
 }
 
 size_t MemoryPagesPool::getPageSize() { return pageSize; }
@@ -82,12 +430,30 @@ size_t MemoryPagesPool::getPageSize() { return pageSize; }
 size_t MemoryPagesPool::getTotalNumberOfPages() { return numberOfPages; }
 
 size_t MemoryPagesPool::getNumberOfPagesAvailable() {
+  if (fifoType == MPMC) {
+    return pagesAvailableMPMC->fifo.getNumberOfUsedSlots() +
+           pagesAvailableMPMC->pagesInThreadCaches.load();
+  }
   return pagesAvailable->getNumberOfUsedSlots();
 }
 
 void *MemoryPagesPool::getBaseBlockAddress() { return baseBlockAddress; }
 size_t MemoryPagesPool::getBaseBlockSize() { return baseBlockSize; }
 
+int MemoryPagesPool::bindToNumaNode(int node) {
+  // only whole system pages inside the block can be bound
+  size_t systemPageSize = getpagesize();
+  size_t begin = ((size_t)baseBlockAddress + systemPageSize - 1) &
+                 ~(systemPageSize - 1);
+  size_t end = ((size_t)baseBlockAddress + baseBlockSize) &
+               ~(systemPageSize - 1);
+  if (end <= begin) {
+    return -1;
+  }
+  return bindMemoryToNumaNode((void *)begin, end - begin, node, false,
+                              "Memory pool");
+}
+
 std::shared_ptr<DataBlockContainer>
 MemoryPagesPool::getNewDataBlockContainer(void *newPage) {
   // get a new page if none provided
@@ -116,17 +482,24 @@ MemoryPagesPool::getNewDataBlockContainer(void *newPage) {
   b->header.timeframeId = undefinedTimeframeId;
   b->data = &(((char *)b)[sizeof(DataBlock)]);
 
-  // define a function to put it back in pool after use
-  auto releaseCallback = [this, newPage](void) -> void {
-    this->releasePage(newPage);
-    return;
-  };
-
-  // create a container and associate data page and release callback
-  std::shared_ptr<DataBlockContainer> bc = std::make_shared<DataBlockContainer>(
-      releaseCallback, (DataBlock *)newPage, pageSize);
-  if (bc == nullptr) {
-    releaseCallback();
+  // create a container and associate data page
+  // it is stored in the slot reserved for this page. The page is put back in
+  // pool after use, when the container storage is released by the allocator.
+  size_t pageIndex = ((char *)newPage - (char *)firstPageAddress) / pageSize;
+  bool isAllocated = false;
+  PageContainerAllocator<DataBlockContainer> allocator(
+      this, newPage, containerSlots[pageIndex].data, containerSlotSize,
+      &isAllocated);
+  std::shared_ptr<DataBlockContainer> bc = nullptr;
+  try {
+    bc = std::allocate_shared<DataBlockContainer>(
+        allocator, nullptr, (DataBlock *)newPage, pageSize);
+  } catch (...) {
+    // page not used. If storage was allocated, it was already released
+    // (with the page) by the allocator.
+    if (!isAllocated) {
+      releasePage(newPage);
+    }
     return nullptr;
   }
 
@@ -147,3 +520,282 @@ bool MemoryPagesPool::isPageValid(void *pagePtr) {
   }
   return true;
 }
+
+MemoryPagesPool::FifoType MemoryPagesPool::getFifoType() { return fifoType; }
+
+int MemoryPagesPool::getFifoTypeFromString(const std::string &s, FifoType &t) {
+  if (s == "mpmc") {
+    t = MPMC;
+  } else if (s == "spsc") {
+    t = SPSC;
+  } else {
+    return -1;
+  }
+  return 0;
+}
+
+// get magazine of calling thread for given pool, create it if needed
+static ThreadMagazine &
+getThreadMagazine(uint64_t poolId,
+                  std::shared_ptr<MemoryPagesPool::SharedFreePages> &freePages,
+                  size_t cacheSize) {
+  auto &magazines = threadCache.magazines;
+  for (auto &m : magazines) {
+    if (m.poolId == poolId) {
+      return m;
+    }
+  }
+  // not found: first cleanup magazines of destroyed pools
+  magazines.erase(std::remove_if(magazines.begin(), magazines.end(),
+                                 [](ThreadMagazine &m) {
+                                   return m.freePages.expired();
+                                 }),
+                  magazines.end());
+  magazines.emplace_back();
+  ThreadMagazine &m = magazines.back();
+  m.poolId = poolId;
+  m.freePages = freePages;
+  m.freePagesPtr = freePages.get();
+  m.pages.reserve(cacheSize);
+  return m;
+}
+
+void *MemoryPagesPool::getPageFromThreadCache() {
+  ThreadMagazine &m =
+      getThreadMagazine(poolId, pagesAvailableMPMC, threadCacheSize);
+  if (m.pages.empty()) {
+    // refill half of the magazine from shared list
+    size_t batchSize = std::max((size_t)1, threadCacheSize / 2);
+    void *ptr = nullptr;
+    for (size_t i = 0; i < batchSize; i++) {
+      if (m.freePagesPtr->fifo.pop(ptr)) {
+        break;
+      }
+      m.pages.push_back(ptr);
+    }
+    if (m.pages.empty()) {
+      return nullptr;
+    }
+    m.publish(m.freePagesPtr);
+  }
+  void *ptr = m.pages.back();
+  m.pages.pop_back();
+  return ptr;
+}
+
+void MemoryPagesPool::releasePageToThreadCache(void *page) {
+  ThreadMagazine &m =
+      getThreadMagazine(poolId, pagesAvailableMPMC, threadCacheSize);
+  m.pages.push_back(page);
+  if (m.pages.size() >= threadCacheSize) {
+    // flush half of the magazine to shared list
+    m.flush(m.freePagesPtr, std::max((size_t)1, threadCacheSize / 2));
+  }
+}
+
+void MemoryPagesPool::setThreadCacheSize(size_t size) {
+  if (fifoType != MPMC) {
+    // not supported
+    return;
+  }
+  threadCacheSize = size;
+}
+
+size_t MemoryPagesPool::getThreadCacheSize() { return threadCacheSize; }
+
+void MemoryPagesPool::flushThreadCache() {
+  if (fifoType != MPMC) {
+    return;
+  }
+  for (auto &m : threadCache.magazines) {
+    if (m.poolId == poolId) {
+      m.flush(m.freePagesPtr);
+    }
+  }
+}
+
+const char *MemoryPagesPool::getPageStageName(int stage) {
+  switch (stage) {
+  case StageEquipment:
+    return "equipment";
+  case StageAggregator:
+    return "aggregator";
+  case StageConsumers:
+    return "consumers";
+  case StageProcessor:
+    return "processor";
+  case StageFairMQ:
+    return "fairmq";
+  case numberOfPageStages:
+    return "total";
+  }
+  return "none";
+}
+
+void MemoryPagesPool::enableTracking(const std::string &name) {
+  if (tracker != nullptr) {
+    return;
+  }
+  tracker = std::make_unique<PageTracker>(numberOfPages, name);
+
+  // register in list of tracked pools
+  if (trackedPools.add(this, firstPageAddress, lastPageAddress)) {
+    theLog.log(InfoLogger::Severity::Warning,
+               "Too many memory pools tracked, pages stage of %s not available",
+               name.c_str());
+  }
+}
+
+bool MemoryPagesPool::isTrackingEnabled() { return (tracker != nullptr); }
+
+void MemoryPagesPool::trackPageAcquired(void *page) {
+  size_t pageIndex = ((char *)page - (char *)firstPageAddress) / pageSize;
+  PageTracker::PageInfo &info = tracker->pages[pageIndex];
+  uint64_t now = getTrackingTime();
+  info.timeStage.store(now, std::memory_order_relaxed);
+  info.stage.store(StageEquipment, std::memory_order_relaxed);
+  info.timeAcquired.store(now, std::memory_order_release);
+}
+
+void MemoryPagesPool::trackPageReleased(void *page) {
+  size_t pageIndex = ((char *)page - (char *)firstPageAddress) / pageSize;
+  PageTracker::PageInfo &info = tracker->pages[pageIndex];
+  uint64_t t0 = info.timeAcquired.exchange(0, std::memory_order_acquire);
+  if (t0 == 0) {
+    // page acquired before tracking was enabled
+    return;
+  }
+  uint64_t now = getTrackingTime();
+  int stage = info.stage.exchange(-1, std::memory_order_relaxed);
+  if ((stage >= 0) && (stage < numberOfPageStages)) {
+    tracker->stages[stage].fill(
+        now - info.timeStage.load(std::memory_order_relaxed));
+  }
+  tracker->total.fill(now - t0);
+}
+
+void MemoryPagesPool::trackPageStage(void *page, PageStage stage) {
+  size_t pageIndex = ((char *)page - (char *)firstPageAddress) / pageSize;
+  PageTracker::PageInfo &info = tracker->pages[pageIndex];
+  if (info.timeAcquired.load(std::memory_order_acquire) == 0) {
+    return;
+  }
+  int previousStage = info.stage.load(std::memory_order_relaxed);
+  if (previousStage == stage) {
+    return;
+  }
+  uint64_t now = getTrackingTime();
+  uint64_t t = info.timeStage.exchange(now, std::memory_order_relaxed);
+  info.stage.store(stage, std::memory_order_relaxed);
+  if ((previousStage >= 0) && (previousStage < numberOfPageStages)) {
+    tracker->stages[previousStage].fill(now - t);
+  }
+}
+
+void MemoryPagesPool::setPageStage(void *page, PageStage stage) {
+  MemoryPagesPool *p = trackedPools.find(page);
+  if (p != nullptr) {
+    p->trackPageStage(page, stage);
+  }
+}
+
+void MemoryPagesPool::enablePageCache() {
+  if (pageCache != nullptr) {
+    return;
+  }
+  pageCache = std::make_unique<PageCacheSlot[]>(numberOfPages);
+  if (cachedPools.add(this, firstPageAddress, lastPageAddress)) {
+    theLog.log(InfoLogger::Severity::Warning,
+               "Too many memory pools with page cache");
+  }
+}
+
+MemoryPagesPool::PageCacheSlot *MemoryPagesPool::getPageCache(void *page) {
+  MemoryPagesPool *p = cachedPools.find(page);
+  if (p == nullptr) {
+    return nullptr;
+  }
+  size_t pageIndex = ((char *)page - (char *)p->firstPageAddress) / p->pageSize;
+  return &p->pageCache[pageIndex];
+}
+
+int MemoryPagesPool::getTrackingStats(std::vector<PageStageStats> &stats) {
+  stats.clear();
+  if (tracker == nullptr) {
+    return -1;
+  }
+  std::vector<uint64_t> pagesInStage(numberOfPageStages + 1, 0);
+  for (size_t i = 0; i < numberOfPages; i++) {
+    if (tracker->pages[i].timeAcquired.load(std::memory_order_relaxed) == 0) {
+      continue;
+    }
+    int stage = tracker->pages[i].stage.load(std::memory_order_relaxed);
+    if ((stage >= 0) && (stage < numberOfPageStages)) {
+      pagesInStage[stage]++;
+    }
+    pagesInStage[numberOfPageStages]++;
+  }
+  for (int i = 0; i <= numberOfPageStages; i++) {
+    PageTracker::TimeHistogram &h =
+        (i < numberOfPageStages) ? tracker->stages[i] : tracker->total;
+    PageStageStats s;
+    s.count = h.count.load(std::memory_order_relaxed);
+    s.pagesInStage = pagesInStage[i];
+    s.meanTime = s.count ? h.sum.load(std::memory_order_relaxed) /
+                               (double)s.count / 1000000000.0
+                         : 0;
+    s.p50Time = s.count ? h.getQuantile(0.50) : 0;
+    s.p99Time = s.count ? h.getQuantile(0.99) : 0;
+    s.maxTime = h.max.load(std::memory_order_relaxed) / 1000000000.0;
+    stats.push_back(s);
+  }
+  return 0;
+}
+
+void MemoryPagesPool::logTrackingReport(int nOldest) {
+  std::vector<PageStageStats> stats;
+  if (getTrackingStats(stats)) {
+    return;
+  }
+  const char *name = tracker->name.c_str();
+  theLog.log("Memory pool %s: %d/%d pages in use", name,
+             (int)stats[numberOfPageStages].pagesInStage, (int)numberOfPages);
+  for (int i = 0; i <= numberOfPageStages; i++) {
+    auto &s = stats[i];
+    theLog.log("Memory pool %s: stage %-10s : %6d pages now, %llu done, time "
+               "mean %.3fms, p50 < %.3fms, p99 < %.3fms, max %.3fms",
+               name, getPageStageName(i), (int)s.pagesInStage,
+               (unsigned long long)s.count, s.meanTime * 1000.0,
+               s.p50Time * 1000.0, s.p99Time * 1000.0, s.maxTime * 1000.0);
+  }
+
+  // list oldest pages in use
+  std::vector<std::pair<uint64_t, size_t>> pagesInUse; // (time, index)
+  for (size_t i = 0; i < numberOfPages; i++) {
+    uint64_t t =
+        tracker->pages[i].timeAcquired.load(std::memory_order_relaxed);
+    if (t != 0) {
+      pagesInUse.push_back(std::make_pair(t, i));
+    }
+  }
+  size_t n = std::min(pagesInUse.size(), (size_t)std::max(nOldest, 0));
+  std::partial_sort(pagesInUse.begin(), pagesInUse.begin() + n,
+                    pagesInUse.end());
+  uint64_t now = getTrackingTime();
+  for (size_t i = 0; i < n; i++) {
+    size_t ix = pagesInUse[i].second;
+    PageTracker::PageInfo &info = tracker->pages[ix];
+    theLog.log("Memory pool %s: page %p in use for %.3fms, in stage %s for "
+               "%.3fms",
+               name, (void *)&((char *)firstPageAddress)[ix * pageSize],
+               (now - pagesInUse[i].first) / 1000000.0,
+               getPageStageName(info.stage.load(std::memory_order_relaxed)),
+               (now - info.timeStage.load(std::memory_order_relaxed)) /
+                   1000000.0);
+  }
+}
+
+void MemoryPagesPool::logTrackingReportAll(int nOldest) {
+  trackedPools.forEach(
+      [nOldest](MemoryPagesPool *p) { p->logTrackingReport(nOldest); });
+}
@@ -15,11 +15,17 @@
 #include <Common/Fifo.h>
 #include <functional>
 #include <memory>
+#include <string>
+#include <vector>
+
+#include "FifoMPMC.h"
 
 // This class creates a pool of data pages from a memory block
-// Optimized for 1-1 consumers (1 thread to get the page, 1 thread to release
-// them) No check is done on validity of address of data pages pushed back in
-// queue Base address should be kept while object is in use
+// The list of free pages can be kept either in a lock-free multi-producer /
+// multi-consumer fifo (default, pages can be got and released from any number
+// of threads concurrently), or in a Common::Fifo optimized for 1-1 consumers
+// (1 thread to get the page, 1 thread to release them).
+// Base address should be kept while object is in use
 
 class MemoryPagesPool {
 
@@ -29,6 +35,16 @@ public:
   // NB: may use std::bind to add extra arguments
   using ReleaseCallback = std::function<void(void *)>;
 
+  // type of fifo used to store the free pages
+  enum FifoType {
+    SPSC, // Common::Fifo: 1 thread calling getPage(), 1 thread releasePage()
+    MPMC  // FifoMPMC: any number of threads for both
+  };
+
+  // convert a string to fifo type ("spsc" or "mpmc")
+  // returns 0 on success, -1 if unknown
+  static int getFifoTypeFromString(const std::string &s, FifoType &t);
+
   // constructor
   // parameters:
   // - size of each page (in bytes)
@@ -41,16 +57,18 @@ public:
   // control alignment. All pages are created contiguous from this point.
   //   If non-zero, this may reduce number of pages created compared to request
   //   (as to fit in base size)
+  // - fifoType defines which kind of fifo to use to keep track of free pages
   MemoryPagesPool(size_t pageSize, size_t numberOfPages, void *baseAddress,
                   size_t baseSize = 0, ReleaseCallback callback = nullptr,
-                  size_t firstPageOffset = 0);
+                  size_t firstPageOffset = 0, FifoType fifoType = MPMC);
 
   // destructor
   ~MemoryPagesPool();
 
   // methods to get and release page
   // the two functions can be called concurrently without locking
-  // (but a lock is needed if calling the same function concurrently)
+  // for SPSC type, a lock is needed if calling the same function concurrently
+  // (not needed for MPMC type)
   void *
   getPage(); // get a new page from the pool (if available, nullptr if none)
   void releasePage(void *address); // insert back page to the pool after use, to
@@ -65,17 +83,138 @@ public:
                              // guaranteed to be within &baseBlockAddress[0] and
                              // &baseBlockAddress[baseBlockSize]
 
+  // bind the memory block of the pool to a NUMA node, moving pages already
+  // allocated (if any). Should be done before the memory is registered for
+  // DMA. Returns 0 on success, -1 on error (or if no NUMA support).
+  int bindToNumaNode(int node);
+
   std::shared_ptr<DataBlockContainer> getNewDataBlockContainer(
       void *page = nullptr); // returns an empty data block container (with data
                              // = a given page, retrieved previously by
                              // getPage(), or new page if null) from the pool.
                              // Page will be put back in pool after use.
+                             // The container (and shared_ptr control block)
+                             // is stored in a slot reserved for each page, so
+                             // that no heap allocation is done.
 
   bool isPageValid(void *page); // check to see if a page address is valid
 
+  FifoType getFifoType(); // get the type of fifo used for free pages
+
+  // per-thread cache of free pages (MPMC type only)
+  // When enabled, each thread calling getPage() / releasePage() keeps a small
+  // stack (magazine) of free pages for this pool, refilled from / flushed to
+  // the shared fifo by batches of half its size. Pages cached by a thread are
+  // given back to the pool when the thread exits.
+  // getNumberOfPagesAvailable() includes the cached pages, as accounted at the
+  // last batch operation of each thread.
+  // size: maximum number of pages cached per thread. 0 to disable (default).
+  // Should be set before the pool is used.
+  void setThreadCacheSize(size_t size);
+  size_t getThreadCacheSize();
+
+  // give back to the pool the pages cached by the calling thread
+  void flushThreadCache();
+
+  // shared list of free pages (MPMC type)
+  // owned by the pool only: thread caches keep a weak reference to it, to give
+  // back their pages on thread exit if the pool still exists. Pages cached by
+  // threads when the pool is destroyed are dropped with it.
+  struct SharedFreePages;
+
+  // tracking of pages in use
+  // When enabled, the pool records for each page given by getPage() the time
+  // it was acquired, and which processing stage currently owns it. The time
+  // spent by pages in each stage is accumulated in histograms, which can be
+  // read at any time, and the oldest pages in use can be listed, e.g. to find
+  // which stage holds the pages when the pool runs empty.
+  // Overhead is a clock read and a few atomic counters per page and stage.
+
+  // processing stages owning a page
+  enum PageStage {
+    StageEquipment = 0, // page given to the equipment (getPage)
+    StageAggregator,    // page taken by the aggregator
+    StageConsumers,     // page pushed to the consumers
+    StageProcessor,     // page queued to a processing thread
+    StageFairMQ,        // page held by a FairMQ message
+    numberOfPageStages
+  };
+  static const char *getPageStageName(int stage);
+
+  // enable tracking. The name is used for reports. Pages already in use are
+  // not tracked. Should be set before the pool is used.
+  void enableTracking(const std::string &name);
+  bool isTrackingEnabled();
+
+  // set the stage owning a page (given by the data block address, i.e. the
+  // page address). The pool owning the page is looked up among the pools with
+  // tracking enabled, nothing is done if none.
+  static void setPageStage(void *page, PageStage stage);
+
+  // statistics of time spent by pages in a stage
+  // the last line (index numberOfPageStages) is for the total time in use
+  struct PageStageStats {
+    uint64_t count;         // number of pages which left the stage
+    uint64_t pagesInStage;  // number of pages currently in this stage
+    double meanTime;        // mean time in stage, in seconds
+    double p50Time;         // median time in stage (bin upper bound)
+    double p99Time;         // 99th percentile time in stage (bin upper bound)
+    double maxTime;         // maximum time in stage
+  };
+  int getTrackingStats(std::vector<PageStageStats> &stats);
+
+  // print tracking statistics in log, and the nOldest pages still in use
+  void logTrackingReport(int nOldest = 10);
+
+  // call logTrackingReport() for all the pools with tracking enabled
+  static void logTrackingReportAll(int nOldest = 10);
+
+  struct PageTracker;
+
+  // per-page cache of data derived from the page content (e.g. the index of
+  // the RDH packets it contains), so that a page is parsed once and the result
+  // reused by the next processing stages. The cached object stays with the
+  // page when it is recycled: users should check that it matches the current
+  // page content. There is no locking, a page being used by a single stage at
+  // a time. Should be enabled before the pool is used.
+  void enablePageCache();
+
+  struct PageCacheSlot {
+    std::shared_ptr<void> data; // the cached object
+    uint64_t pageUseCount = 0;  // number of times the page was released, to
+                                // know if cached object is from current use
+  };
+
+  // get the cache slot of a page (given by the data block address, i.e. the
+  // page address), looked up among the pools with page cache enabled.
+  // Returns nullptr if none.
+  static PageCacheSlot *getPageCache(void *page);
+
 private:
+  FifoType fifoType; // type of fifo in use, only one of the 2 below is created
   std::unique_ptr<AliceO2::Common::Fifo<void *>>
-      pagesAvailable; // a buffer to keep track of individual pages
+      pagesAvailable; // a buffer to keep track of individual pages (SPSC)
+  std::shared_ptr<SharedFreePages>
+      pagesAvailableMPMC; // a buffer to keep track of individual pages (MPMC)
+
+  // storage for the DataBlockContainer associated to each page
+  static const size_t containerSlotSize = 192; // bytes reserved per page
+  struct alignas(64) ContainerSlot {
+    char data[containerSlotSize];
+  };
+  std::unique_ptr<ContainerSlot[]> containerSlots; // one slot per page
+
+  uint64_t poolId;        // unique id of this pool, to index thread caches
+  size_t threadCacheSize; // max number of pages per thread cache (0=disabled)
+  void *getPageFromThreadCache();
+  void releasePageToThreadCache(void *page);
+
+  std::unique_ptr<PageTracker> tracker; // page tracking, when enabled
+
+  std::unique_ptr<PageCacheSlot[]> pageCache; // per-page cache, when enabled
+  void trackPageAcquired(void *page);
+  void trackPageReleased(void *page);
+  void trackPageStage(void *page, PageStage stage);
 
   size_t numberOfPages; // number of pages
   size_t pageSize;      // size of each page, in bytes
@@ -0,0 +1,106 @@
+// Copyright CERN and copyright holders of ALICE O2. This software is
+// distributed under the terms of the GNU General Public License v3 (GPL
+// Version 3), copied verbatim in the file "COPYING".
+//
+// See http://alice-o2.web.cern.ch/license for full licensing information.
+//
+// In applying this license CERN does not waive the privileges and immunities
+// granted to it by virtue of its status as an Intergovernmental Organization
+// or submit itself to any jurisdiction.
+
+#include "MemoryPagesPoolSizeClasses.h"
+
+#include <algorithm>
+
+#include <InfoLogger/InfoLogger.hxx>
+using namespace AliceO2::InfoLogger;
+extern InfoLogger theLog;
+
+MemoryPagesPoolSizeClasses::MemoryPagesPoolSizeClasses(
+    std::vector<std::shared_ptr<MemoryPagesPool>> &p) {
+  for (auto &mp : p) {
+    if (mp == nullptr) {
+      throw __LINE__;
+    }
+    pools.push_back(mp);
+  }
+  if (pools.size() == 0) {
+    throw __LINE__;
+  }
+  std::sort(pools.begin(), pools.end(),
+            [](const std::shared_ptr<MemoryPagesPool> &a,
+               const std::shared_ptr<MemoryPagesPool> &b) {
+              return a->getPageSize() < b->getPageSize();
+            });
+  stats = std::make_unique<sizeClassStats[]>(pools.size());
+}
+
+MemoryPagesPoolSizeClasses::~MemoryPagesPoolSizeClasses() {}
+
+std::shared_ptr<DataBlockContainer>
+MemoryPagesPoolSizeClasses::getNewDataBlockContainer(size_t size) {
+  // find smallest class big enough
+  size_t ix;
+  for (ix = 0; ix < pools.size(); ix++) {
+    if (pools[ix]->getPageSize() - sizeof(DataBlock) >= size) {
+      break;
+    }
+  }
+  if (ix == pools.size()) {
+    // too big for all classes
+    return nullptr;
+  }
+  stats[ix].nRequests++;
+
+  // get a page from this class, or bigger ones if empty
+  for (size_t i = ix; i < pools.size(); i++) {
+    std::shared_ptr<DataBlockContainer> bc = nullptr;
+    try {
+      bc = pools[i]->getNewDataBlockContainer();
+    } catch (...) {
+    }
+    if (bc != nullptr) {
+      stats[i].nAllocated++;
+      stats[i].bytesRequested += size;
+      if (i != ix) {
+        stats[i].nFallback++;
+      }
+      return bc;
+    }
+  }
+  stats[ix].nFailed++;
+  return nullptr;
+}
+
+size_t MemoryPagesPoolSizeClasses::getMaxBlockSize() {
+  return pools.back()->getPageSize() - sizeof(DataBlock);
+}
+
+void MemoryPagesPoolSizeClasses::getNumberOfPages(
+    size_t &numberOfPagesAvailable, size_t &numberOfPagesTotal) {
+  numberOfPagesAvailable = 0;
+  numberOfPagesTotal = 0;
+  for (auto &mp : pools) {
+    numberOfPagesAvailable += mp->getNumberOfPagesAvailable();
+    numberOfPagesTotal += mp->getTotalNumberOfPages();
+  }
+}
+
+void MemoryPagesPoolSizeClasses::logStats() {
+  for (size_t i = 0; i < pools.size(); i++) {
+    uint64_t nAllocated = stats[i].nAllocated;
+    uint64_t bytesAllocated = nAllocated * pools[i]->getPageSize();
+    theLog.log("Size class %ld bytes: %d/%d pages free, %llu requests, %llu "
+               "pages allocated (%llu fallback from smaller class), %llu "
+               "failed, usage efficiency %.1f%%",
+               pools[i]->getPageSize(),
+               (int)pools[i]->getNumberOfPagesAvailable(),
+               (int)pools[i]->getTotalNumberOfPages(),
+               (unsigned long long)stats[i].nRequests,
+               (unsigned long long)nAllocated,
+               (unsigned long long)stats[i].nFallback,
+               (unsigned long long)stats[i].nFailed,
+               bytesAllocated ? stats[i].bytesRequested * 100.0 / bytesAllocated
+                              : 0.0);
+  }
+}
@@ -0,0 +1,70 @@
+// Copyright CERN and copyright holders of ALICE O2. This software is
+// distributed under the terms of the GNU General Public License v3 (GPL
+// Version 3), copied verbatim in the file "COPYING".
+//
+// See http://alice-o2.web.cern.ch/license for full licensing information.
+//
+// In applying this license CERN does not waive the privileges and immunities
+// granted to it by virtue of its status as an Intergovernmental Organization
+// or submit itself to any jurisdiction.
+
+/// \file MemoryPagesPoolSizeClasses.h
+/// \brief A set of memory pools with different page sizes.
+/// \descr Blocks are allocated from the pool with the smallest page size big
+/// enough for the requested size, so that small buffers (headers, copies...)
+/// do not use big pages.
+
+#ifndef _MEMORYPAGESPOOLSIZECLASSES_H
+#define _MEMORYPAGESPOOLSIZECLASSES_H
+
+#include "MemoryPagesPool.h"
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+
+class MemoryPagesPoolSizeClasses {
+
+public:
+  // constructor, from a list of pools (one per size class)
+  // pools are sorted by increasing page size
+  MemoryPagesPoolSizeClasses(std::vector<std::shared_ptr<MemoryPagesPool>> &p);
+
+  // destructor
+  ~MemoryPagesPoolSizeClasses();
+
+  // get a new data block container with a payload of at least size bytes.
+  // The page is taken from the smallest size class able to store it, or from
+  // a bigger one if none left. Returns nullptr if none available.
+  std::shared_ptr<DataBlockContainer> getNewDataBlockContainer(size_t size);
+
+  // get the maximum payload size which can be allocated
+  size_t getMaxBlockSize();
+
+  // get number of pages currently available, and total number of pages, for
+  // all size classes
+  void getNumberOfPages(size_t &numberOfPagesAvailable,
+                        size_t &numberOfPagesTotal);
+
+  // print statistics of each size class in log
+  void logStats();
+
+private:
+  // statistics for each size class
+  struct sizeClassStats {
+    std::atomic<uint64_t> nRequests{0}; // number of requests for this class
+    std::atomic<uint64_t> nAllocated{0}; // number of pages given by this class
+    std::atomic<uint64_t> nFallback{0};  // pages given by this class for a
+                                         // smaller one (which was empty)
+    std::atomic<uint64_t> nFailed{0}; // number of requests for this class which
+                                      // could not be satisfied
+    std::atomic<uint64_t> bytesRequested{0}; // total size requested for pages
+                                             // given by this class
+  };
+
+  std::vector<std::shared_ptr<MemoryPagesPool>> pools; // pool for each class
+  std::unique_ptr<sizeClassStats[]> stats;             // stats for each class
+};
+
+#endif // #ifndef _MEMORYPAGESPOOLSIZECLASSES_H
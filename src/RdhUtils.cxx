@@ -61,18 +61,16 @@ void RdhHandle::dumpRdh(long offset, bool singleLine) {
 
 int RdhHandle::validateRdh(std::string &err) {
   int retCode = 0;
-  // expecting RDH v3 or v4
-  if ((getHeaderVersion() != 3) && (getHeaderVersion() != 4)) {
+  int errors = checkRdh(rdhPtr);
+  if (errors & RdhErrorVersion) {
     err += "Wrong header version\n";
     retCode++;
   }
-  // expecting 16*32bits=64 bytes for header
-  if (getHeaderSize() != 64) {
+  if (errors & RdhErrorHeaderSize) {
     err += "Wrong header size\n";
     retCode++;
   }
-  // expecting linkId 0-31
-  if (getLinkId() > RdhMaxLinkId) {
+  if (errors & RdhErrorLinkId) {
     err += "Wrong link ID\n";
     retCode++;
   }
@@ -161,3 +159,88 @@ int RdhBlockHandle::printSummary() {
 
   return 0;
 }
+
+void RdhPageIndex::clear() {
+  packets.clear();
+  error = 0;
+  errorDescription.clear();
+  isChecked = false;
+  blockPtr = nullptr;
+  blockSize = 0;
+  pageUseCount = 0;
+}
+
+int RdhBlockHandle::scan(RdhPageIndex &index, ScanMode mode) {
+  index.packets.clear(); // keeps capacity, no allocation when index reused
+  index.error = 0;
+  index.errorDescription.clear();
+  index.isChecked = (mode == ScanChecked);
+  index.blockPtr = blockPtr;
+  index.blockSize = blockSize;
+
+  const uint8_t *base = (const uint8_t *)blockPtr;
+  const size_t rdhSize = sizeof(o2::Header::RAWDataHeader);
+
+  // first pass: follow the chain of offsets. Each step depends on the
+  // previous load, so only the offset and size are read here.
+  size_t offset = 0;
+  while (offset < blockSize) {
+    size_t bytesLeft = blockSize - offset;
+    if (bytesLeft < rdhSize) {
+      index.error = -1;
+      index.errorDescription = "page too small, " + std::to_string(bytesLeft) +
+                               " bytes left at offset " +
+                               std::to_string(offset) + " for RDH";
+      break;
+    }
+    const o2::Header::RAWDataHeader *rdh =
+        (const o2::Header::RAWDataHeader *)&base[offset];
+    size_t next = (size_t)rdh->offsetNextPacket;
+    if (next > bytesLeft) {
+      index.error = -1;
+      index.errorDescription = "page too small, " + std::to_string(bytesLeft) +
+                               " bytes left at offset " +
+                               std::to_string(offset) + " for next offset " +
+                               std::to_string(next);
+      break;
+    }
+    RdhPacketInfo p;
+    p.offset = (uint32_t)offset;
+    p.size = (uint32_t)((next == 0) ? bytesLeft : next);
+    p.offsetNextPacket = (uint16_t)next;
+    index.packets.push_back(p);
+    if (next == 0) {
+      break;
+    }
+    offset += next;
+  }
+
+  // second pass: extract and check fields. Packets are independent, so that
+  // the loads of consecutive RDHs can be overlapped by the CPU.
+  size_t nPackets = index.packets.size();
+  for (size_t i = 0; i < nPackets; i++) {
+    RdhPacketInfo &p = index.packets[i];
+    if (i + 1 < nPackets) {
+      __builtin_prefetch(&base[index.packets[i + 1].offset]);
+    }
+    const o2::Header::RAWDataHeader *rdh =
+        (const o2::Header::RAWDataHeader *)&base[p.offset];
+    p.hbOrbit = (uint32_t)rdh->heartbeatOrbit;
+    p.memorySize = (uint16_t)rdh->memorySize;
+    p.feeId = (uint16_t)rdh->feeId;
+    p.cruId = (uint16_t)rdh->cruId;
+    p.linkId = (uint8_t)rdh->linkId;
+    p.stopBit = (uint8_t)rdh->stopBit;
+    if (mode == ScanChecked) {
+      if (checkRdh(rdh)) {
+        index.error = -1;
+        index.errorDescription =
+            "invalid RDH at offset " + std::to_string(p.offset);
+        index.packets.resize(i);
+        break;
+      }
+    }
+  }
+
+  return index.error;
+}
@@ -10,11 +10,47 @@
 
 // Utilities to handle RDH content from CRU data
 
+#ifndef _RDHUTILS_H
+#define _RDHUTILS_H
+
 #include "RAWDataHeader.h"
 #include <string>
+#include <vector>
+
+#include <Common/DataBlock.h>
+
+#include "MemoryPagesPool.h"
 
 // Some constants
 const unsigned int RdhMaxLinkId = 31; // maximum ID of a linkId in RDH
+const unsigned int LHCBunches = 3564; // number of bunches in LHC
+const unsigned int LHCOrbitRate =
+    11246; // LHC orbit rate, in Hz. 299792458 / 26659
+const unsigned int LHCBCRate =
+    LHCOrbitRate * LHCBunches; // LHC bunch crossing rate, in Hz
+
+// Errors found by checkRdh()
+enum RdhError {
+  RdhErrorVersion = 1,    // not RDH v3 or v4
+  RdhErrorHeaderSize = 2, // header size not 16*32bits=64 bytes
+  RdhErrorLinkId = 4      // link id out of range 0-RdhMaxLinkId
+};
+
+// check RDH fields, same checks for all RDH validations
+// returns 0 if RDH valid, or a combination of RdhError flags
+inline int checkRdh(const o2::Header::RAWDataHeader *rdh) {
+  int errors = 0;
+  if ((rdh->version != 3) && (rdh->version != 4)) {
+    errors |= RdhErrorVersion;
+  }
+  if (rdh->headerSize != sizeof(o2::Header::RAWDataHeader)) {
+    errors |= RdhErrorHeaderSize;
+  }
+  if ((unsigned int)rdh->linkId > RdhMaxLinkId) {
+    errors |= RdhErrorLinkId;
+  }
+  return errors;
+}
 
 // Utility class to access RDH fields and check them
 class RdhHandle {
@@ -61,6 +97,38 @@ private:
   o2::Header::RAWDataHeader *rdhPtr; // pointer to RDH in memory
 };
 
+// Compact description of a RDH packet in a memory block
+struct RdhPacketInfo {
+  uint32_t offset;           // offset of the RDH from beginning of block
+  uint32_t hbOrbit;          // heartbeat orbit
+  uint32_t size;             // offset of next packet (or bytes left in
+                             // block, for the last packet)
+  uint16_t offsetNextPacket; // offset of next packet, as in RDH
+  uint16_t memorySize;       // size of RDH + payload
+  uint16_t feeId;            // FEE id
+  uint16_t cruId;            // CRU id
+  uint8_t linkId;            // link id
+  uint8_t stopBit;           // stop bit
+};
+
+// Index of the RDH packets in a memory block, as built by
+// RdhBlockHandle::scan()
+class RdhPageIndex {
+public:
+  std::vector<RdhPacketInfo> packets; // packets found, in order
+  int error = 0;           // 0 if block fully scanned, -1 if scan stopped on
+                           // an invalid packet (packets before it are listed)
+  std::string errorDescription; // description of the error, if any
+  bool isChecked = false;       // set if built in checked mode
+
+  // identification of the block indexed, to check a cached index is current
+  const void *blockPtr = nullptr; // block address
+  size_t blockSize = 0;           // block size
+  uint64_t pageUseCount = 0;      // page use count (see MemoryPagesPool)
+
+  void clear();
+};
+
 // Utility class to access/parse/check the content of a contiguous memory block
 // consisting of RDH+data
 class RdhBlockHandle {
@@ -75,7 +143,75 @@ public:
   // return 0 on success, an error code if the block is invalid
   int printSummary();
 
+  // modes to scan a block
+  enum ScanMode {
+    ScanChecked,  // each RDH is checked (fits in block, version, header size,
+                  // link id), scan stops on first invalid packet
+    ScanUnchecked // offsetNextPacket is trusted, only the block boundary is
+                  // checked. For data from a trusted source.
+  };
+
+  // walk the block once, and fill index with the packets found
+  // returns 0 on success, -1 on error (index contains packets before error)
+  int scan(RdhPageIndex &index, ScanMode mode = ScanChecked);
+
 private:
   void *blockPtr;   // pointer to beginning of memory block
   size_t blockSize; // size of memory block
 };
+
+// get the index of the RDH packets in a data block, built once per page.
+// If the page belongs to a memory pool with page cache enabled, the index is
+// kept with the page, so that next stages using the same page get it without
+// parsing the data again. It is rebuilt if the page was recycled, if its size
+// changed, or if a checked index is requested and the cached one is not.
+// Otherwise, the index is built in a per-thread buffer, valid until next call.
+inline RdhPageIndex *
+getRdhPageIndex(DataBlock *b,
+                RdhBlockHandle::ScanMode mode = RdhBlockHandle::ScanChecked) {
+  thread_local RdhPageIndex localIndex;
+  RdhPageIndex *index = &localIndex;
+  MemoryPagesPool::PageCacheSlot *slot = MemoryPagesPool::getPageCache(b);
+  if (slot != nullptr) {
+    if (slot->data == nullptr) {
+      slot->data = std::make_shared<RdhPageIndex>();
+    }
+    index = static_cast<RdhPageIndex *>(slot->data.get());
+    if ((index->blockPtr == b->data) &&
+        (index->blockSize == b->header.dataSize) &&
+        (index->pageUseCount == slot->pageUseCount) &&
+        ((index->isChecked) || (mode == RdhBlockHandle::ScanUnchecked))) {
+      return index;
+    }
+  }
+  RdhBlockHandle h(b->data, b->header.dataSize);
+  h.scan(*index, mode);
+  if (slot != nullptr) {
+    index->pageUseCount = slot->pageUseCount;
+  }
+  return index;
+}
+
+// store in the page cache the index of the RDH packets of a data block,
+// built elsewhere (e.g. on the source data, before it was copied to the
+// page). Offsets of packets should be relative to the beginning of b->data.
+// No effect if page cache not enabled for the page.
+inline void setRdhPageIndex(DataBlock *b, const RdhPageIndex &source) {
+  MemoryPagesPool::PageCacheSlot *slot = MemoryPagesPool::getPageCache(b);
+  if (slot == nullptr) {
+    return;
+  }
+  if (slot->data == nullptr) {
+    slot->data = std::make_shared<RdhPageIndex>();
+  }
+  RdhPageIndex *index = static_cast<RdhPageIndex *>(slot->data.get());
+  index->packets = source.packets;
+  index->error = source.error;
+  index->errorDescription = source.errorDescription;
+  index->isChecked = source.isChecked;
+  index->blockPtr = b->data;
+  index->blockSize = b->header.dataSize;
+  index->pageUseCount = slot->pageUseCount;
+}
+
+#endif // #ifndef _RDHUTILS_H
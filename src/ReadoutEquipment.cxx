@@ -11,6 +11,7 @@
 #include "ReadoutEquipment.h"
 #include "ReadoutStats.h"
 
+#include <algorithm>
 #include <InfoLogger/InfoLogger.hxx>
 using namespace AliceO2::InfoLogger;
 extern InfoLogger theLog;
@@ -46,10 +47,86 @@ ReadoutEquipment::ReadoutEquipment(ConfigFile &cfg, std::string cfgEntryPoint) {
 
   // idle sleep time, in microseconds.
   // configuration parameter: | equipment-* | idleSleepTime | int | 200 | Thread
-  // idle sleep time, in microseconds. |
-  int cfgIdleSleepTime = 200;
+  // idle sleep time, in microseconds. With idlePolicy=adaptive, this is the
+  // maximum sleep time. |
   cfg.getOptionalValue<int>(cfgEntryPoint + ".idleSleepTime", cfgIdleSleepTime);
 
+  // configuration parameter: | equipment-* | idlePolicy | string | fixed |
+  // What the readout thread does when it finds nothing to do. One of: fixed
+  // (sleep idleSleepTime), adaptive (spin for up to idleSpinTime, then yield
+  // CPU for up to idleYieldTime, then sleep with a period doubling up to
+  // idleSleepTime). With adaptive, spin and yield are done only when the
+  // measured interval between incoming pages is short enough, so that an idle
+  // equipment uses almost no CPU. Time spent in each phase is reported in
+  // equipment counters. |
+  std::string cfgIdlePolicy = "fixed";
+  cfg.getOptionalValue<std::string>(cfgEntryPoint + ".idlePolicy",
+                                    cfgIdlePolicy);
+  // configuration parameter: | equipment-* | idleSpinTime | int | 20 | For
+  // idlePolicy=adaptive, maximum time spinning after last activity, in
+  // microseconds. |
+  int cfgIdleSpinTime = 20;
+  cfg.getOptionalValue<int>(cfgEntryPoint + ".idleSpinTime", cfgIdleSpinTime);
+  // configuration parameter: | equipment-* | idleYieldTime | int | 200 | For
+  // idlePolicy=adaptive, maximum time yielding CPU after spin phase, in
+  // microseconds. |
+  int cfgIdleYieldTime = 200;
+  cfg.getOptionalValue<int>(cfgEntryPoint + ".idleYieldTime",
+                            cfgIdleYieldTime);
+  // configuration parameter: | equipment-* | cpuAffinity | string | | Placement
+  // of the equipment readout thread. One of: none (default, not pinned), auto
+  // (pinned on the NUMA node of the readout card for RORC equipments, or of the
+  // memory bank used otherwise), numa:N (pinned on the CPUs of NUMA node N), or
+  // a list of CPU indexes (e.g. 0-3,8). With a NUMA node, memory allocations of
+  // the thread are also done preferably on this node. Actual placement is
+  // logged at start of run. |
+  std::string cfgCpuAffinity = "";
+  cfg.getOptionalValue<std::string>(cfgEntryPoint + ".cpuAffinity",
+                                    cfgCpuAffinity);
+  if (threadPlacement.setFromString(cfgCpuAffinity)) {
+    theLog.log(InfoLogger::Severity::Error,
+               "Equipment %s: wrong cpuAffinity %s", name.c_str(),
+               cfgCpuAffinity.c_str());
+    throw __LINE__;
+  }
+
+  if (cfgIdlePolicy == "adaptive") {
+    const int minSleepTime = 10;
+    idleBackoff = std::make_unique<AdaptiveBackoff>(
+        cfgIdleSpinTime, cfgIdleYieldTime,
+        std::min(minSleepTime, cfgIdleSleepTime), cfgIdleSleepTime);
+  } else if (cfgIdlePolicy != "fixed") {
+    theLog.log(InfoLogger::Severity::Error,
+               "Equipment %s: wrong idlePolicy %s", name.c_str(),
+               cfgIdlePolicy.c_str());
+    throw __LINE__;
+  }
+
+  // configuration parameter: | equipment-* | TFperiod | int | 256 | Duration
+  // of a timeframe, in number of LHC orbits. |
+  int cfgTFperiod = 256;
+  cfg.getOptionalValue<int>(cfgEntryPoint + ".TFperiod", cfgTFperiod);
+  timeframeIdAssigner.setPeriod(cfgTFperiod);
+  // configuration parameter: | equipment-* | TFsource | string | auto | How
+  // timeframe ids are assigned to data pages. One of: software (from a clock
+  // running at the LHC timeframe rate), rdh (from the heartbeat orbit of the
+  // first RDH in page, timeframe 1 starting on the first orbit received; pages
+  // with a wrong first RDH get the current timeframe id), or auto (rdh for
+  // cruEmulator equipments, for player equipments with autoChunk set and for
+  // rorc equipments with rdhUseFirstInPageEnabled set, software otherwise). |
+  cfg.getOptionalValue<std::string>(cfgEntryPoint + ".TFsource",
+                                    cfgTimeframeIdSource);
+  if (cfgTimeframeIdSource != "auto") {
+    TimeframeIdAssigner::Source source;
+    if (TimeframeIdAssigner::getSourceFromString(cfgTimeframeIdSource,
+                                                 source)) {
+      theLog.log(InfoLogger::Severity::Error,
+                 "Equipment %s: wrong TFsource %s", name.c_str(),
+                 cfgTimeframeIdSource.c_str());
+      throw __LINE__;
+    }
+  }
+
   // size of equipment output FIFO
   // configuration parameter: | equipment-* | outputFifoSize | int | -1 | Size
   // of output fifo (number of pages). If -1, set to the same value as
@@ -109,6 +186,51 @@ ReadoutEquipment::ReadoutEquipment(ConfigFile &cfg, std::string cfgEntryPoint) {
   size_t cfgBlockAlign = (size_t)ReadoutUtils::getNumberOfBytesFromString(
       cfgStringBlockAlign.c_str());
 
+  // type of fifo used to keep track of free pages in the memory pool
+  // configuration parameter: | equipment-* | memoryPoolFifoType | string |
+  // mpmc | Type of fifo used to store the free pages of the memory pool. One
+  // of: mpmc (lock-free, pages can be released concurrently from any thread),
+  // spsc (legacy, only one thread getting pages and one thread releasing
+  // them). |
+  std::string cfgMemoryPoolFifoType = "mpmc";
+  cfg.getOptionalValue<std::string>(cfgEntryPoint + ".memoryPoolFifoType",
+                                    cfgMemoryPoolFifoType);
+  MemoryPagesPool::FifoType memoryPoolFifoType = MemoryPagesPool::MPMC;
+  if (MemoryPagesPool::getFifoTypeFromString(cfgMemoryPoolFifoType,
+                                             memoryPoolFifoType)) {
+    theLog.log(InfoLogger::Severity::Error,
+               "Equipment %s: wrong memoryPoolFifoType %s", name.c_str(),
+               cfgMemoryPoolFifoType.c_str());
+    throw __LINE__;
+  }
+
+  // configuration parameter: | equipment-* | memoryPoolThreadCacheSize | int |
+  // 0 | If non-zero, each thread getting or releasing pages of the memory pool
+  // keeps a local cache of up to this number of free pages, refilled and
+  // flushed by batches, to reduce contention on the pool. Only for
+  // memoryPoolFifoType=mpmc. Should be small compared to
+  // memoryPoolNumberOfPages, as pages cached by a thread can not be used by
+  // others. |
+  int cfgMemoryPoolThreadCacheSize = 0;
+  cfg.getOptionalValue<int>(cfgEntryPoint + ".memoryPoolThreadCacheSize",
+                            cfgMemoryPoolThreadCacheSize);
+  if ((cfgMemoryPoolThreadCacheSize > 0) &&
+      (memoryPoolFifoType != MemoryPagesPool::MPMC)) {
+    theLog.log(InfoLogger::Severity::Warning,
+               "Equipment %s: memoryPoolThreadCacheSize ignored, needs "
+               "memoryPoolFifoType=mpmc",
+               name.c_str());
+    cfgMemoryPoolThreadCacheSize = 0;
+  }
+
+  // configuration parameter: | equipment-* | memoryPoolTracking | int | 0 |
+  // If 1, the memory pool keeps track of the time and processing stage of each
+  // page in use. A report with the time spent in each stage and the oldest
+  // pages in use is printed at stop, or on SIGUSR1. |
+  int cfgMemoryPoolTracking = 0;
+  cfg.getOptionalValue<int>(cfgEntryPoint + ".memoryPoolTracking",
+                            cfgMemoryPoolTracking);
+
   // output periodic statistics on console
   // configuration parameter: | equipment-* | consoleStatsUpdateTime | double |
   // 0 | If set, number of seconds between printing statistics on console. |
@@ -123,16 +245,75 @@ ReadoutEquipment::ReadoutEquipment(ConfigFile &cfg, std::string cfgEntryPoint) {
     this->stopOnError = 1;
   }
 
+  // byte rate limits
+  // configuration parameter: | equipment-* | byteRate | bytes | 0 | Data rate
+  // limit for this equipment, in bytes per second (suffixes k,M,G are powers
+  // of 1024). 0 for unlimited. Done with a token bucket: a page is read when
+  // the bucket is not empty, and its size is then removed from the bucket. Can
+  // be combined with readout.rate. Throttled iterations are counted in
+  // nThrottle. |
+  std::string cfgByteRate = "0";
+  cfg.getOptionalValue<std::string>(cfgEntryPoint + ".byteRate", cfgByteRate);
+  // configuration parameter: | equipment-* | byteRateBurst | bytes | | Burst
+  // size of the byteRate and byteRatePerLink limits, i.e. maximum amount of
+  // data which can be read at once after an idle period. By default, the size
+  // of a memory page. |
+  std::string cfgByteRateBurst = "";
+  cfg.getOptionalValue<std::string>(cfgEntryPoint + ".byteRateBurst",
+                                    cfgByteRateBurst);
+  // configuration parameter: | equipment-* | byteRatePerLink | bytes | 0 |
+  // Data rate limit for each link, in bytes per second (e.g. 400000000 to
+  // emulate a 3.2 Gb/s GBT link). Applies to pages with a link id set. When
+  // the limit of a link is reached, the page is kept aside and the whole
+  // equipment waits until it can be sent: pages are not reordered, so a
+  // throttled link also holds back the other links of the equipment
+  // (backpressure, as with a single DMA stream). 0 for unlimited. |
+  std::string cfgByteRatePerLink = "0";
+  cfg.getOptionalValue<std::string>(cfgEntryPoint + ".byteRatePerLink",
+                                    cfgByteRatePerLink);
+  uint64_t byteRateBurst = (uint64_t)memoryPoolPageSize;
+  if (cfgByteRateBurst.length()) {
+    byteRateBurst = (uint64_t)ReadoutUtils::getNumberOfBytesFromString(
+        cfgByteRateBurst.c_str());
+  }
+  double byteRate =
+      (double)ReadoutUtils::getNumberOfBytesFromString(cfgByteRate.c_str());
+  double byteRatePerLink = (double)ReadoutUtils::getNumberOfBytesFromString(
+      cfgByteRatePerLink.c_str());
+  byteRateLimit.configure(byteRate, byteRateBurst);
+  if (byteRatePerLink > 0) {
+    linkByteRateLimits.resize(RdhMaxLinkId + 1);
+    for (auto &l : linkByteRateLimits) {
+      l.configure(byteRatePerLink, byteRateBurst);
+    }
+  }
+
   // log config summary
   theLog.log("Equipment %s: from config [%s], max rate=%lf Hz, "
-             "idleSleepTime=%d us, outputFifoSize=%d",
+             "idleSleepTime=%d us, idlePolicy=%s, outputFifoSize=%d, "
+             "cpuAffinity=%s",
              name.c_str(), cfgEntryPoint.c_str(), readoutRate, cfgIdleSleepTime,
-             cfgOutputFifoSize);
+             cfgIdlePolicy.c_str(), cfgOutputFifoSize,
+             threadPlacement.getDescription().c_str());
+  if ((byteRate > 0) || (byteRatePerLink > 0)) {
+    theLog.log("Equipment %s: max byte rate = %s, per link = %s, burst = %s",
+               name.c_str(),
+               (byteRate > 0)
+                   ? ReadoutUtils::NumberOfBytesToString(byteRate, "B/s").c_str()
+                   : "unlimited",
+               (byteRatePerLink > 0) ? ReadoutUtils::NumberOfBytesToString(
+                                           byteRatePerLink, "B/s")
+                                           .c_str()
+                                     : "unlimited",
+               ReadoutUtils::NumberOfBytesToString(byteRateBurst, "B").c_str());
+  }
   theLog.log("Equipment %s: requesting memory pool %d pages x %d bytes from "
-             "bank '%s', block aligned @ 0x%X, 1st page offset @ 0x%X",
+             "bank '%s', block aligned @ 0x%X, 1st page offset @ 0x%X, "
+             "fifo type %s",
              name.c_str(), (int)memoryPoolNumberOfPages,
              (int)memoryPoolPageSize, memoryBankName.c_str(),
-             (int)cfgBlockAlign, (int)cfgFirstPageOffset);
+             (int)cfgBlockAlign, (int)cfgFirstPageOffset,
+             cfgMemoryPoolFifoType.c_str());
   if (disableOutput) {
     theLog.log("Equipment %s: output DISABLED ! Data will be readout and "
                "dropped immediately",
@@ -167,7 +348,7 @@ ReadoutEquipment::ReadoutEquipment(ConfigFile &cfg, std::string cfgEntryPoint) {
   try {
     mp = theMemoryBankManager.getPagedPool(
         memoryPoolPageSize, memoryPoolNumberOfPages, memoryBankName,
-        firstPageOffset, cfgBlockAlign);
+        firstPageOffset, cfgBlockAlign, memoryPoolFifoType);
   } catch (...) {
   }
   if (mp == nullptr) {
@@ -175,18 +356,36 @@ ReadoutEquipment::ReadoutEquipment(ConfigFile &cfg, std::string cfgEntryPoint) {
                "Failed to create pool of memory pages");
     throw __LINE__;
   }
+  if (threadPlacement.isAuto()) {
+    auto bank = theMemoryBankManager.getBank(memoryBankName);
+    if (bank != nullptr) {
+      threadPlacement.setAutoNumaNode(bank->getNumaNode());
+    }
+  }
+  if (cfgMemoryPoolThreadCacheSize > 0) {
+    mp->setThreadCacheSize(cfgMemoryPoolThreadCacheSize);
+    theLog.log("Equipment %s: memory pool thread cache size = %d pages",
+               name.c_str(), cfgMemoryPoolThreadCacheSize);
+  }
+  if (cfgMemoryPoolTracking) {
+    mp->enableTracking(name);
+    theLog.log("Equipment %s: memory pool tracking enabled", name.c_str());
+  }
+  // keep per-page data (e.g. RDH index) for the next processing stages
+  mp->enablePageCache();
 
   // create output fifo
-  dataOut =
-      std::make_shared<AliceO2::Common::Fifo<DataBlockContainerReference>>(
-          cfgOutputFifoSize);
+  dataOut = std::make_shared<FifoSPSC<DataBlockContainerReference>>(
+      cfgOutputFifoSize);
   if (dataOut == nullptr) {
     throw __LINE__;
   }
 
   // create thread
-  readoutThread = std::make_unique<Thread>(ReadoutEquipment::threadCallback,
-                                           this, name, cfgIdleSleepTime);
+  // with adaptive idle policy, waiting is done in the callback
+  readoutThread = std::make_unique<Thread>(
+      ReadoutEquipment::threadCallback, this, name,
+      (idleBackoff != nullptr) ? 0 : cfgIdleSleepTime);
   if (readoutThread == nullptr) {
     throw __LINE__;
   }
@@ -204,6 +403,17 @@ void ReadoutEquipment::start() {
   currentBlockId = 0;
   isDataOn = false;
 
+  // reset timeframe ids
+  // (with TFsource=auto, the default of the equipment is kept)
+  TimeframeIdAssigner::Source timeframeIdSource = defaultTimeframeIdSource;
+  TimeframeIdAssigner::getSourceFromString(cfgTimeframeIdSource,
+                                           timeframeIdSource);
+  timeframeIdAssigner.setSource(timeframeIdSource);
+  timeframeIdAssigner.reset();
+  theLog.log("Equipment %s: timeframe length = %d orbits, ids from %s",
+             name.c_str(), (int)timeframeIdAssigner.getPeriod(),
+             TimeframeIdAssigner::getSourceName(timeframeIdSource));
+
   // reset equipment counters
   initCounters();
 
@@ -216,6 +426,17 @@ void ReadoutEquipment::start() {
   // reset stats timer
   consoleStatsTimer.reset(cfgConsoleStatsUpdateTime * 1000000);
 
+  // reset byte rate limits
+  byteRateLimit.reset();
+  for (auto &l : linkByteRateLimits) {
+    l.reset();
+  }
+
+  if (idleBackoff != nullptr) {
+    idleBackoff->reset();
+  }
+
+  isThreadPlaced = false;
   readoutThread->start();
 }
 
@@ -230,6 +451,9 @@ void ReadoutEquipment::stop() {
   // block/s\n",nBlocksOut,clk0.getTimer(),nBlocksOut/clk0.getTime());
   readoutThread->join();
 
+  // release page waiting for link rate limit, if any
+  throttledBlock = nullptr;
+
   finalCounters();
 
   for (int i = 0; i < (int)EquipmentStatsIndexes::maxIndex; i++) {
@@ -257,6 +481,14 @@ void ReadoutEquipment::stop() {
           1.0 /
           (equipmentStats[EquipmentStatsIndexes::nLoop].get() -
            equipmentStats[EquipmentStatsIndexes::nIdle].get()));
+  if (idleBackoff != nullptr) {
+    theLog.log("Idle time: spinning %.3fs, yielding %.3fs, sleeping %.3fs",
+               equipmentStats[EquipmentStatsIndexes::idleSpinTime].get() / 1e6,
+               equipmentStats[EquipmentStatsIndexes::idleYieldTime].get() /
+                   1e6,
+               equipmentStats[EquipmentStatsIndexes::idleSleepTime].get() /
+                   1e6);
+  }
   theLog.log(
       "Average data throughput: %s",
       ReadoutUtils::NumberOfBytesToString(
@@ -282,6 +514,12 @@ DataBlockContainerReference ReadoutEquipment::getBlock() {
 Thread::CallbackResult ReadoutEquipment::threadCallback(void *arg) {
   ReadoutEquipment *ptr = static_cast<ReadoutEquipment *>(arg);
 
+  // apply thread placement, on first iteration
+  if (!ptr->isThreadPlaced) {
+    ptr->threadPlacement.apply(ptr->name);
+    ptr->isThreadPlaced = true;
+  }
+
   // flag to identify if something was done in this iteration
   bool isActive = false;
 
@@ -321,57 +559,94 @@ Thread::CallbackResult ReadoutEquipment::threadCallback(void *arg) {
     }
 
     // try to get new blocks
+    // they are pushed to output FIFO by batches. The space available in output
+    // FIFO is checked once, it can only grow while we fill it.
     int nPushedOut = 0;
+    int nOutputFree = ptr->dataOut->getNumberOfFreeSlots();
     for (int i = 0; i < maxBlocksToRead; i++) {
 
       // check output FIFO status so that we are sure we can push next block, if
       // any
-      if (ptr->dataOut->isFull()) {
+      if ((!ptr->disableOutput) && (nPushedOut >= nOutputFree)) {
         ptr->equipmentStats[EquipmentStatsIndexes::nOutputFull].increment();
         break;
       }
 
-      // get next block
       DataBlockContainerReference nextBlock = nullptr;
-      try {
-        nextBlock = ptr->getNextBlock();
-      } catch (...) {
-        theLog.log(InfoLogger::Severity::Warning, "getNextBlock() exception");
-        break;
-      }
-      // printf("getNextBlock=%p\n",nextBlock);
-      if (nextBlock == nullptr) {
-        break;
-      }
+      if (ptr->throttledBlock != nullptr) {
+        // page kept aside, waiting for the rate limit of its link
+        nextBlock = std::move(ptr->throttledBlock);
+        ptr->throttledBlock = nullptr;
+      } else {
+        // check byte rate
+        if ((ptr->byteRateLimit.isEnabled()) &&
+            (!ptr->byteRateLimit.isAvailable())) {
+          ptr->equipmentStats[EquipmentStatsIndexes::nThrottle].increment();
+          break;
+        }
 
-      // tag data with equipment Id, if set
-      // (will overwrite field if was already set by equipment)
-      if (ptr->id != undefinedEquipmentId) {
-        nextBlock->getData()->header.equipmentId = ptr->id;
-      }
+        // get next block
+        try {
+          nextBlock = ptr->getNextBlock();
+        } catch (...) {
+          theLog.log(InfoLogger::Severity::Warning,
+                     "getNextBlock() exception");
+          break;
+        }
+        // printf("getNextBlock=%p\n",nextBlock);
+        if (nextBlock == nullptr) {
+          break;
+        }
 
-      // tag data with block id
-      ptr->currentBlockId++; // don't start from 0
-      nextBlock->getData()->header.blockId = ptr->currentBlockId;
-
-      // tag data with (dummy) timeframeid, if none set
-      if (nextBlock->getData()->header.timeframeId == undefinedTimeframeId) {
-        nextBlock->getData()->header.timeframeId =
-            nextBlock->getData()->header.blockId;
-        // this should be done by something smarter, e.g. looking into the
-        // payload to set timeframeid the code from ROC equipment extracting
-        // timestamps from RDH (and software clock if no RDH) should be moved
-        // here and common to all
-      }
+        // tag data with equipment Id, if set
+        // (will overwrite field if was already set by equipment)
+        if (ptr->id != undefinedEquipmentId) {
+          nextBlock->getData()->header.equipmentId = ptr->id;
+        }
 
-      if (!ptr->disableOutput) {
-        // push new page to output fifo
-        ptr->dataOut->push(nextBlock);
+        // tag data with block id
+        ptr->currentBlockId++; // don't start from 0
+        nextBlock->getData()->header.blockId = ptr->currentBlockId;
+
+        // tag data with timeframe id
+        if (ptr->timeframeIdAssigner.assign(nextBlock->getData())) {
+          // not found in page (e.g. wrong first RDH), if none set:
+          // with ids from RDH, keep the current timeframe, so that the page
+          // does not break the sequence of timeframes. Otherwise, use block
+          // id.
+          if (nextBlock->getData()->header.timeframeId ==
+              undefinedTimeframeId) {
+            if (ptr->timeframeIdAssigner.getSource() ==
+                TimeframeIdAssigner::FirstRdhInPage) {
+              nextBlock->getData()->header.timeframeId =
+                  ptr->timeframeIdAssigner.getLastTimeframeId();
+            } else {
+              nextBlock->getData()->header.timeframeId =
+                  nextBlock->getData()->header.blockId;
+            }
+          }
+        }
+
+        if (ptr->byteRateLimit.isEnabled()) {
+          ptr->byteRateLimit.consume(nextBlock->getData()->header.dataSize);
+        }
       }
 
-      // update rate-limit clock
-      if (ptr->readoutRate > 0) {
-        ptr->clk.increment();
+      // check byte rate of the link
+      if (ptr->linkByteRateLimits.size()) {
+        uint8_t linkId = nextBlock->getData()->header.linkId;
+        if (linkId < ptr->linkByteRateLimits.size()) {
+          TokenBucket &linkLimit = ptr->linkByteRateLimits[linkId];
+          if (!linkLimit.isAvailable()) {
+            // keep page aside until the link can send it. The equipment is
+            // held meanwhile (also for other links), so that pages are not
+            // reordered.
+            ptr->throttledBlock = std::move(nextBlock);
+            ptr->equipmentStats[EquipmentStatsIndexes::nThrottle].increment();
+            break;
+          }
+          linkLimit.consume(nextBlock->getData()->header.dataSize);
+        }
       }
 
       // update stats
@@ -380,7 +655,21 @@ Thread::CallbackResult ReadoutEquipment::threadCallback(void *arg) {
           nextBlock->getData()->header.dataSize);
       gReadoutStats.bytesReadout += nextBlock->getData()->header.dataSize;
       isActive = true;
+
+      if (!ptr->disableOutput) {
+        // queue new page for output fifo
+        ptr->outputBatch[ptr->outputBatchSize++] = std::move(nextBlock);
+        if (ptr->outputBatchSize == maxOutputBatchSize) {
+          ptr->flushOutputBatch();
+        }
+      }
+
+      // update rate-limit clock
+      if (ptr->readoutRate > 0) {
+        ptr->clk.increment();
+      }
     }
+    ptr->flushOutputBatch();
     ptr->equipmentStats[EquipmentStatsIndexes::nBlocksOut].increment(
         nPushedOut);
 
@@ -430,11 +719,44 @@ Thread::CallbackResult ReadoutEquipment::threadCallback(void *arg) {
 
   if (!isActive) {
     ptr->equipmentStats[EquipmentStatsIndexes::nIdle].increment();
+    if (ptr->idleBackoff != nullptr) {
+      AdaptiveBackoff::WaitType waitType;
+      uint64_t t = ptr->idleBackoff->idle(waitType) / 1000;
+      switch (waitType) {
+      case AdaptiveBackoff::Spin:
+        ptr->equipmentStats[EquipmentStatsIndexes::idleSpinTime].increment(t);
+        break;
+      case AdaptiveBackoff::Yield:
+        ptr->equipmentStats[EquipmentStatsIndexes::idleYieldTime].increment(t);
+        break;
+      case AdaptiveBackoff::Sleep:
+        ptr->equipmentStats[EquipmentStatsIndexes::idleSleepTime].increment(t);
+        break;
+      }
+    } else {
+      ptr->equipmentStats[EquipmentStatsIndexes::idleSleepTime].increment(
+          ptr->cfgIdleSleepTime);
+    }
     return Thread::CallbackResult::Idle;
   }
+  if (ptr->idleBackoff != nullptr) {
+    ptr->idleBackoff->setActive();
+  }
   return Thread::CallbackResult::Ok;
 }
 
+void ReadoutEquipment::flushOutputBatch() {
+  if (outputBatchSize == 0) {
+    return;
+  }
+  // space was checked before filling the batch, all blocks fit
+  dataOut->pushBatch(outputBatch, outputBatchSize);
+  for (int i = 0; i < outputBatchSize; i++) {
+    outputBatch[i] = nullptr;
+  }
+  outputBatchSize = 0;
+}
+
 void ReadoutEquipment::setDataOn() { isDataOn = true; }
 
 void ReadoutEquipment::setDataOff() { isDataOn = false; }
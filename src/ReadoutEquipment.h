@@ -19,8 +19,13 @@
 
 #include <memory>
 
+#include "AdaptiveBackoff.h"
 #include "CounterStats.h"
+#include "FifoSPSC.h"
 #include "MemoryHandler.h"
+#include "ThreadPlacement.h"
+#include "TimeframeIdAssigner.h"
+#include "TokenBucket.h"
 
 #include "MemoryBankManager.h"
 
@@ -52,16 +57,37 @@ public:
 
   // protected:
   // todo: give direct access to output FIFO?
-  std::shared_ptr<AliceO2::Common::Fifo<DataBlockContainerReference>> dataOut;
+  std::shared_ptr<FifoSPSC<DataBlockContainerReference>> dataOut;
 
   // get current memory pool usage (available and total)
-  int getMemoryUsage(size_t &numberOfPagesAvailable,
-                     size_t &numberOfPagesInPool);
+  virtual int getMemoryUsage(size_t &numberOfPagesAvailable,
+                             size_t &numberOfPagesInPool);
 
 private:
   std::unique_ptr<Thread> readoutThread;
   static Thread::CallbackResult threadCallback(void *arg);
 
+  // blocks ready, to be pushed to output fifo in one go
+  static const int maxOutputBatchSize = 64;
+  DataBlockContainerReference outputBatch[maxOutputBatchSize];
+  int outputBatchSize = 0;
+  void flushOutputBatch(); // push to output fifo the blocks in outputBatch
+
+  int cfgIdleSleepTime = 200; // thread idle sleep time, in microseconds
+  std::unique_ptr<AdaptiveBackoff>
+      idleBackoff; // adaptive waiting policy when idle (if null, the thread
+                   // sleeps cfgIdleSleepTime after each idle iteration)
+
+  bool isThreadPlaced = false; // set once placement applied in readout thread
+
+  std::string cfgTimeframeIdSource = "auto"; // source of timeframe ids
+
+  TokenBucket byteRateLimit; // byte rate limit of the equipment
+  std::vector<TokenBucket>
+      linkByteRateLimits; // byte rate limit of each link (empty if none)
+  DataBlockContainerReference
+      throttledBlock; // page read, waiting for the rate limit of its link
+
   // Function called iteratively in dedicated thread to populate FIFO.
   // The equipmentStats member variable should be updated.
   // calling sequence: prepareBlocks() + iterate getNextBlock()
@@ -78,6 +104,20 @@ protected:
   // data enabled ? controlled by setDataOn/setDataOff
   bool isDataOn = false;
 
+  // placement of readout thread (CPU affinity / NUMA node)
+  // in auto mode, NUMA node of the memory bank used, unless redefined by
+  // derived class (e.g. NUMA node of the readout card)
+  ThreadPlacement threadPlacement;
+
+  // timeframe ids of the pages, assigned in readout thread after
+  // getNextBlock(). The derived class may use it to cut pages on timeframe
+  // boundaries.
+  TimeframeIdAssigner timeframeIdAssigner;
+  // source of timeframe ids used when not set in configuration (TFsource=auto)
+  // may be changed by derived class constructor
+  TimeframeIdAssigner::Source defaultTimeframeIdSource =
+      TimeframeIdAssigner::SoftwareClock;
+
   // Definition of performance counters for readout statistics.
   // Each counter is assigned a unique integer index (incremental, starting 0).
   // The last element can be used to get the number of counters defined.
@@ -101,7 +141,10 @@ protected:
     fifoOccupancyOutBlocks = 12,
     nPagesUsed = 13, // number of used pages in memory pool
     nPagesFree = 14, // number of free pages in memory pool
-    maxIndex = 15    // not a counter, used to know number of elements in enum
+    idleSpinTime = 15,  // time spent spinning when idle (microseconds)
+    idleYieldTime = 16, // time spent yielding CPU when idle (microseconds)
+    idleSleepTime = 17, // time spent sleeping when idle (microseconds)
+    maxIndex = 18 // not a counter, used to know number of elements in enum
   };
 
   // Display names of the performance counters.
@@ -121,7 +164,10 @@ protected:
       "fifoOccupancyReadyBlocks",
       "fifoOccupancyOutBlocks",
       "nPagesUsed",
-      "nPagesFree"};
+      "nPagesFree",
+      "idleSpinTime",
+      "idleYieldTime",
+      "idleSleepTime"};
 
   // check consistency (size) of EquipmentStatsNames with EquipmentStatsIndexes
   static_assert((sizeof(EquipmentStatsNames) /
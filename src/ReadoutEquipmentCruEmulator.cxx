@@ -15,10 +15,147 @@
 using namespace AliceO2::InfoLogger;
 extern InfoLogger theLog;
 
+#include "FifoSPSC.h"
 #include "RAWDataHeader.h"
-#include <Common/Fifo.h>
+#include "RdhUtils.h"
 #include <Common/Timer.h>
+#include <atomic>
+#include <math.h>
 #include <stdlib.h>
+#include <string.h>
+#include <thread>
+#include <unistd.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+// fast pseudo-random number generator (xorshift64*)
+// one per generating thread, rand() being slow and with a shared state
+class FastRandom {
+public:
+  void seed(uint64_t s) { state = (s != 0) ? s : 0x9E3779B97F4A7C15ULL; }
+  uint64_t next() {
+    state ^= state >> 12;
+    state ^= state << 25;
+    state ^= state >> 27;
+    return state * 0x2545F4914F6CDD1DULL;
+  }
+  // uniform value in [0,1[
+  double getUniform() { return (next() >> 11) * (1.0 / (1ULL << 53)); }
+
+  // number of events in a Poisson process of given mean
+  int getPoisson(double mean) {
+    if (mean <= 0) {
+      return 0;
+    }
+    if (mean > 30) {
+      // gaussian approximation (Box-Muller)
+      double u1 = 1.0 - getUniform();
+      double u2 = getUniform();
+      double g = sqrt(-2.0 * log(u1)) * cos(2 * M_PI * u2);
+      double n = floor(mean + sqrt(mean) * g + 0.5);
+      return (n > 0) ? (int)n : 0;
+    }
+    double l = exp(-mean);
+    double p = getUniform();
+    int n = 0;
+    while (p > l) {
+      n++;
+      p *= getUniform();
+    }
+    return n;
+  }
+
+  // uniform value in [0,1[ derived from a key, without generator state
+  // (same value for a given key, whatever the thread)
+  static double getUniformFromKey(uint64_t key) {
+    uint64_t z = key + 0x9E3779B97F4A7C15ULL;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    z = z ^ (z >> 31);
+    return (z >> 11) * (1.0 / (1ULL << 53));
+  }
+
+private:
+  uint64_t state = 0x9E3779B97F4A7C15ULL;
+};
+
+// pre-built image of the RDH of a link, as 64-bit words
+// Fields constant for the link are set once, and the fields changing for each
+// packet are patched in a copy of the image, which is then written at once in
+// the page (instead of a copy of a default RDH followed by the update of each
+// bitfield).
+class RdhTemplate {
+public:
+  static const int numberOfWords =
+      sizeof(o2::Header::RAWDataHeader) / sizeof(uint64_t);
+  static_assert(sizeof(o2::Header::RAWDataHeader) == 64,
+                "RDH template assumes 64-byte RDH");
+
+  void init(int linkId, int feeId, int blockSize) {
+    o2::Header::RAWDataHeader rdh;
+    rdh.blockLength = (uint16_t)blockSize;
+    rdh.feeId = feeId;
+    rdh.linkId = linkId;
+    rdh.offsetNextPacket = blockSize;
+    // variable fields, set for each packet
+    rdh.memorySize = 0;
+    rdh.triggerOrbit = 0;
+    rdh.heartbeatOrbit = 0;
+    rdh.triggerBC = 0;
+    rdh.stopBit = 0;
+    rdh.pagesCounter = 0;
+    memcpy(words, &rdh, sizeof(words));
+  }
+
+  // write RDH with given variable fields at destination
+  // bit positions as defined in RAWDataHeaderV4 (little endian)
+  void write(void *dest, uint32_t triggerOrbit, uint32_t heartbeatOrbit,
+             uint32_t triggerBC, uint16_t memorySize, uint16_t pagesCounter,
+             uint8_t stopBit) const {
+    uint64_t w1 = words[1] | (((uint64_t)memorySize) << 16);
+    uint64_t w2 = triggerOrbit | (((uint64_t)heartbeatOrbit) << 32);
+    uint64_t w4 = words[4] | (triggerBC & 0xFFF);
+    uint64_t w6 = words[6] | (((uint64_t)stopBit) << 32) |
+                  (((uint64_t)pagesCounter) << 40);
+    // words built in registers, and written with 16-byte stores
+#ifdef __SSE2__
+    __m128i *d = (__m128i *)dest;
+    _mm_storeu_si128(&d[0], _mm_set_epi64x(w1, words[0]));
+    _mm_storeu_si128(&d[1], _mm_set_epi64x(words[3], w2));
+    _mm_storeu_si128(&d[2], _mm_set_epi64x(words[5], w4));
+    _mm_storeu_si128(&d[3], _mm_set_epi64x(words[7], w6));
+#else
+    uint64_t w[numberOfWords] = {words[0], w1, w2, words[3],
+                                 w4,       words[5], w6, words[7]};
+    memcpy(dest, w, sizeof(w));
+#endif
+  }
+
+private:
+  uint64_t words[numberOfWords];
+};
+
+// fill memory range with a 64-bit pattern, bypassing the cache if possible
+// (caller should issue a store fence before publishing the data)
+static void fillNonTemporal(char *ptr, size_t size, uint64_t pattern) {
+  size_t i = 0;
+#ifdef __SSE2__
+  if (((size_t)ptr % 16) == 0) {
+    __m128i v = _mm_set1_epi64x((long long)pattern);
+    for (; i + 16 <= size; i += 16) {
+      _mm_stream_si128((__m128i *)&ptr[i], v);
+    }
+  }
+#endif
+  for (; i + 8 <= size; i += 8) {
+    memcpy(&ptr[i], &pattern, 8);
+  }
+  for (; i < size; i++) {
+    ptr[i] = ((char *)&pattern)[i % 8];
+  }
+}
 
 class ReadoutEquipmentCruEmulator : public ReadoutEquipment {
 
@@ -28,32 +165,23 @@ public:
   ~ReadoutEquipmentCruEmulator();
   DataBlockContainerReference getNextBlock();
   Thread::CallbackResult prepareBlocks();
+  void setDataOn();
+  void setDataOff();
 
 private:
   void initCounters();
   void finalCounters();
 
-  Thread::CallbackResult populateFifoOut(); // iterative callback
-
-  uint64_t currentTimeframeId; // current timeframe id
-
   int cfgNumberOfLinks; // number of links to simulate. Will create data blocks
                         // round-robin.
   int cfgFeeId;         // FEE id to be used
   int cfgLinkId; // Link id to be used (base number - will be incremented if
                  // multiple links selected)
 
-  const unsigned int LHCBunches = 3564; // number of bunches in LHC
-  const unsigned int LHCOrbitRate =
-      11246; // LHC orbit rate, in Hz. 299792458 / 26659
-  const unsigned int LHCBCRate =
-      LHCOrbitRate * LHCBunches; // LHC bunch crossing rate, in Hz
-
   int cruBlockSize; // size of 1 data block (RDH+payload)
   int bcStep; // interval in BC clocks between two CRU block transfers, based on
               // link input data rate
 
-  int cfgTFperiod = 256; // duration of a timeframe, in number of LHC orbits
   int cfgHBperiod =
       1; // interval between 2 HeartBeat triggers, in number of LHC orbits
   double cfgGbtLinkThroughput =
@@ -66,24 +194,94 @@ private:
   double cfgEmptyHbRatio = 0.0;   // amount of empty HB frames
   int cfgPayloadSize = 64 * 1024; // maximum payload size, randomized
 
+  int cfgRealTime = 1; // if set, data generation paced by the LHC clock
+  int cfgNumberOfThreads = 0; // number of generating threads (0: data
+                              // generated in readout thread)
+  int cfgFillPayload = 0; // if set, payload filled with a pattern
+
+  // load model
+  double cfgTriggersPerHb = 0; // mean number of triggers per HB (Poisson), or
+                               // 0 for one payload per HB
+  std::vector<double> linkOccupancy; // payload scale factor for each link
+  int cfgFeeIdsPerLink = 1;          // number of FEE in each link
+  double cfgBurstProbability = 0;    // probability of a burst period
+  int cfgBurstLength = 100;          // duration of a burst period, in orbits
+  double cfgBurstFactor = 4;         // payload scale factor in bursts
+
+  // statistics on the generated load, for each group of links
+  class loadStats {
+  public:
+    static const int maxTriggers = 16; // last histogram bin for overflows
+    uint64_t nHb = 0;                  // number of HB frames
+    uint64_t nHbEmpty = 0;             // number of empty HB frames
+    uint64_t nHbBurst = 0;             // number of HB frames in bursts
+    uint64_t nTriggers = 0;            // number of triggers
+    uint64_t triggersHistogram[maxTriggers + 1] = {0}; // HB per triggers
+    uint64_t nPayload = 0;     // number of payloads (1 per HB and FEE)
+    uint64_t payloadBytes = 0; // total payload size
+    uint64_t payloadMax = 0;   // biggest payload
+    void add(const loadStats &s);
+  };
+
   class linkState {
   public:
+    int linkId = 0;
+    uint32_t LHCorbit = 0; // current LHC orbit
+    uint32_t LHCbc = 0;    // current LHC bunch crossing
     int HBpagecount = 0;
     int isEmpty = 0;
     int payloadBytesLeft = -1;
+    int feeIndex = 0;          // current FEE of the link
+    int hbTriggers = 0;        // number of triggers in current HB
+    bool isBurst = false;      // set if current HB in a burst period
+    double occupancy = 1.0;    // payload scale factor of this link
+    DataBlockContainerReference pendingBlock; // page being filled
+    std::vector<RdhTemplate> rdhTemplates; // RDH of each FEE of this link
+  };
+
+  // a group of links, generated by the same thread
+  class linkGroup {
+  public:
+    std::vector<linkState> links;
+    FastRandom random; // random generator used for this group
+    double t0 = -1;    // time of first block generated
+    std::unique_ptr<FifoSPSC<DataBlockContainerReference>>
+        readyBlocks; // pages ready to be retrieved by getNextBlock()
+    std::unique_ptr<std::thread> generatorThread; // thread generating the data
+                                                  // (if any)
+    uint64_t nPages = 0; // number of pages generated
+    loadStats stats;     // statistics of generated load
   };
-  std::map<int, linkState> perLinkState;
+  std::vector<linkGroup> linkGroups;
+  int nextGroup = 0; // group where to look first for a page in getNextBlock()
+
+  // generate a page for each link of the group, when space available
+  Thread::CallbackResult generateBlocks(linkGroup &g);
+
+  // fill a page with RDH packets for a link, up to the end of page or next
+  // timeframe. Returns number of bytes used.
+  int fillPage(DataBlock *b, linkState &ls, linkGroup &g);
+
+  // start a new HB frame for a link: number of triggers, burst, empty HB
+  void startHb(linkState &ls, linkGroup &g, uint32_t orbit);
 
-  uint32_t LHCorbit = 0; // current LHC orbit
-  uint32_t LHCbc = 0;    // current LHC bunch crossing
+  // get random payload size for the current HB and FEE of a link
+  int getPayloadSize(linkState &ls, linkGroup &g);
+
+  // loop of a generating thread
+  void runGenerator(linkGroup &g, const std::string &threadName);
+
+  void startGenerators();
+  void stopGenerators();
+
+  std::atomic<bool> isGeneratorRunning; // cleared to stop generating threads
+
+  // timeframe period, copied for use from generating threads
+  uint32_t timeframePeriod = 256;
 
   Timer elapsedTime; // elapsed time since equipment started
-  double t0 = 0;     // time of first block generated
 
-  std::unique_ptr<AliceO2::Common::Fifo<DataBlockContainerReference>>
-      readyBlocks; // pages ready to be retrieved by getNextBlock()
-  std::vector<DataBlockContainerReference>
-      pendingBlocks; // pages being filled (1 per link)
+  static const int generatorIdleSleepTime = 100; // in microseconds
 };
 
 ReadoutEquipmentCruEmulator::ReadoutEquipmentCruEmulator(
@@ -101,8 +299,6 @@ ReadoutEquipmentCruEmulator::ReadoutEquipmentCruEmulator(
   // for FEE Id field in RDH. | configuration parameter: |
   // equipment-cruemulator-* | linkId | int | 0 | Id of first link. If
   // numberOfLinks>1, ids will range from linkId to linkId+numberOfLinks-1. |
-  // configuration parameter: | equipment-cruemulator-* | TFperiod | int | 256 |
-  // Duration of a timeframe, in number of LHC orbits. | configuration
   // configuration parameter: | equipment-cruemulator-* | HBperiod | int | 1 |
   // Interval between 2 HeartBeat triggers, in number of LHC orbits. |
   // configuration parameter: | equipment-cruemulator-* | EmptyHbRatio | double
@@ -110,6 +306,39 @@ ReadoutEquipmentCruEmulator::ReadoutEquipmentCruEmulator(
   // configuration parameter: | equipment-cruemulator-* | PayloadSize | int |
   // 64k | Maximum payload size for each trigger. Actual size is randomized, and
   // then split in a number of (cruBlockSize) packets. |
+  // configuration parameter: | equipment-cruemulator-* | realTime | int | 1 |
+  // If 1, data generation is paced by the LHC clock, each link producing data
+  // at the GBT link rate. If 0, data is generated as fast as possible, e.g. to
+  // measure the maximum throughput of the rest of the readout chain. |
+  // configuration parameter: | equipment-cruemulator-* | numberOfThreads | int
+  // | 0 | Number of threads generating data. Links are distributed round-robin
+  // between them, each thread filling pages for its own group of links. If 0,
+  // data is generated in the readout thread of the equipment. Needs
+  // memoryPoolFifoType=mpmc. |
+  // configuration parameter: | equipment-cruemulator-* | fillPayload | int |
+  // 0 | If 1, the payload of each packet is filled with a 64-bit pattern
+  // (orbit, BC and link id of the packet), written with non-temporal stores
+  // when possible. If 0, the payload is left as is in the memory pages. |
+  // configuration parameter: | equipment-cruemulator-* | triggersPerHb |
+  // double | 0 | If non-zero, the number of triggers in each HB frame follows
+  // a Poisson distribution of this mean, each trigger adding a random payload
+  // (up to PayloadSize), and HB frames without trigger are empty. If 0, each
+  // HB frame has a single random payload, and EmptyHbRatio is used. |
+  // configuration parameter: | equipment-cruemulator-* | linkOccupancy |
+  // string | | Comma-separated list of payload scale factors, one per link
+  // (cycled if shorter than the number of links), to simulate links with
+  // different occupancies, e.g. 1,0.5,0.2. |
+  // configuration parameter: | equipment-cruemulator-* | feeIdsPerLink | int |
+  // 1 | Number of FEE per link. Each HB frame then contains one payload per
+  // FEE, with FEE ids ranging from feeId to feeId+feeIdsPerLink-1. |
+  // configuration parameter: | equipment-cruemulator-* | burstProbability |
+  // double | 0 | Probability for a period of burstLength orbits to be a burst
+  // (pile-up), where payloads are scaled by burstFactor. Bursts happen at the
+  // same time on all links. |
+  // configuration parameter: | equipment-cruemulator-* | burstLength | int |
+  // 100 | Duration of a burst period, in number of LHC orbits. |
+  // configuration parameter: | equipment-cruemulator-* | burstFactor | double
+  // | 4 | Payload scale factor during bursts. |
 
   cfg.getOptionalValue<int>(cfgEntryPoint + ".maxBlocksPerPage",
                             cfgMaxBlocksPerPage, (int)0);
@@ -119,31 +348,117 @@ ReadoutEquipmentCruEmulator::ReadoutEquipmentCruEmulator(
                             (int)1);
   cfg.getOptionalValue<int>(cfgEntryPoint + ".feeId", cfgFeeId, (int)0);
   cfg.getOptionalValue<int>(cfgEntryPoint + ".linkId", cfgLinkId, (int)0);
-  cfg.getOptionalValue<int>(cfgEntryPoint + ".TFperiod", cfgTFperiod);
   cfg.getOptionalValue<int>(cfgEntryPoint + ".HBperiod", cfgHBperiod);
   cfg.getOptionalValue<double>(cfgEntryPoint + ".EmptyHbRatio",
                                cfgEmptyHbRatio);
   cfg.getOptionalValue<int>(cfgEntryPoint + ".PayloadSize", cfgPayloadSize);
+  cfg.getOptionalValue<int>(cfgEntryPoint + ".realTime", cfgRealTime);
+  cfg.getOptionalValue<int>(cfgEntryPoint + ".numberOfThreads",
+                            cfgNumberOfThreads);
+  cfg.getOptionalValue<int>(cfgEntryPoint + ".fillPayload", cfgFillPayload);
+  cfg.getOptionalValue<double>(cfgEntryPoint + ".triggersPerHb",
+                               cfgTriggersPerHb);
+  std::string cfgLinkOccupancy;
+  cfg.getOptionalValue<std::string>(cfgEntryPoint + ".linkOccupancy",
+                                    cfgLinkOccupancy);
+  cfg.getOptionalValue<int>(cfgEntryPoint + ".feeIdsPerLink",
+                            cfgFeeIdsPerLink);
+  cfg.getOptionalValue<double>(cfgEntryPoint + ".burstProbability",
+                               cfgBurstProbability);
+  cfg.getOptionalValue<int>(cfgEntryPoint + ".burstLength", cfgBurstLength);
+  cfg.getOptionalValue<double>(cfgEntryPoint + ".burstFactor",
+                               cfgBurstFactor);
 
   // log config summary
   theLog.log("Equipment %s: maxBlocksPerPage=%d cruBlockSize=%d "
              "numberOfLinks=%d feeId=%d linkId=%d TFperiod=%d HBperiod=%d "
-             "EmptyHbRatio=%f PayloadSize=%d",
+             "EmptyHbRatio=%f PayloadSize=%d realTime=%d numberOfThreads=%d "
+             "fillPayload=%d",
              name.c_str(), cfgMaxBlocksPerPage, cruBlockSize, cfgNumberOfLinks,
-             cfgFeeId, cfgLinkId, cfgTFperiod, cfgHBperiod, cfgEmptyHbRatio,
-             cfgPayloadSize);
-
-  // initialize array of pending blocks (to be filled with data)
-  pendingBlocks.resize(cfgNumberOfLinks);
-
-  // output queue: 1 block per link
-  readyBlocks =
-      std::make_unique<AliceO2::Common::Fifo<DataBlockContainerReference>>(
-          cfgNumberOfLinks);
-  if (readyBlocks == nullptr) {
+             cfgFeeId, cfgLinkId, (int)timeframeIdAssigner.getPeriod(),
+             cfgHBperiod, cfgEmptyHbRatio, cfgPayloadSize, cfgRealTime,
+             cfgNumberOfThreads, cfgFillPayload);
+  theLog.log("Equipment %s: triggersPerHb=%f linkOccupancy=%s "
+             "feeIdsPerLink=%d burstProbability=%f burstLength=%d "
+             "burstFactor=%f",
+             name.c_str(), cfgTriggersPerHb, cfgLinkOccupancy.c_str(),
+             cfgFeeIdsPerLink, cfgBurstProbability, cfgBurstLength,
+             cfgBurstFactor);
+
+  // pages cut on timeframe boundaries, TF id from RDH
+  defaultTimeframeIdSource = TimeframeIdAssigner::FirstRdhInPage;
+
+  if (cfgNumberOfLinks < 1) {
+    theLog.log(InfoLogger::Severity::Error,
+               "Equipment %s: wrong number of links %d", name.c_str(),
+               cfgNumberOfLinks);
+    throw __LINE__;
+  }
+  if ((cfgFeeIdsPerLink < 1) || (cfgBurstLength < 1)) {
+    theLog.log(InfoLogger::Severity::Error,
+               "Equipment %s: wrong feeIdsPerLink=%d or burstLength=%d",
+               name.c_str(), cfgFeeIdsPerLink, cfgBurstLength);
+    throw __LINE__;
+  }
+  for (const char *ptr = cfgLinkOccupancy.c_str(); *ptr != 0;) {
+    char *end;
+    double v = strtod(ptr, &end);
+    if ((end == ptr) || (v < 0)) {
+      theLog.log(InfoLogger::Severity::Error,
+                 "Equipment %s: wrong linkOccupancy %s", name.c_str(),
+                 cfgLinkOccupancy.c_str());
+      throw __LINE__;
+    }
+    linkOccupancy.push_back(v);
+    ptr = end;
+    while ((*ptr == ',') || (*ptr == ' ')) {
+      ptr++;
+    }
+  }
+  if (cfgNumberOfThreads < 0) {
+    cfgNumberOfThreads = 0;
+  }
+  if (cfgNumberOfThreads > cfgNumberOfLinks) {
+    cfgNumberOfThreads = cfgNumberOfLinks;
+  }
+  if ((cfgNumberOfThreads > 0) &&
+      (mp->getFifoType() != MemoryPagesPool::MPMC)) {
+    theLog.log(InfoLogger::Severity::Error,
+               "Equipment %s: numberOfThreads=%d needs memoryPoolFifoType=mpmc",
+               name.c_str(), cfgNumberOfThreads);
     throw __LINE__;
   }
 
+  // distribute links in groups, 1 per generating thread
+  // output queue of each group: 1 block per link, a few more when pages are
+  // generated in a separate thread
+  int nGroups = (cfgNumberOfThreads > 0) ? cfgNumberOfThreads : 1;
+  int readyBlocksPerLink = (cfgNumberOfThreads > 0) ? 4 : 1;
+  linkGroups.resize(nGroups);
+  for (int i = 0; i < cfgNumberOfLinks; i++) {
+    linkState ls;
+    ls.linkId = cfgLinkId + i;
+    ls.rdhTemplates.resize(cfgFeeIdsPerLink);
+    for (int j = 0; j < cfgFeeIdsPerLink; j++) {
+      ls.rdhTemplates[j].init(ls.linkId, cfgFeeId + j, cruBlockSize);
+    }
+    if (linkOccupancy.size()) {
+      ls.occupancy = linkOccupancy[i % linkOccupancy.size()];
+    }
+    linkGroups[i % nGroups].links.push_back(ls);
+  }
+  for (int i = 0; i < nGroups; i++) {
+    linkGroup &g = linkGroups[i];
+    g.random.seed(0x9E3779B97F4A7C15ULL * (cfgLinkId + i + 1));
+    g.readyBlocks = std::make_unique<FifoSPSC<DataBlockContainerReference>>(
+        g.links.size() * readyBlocksPerLink);
+    if (g.readyBlocks == nullptr) {
+      throw __LINE__;
+    }
+  }
+
+  isGeneratorRunning = false;
+
   // init parameters
   bcStep = (int)(LHCBCRate *
                  ((cruBlockSize - sizeof(o2::Header::RAWDataHeader)) * 1.0 /
@@ -151,32 +466,51 @@ ReadoutEquipmentCruEmulator::ReadoutEquipmentCruEmulator(
   theLog.log("Equipment %s: using block rate = %d BC", name.c_str(), bcStep);
 }
 
-ReadoutEquipmentCruEmulator::~ReadoutEquipmentCruEmulator() {}
+ReadoutEquipmentCruEmulator::~ReadoutEquipmentCruEmulator() {
+  stopGenerators();
+}
 
 Thread::CallbackResult ReadoutEquipmentCruEmulator::prepareBlocks() {
+  // data generated by separate threads, if configured
+  if (cfgNumberOfThreads > 0) {
+    return Thread::CallbackResult::Idle;
+  }
+  return generateBlocks(linkGroups[0]);
+}
+
+Thread::CallbackResult
+ReadoutEquipmentCruEmulator::generateBlocks(linkGroup &g) {
 
   // cru emulator creates a set of data pages for each link and put them in the
   // fifo to be retrieve by getNextBlock
 
   // check that we don't go faster than LHC...
-  double t = elapsedTime.getTime();
-  if (t0 == 0) {
-    t0 = t;
-  }
-  if (LHCorbit > (uint32_t)((t - t0) * LHCOrbitRate)) {
-    return Thread::CallbackResult::Idle;
+  if (cfgRealTime) {
+    double t = elapsedTime.getTime();
+    if (g.t0 < 0) {
+      g.t0 = t;
+    }
+    uint32_t groupOrbit = g.links[0].LHCorbit;
+    for (auto &ls : g.links) {
+      if (ls.LHCorbit < groupOrbit) {
+        groupOrbit = ls.LHCorbit;
+      }
+    }
+    if (groupOrbit > (uint32_t)((t - g.t0) * LHCOrbitRate)) {
+      return Thread::CallbackResult::Idle;
+    }
   }
 
   // todo: check that we don't go tooooo slow !!!
 
   // wait enough space available in output fifo to to prepare a new set
-  if (readyBlocks->getNumberOfFreeSlots() < cfgNumberOfLinks) {
+  if (g.readyBlocks->getNumberOfFreeSlots() < (int)g.links.size()) {
     return Thread::CallbackResult::Idle;
   }
 
   // get a set of new blocks from memory pool (1 per link)
-  for (int i = 0; i < cfgNumberOfLinks; i++) {
-    if (pendingBlocks[i] != nullptr) {
+  for (auto &ls : g.links) {
+    if (ls.pendingBlock != nullptr) {
       continue;
     }
     // query memory pool for a free block
@@ -190,273 +524,344 @@ Thread::CallbackResult ReadoutEquipmentCruEmulator::prepareBlocks() {
       // todo: check how long we starve pages. monitor this counter.
       return Thread::CallbackResult::Idle;
     }
-    pendingBlocks[i] = nextBlock;
-    // printf("equipment %s : got block ref = %p rawptr = %p data=%p
-    // \n",getName().c_str(),nextBlock,nextBlock->getData(),nextBlock->getData()->data);
+    ls.pendingBlock = nextBlock;
   }
 
   // at this point, we have 1 free page per link... fill it!
+  for (auto &ls : g.links) {
+    DataBlock *b = ls.pendingBlock->getData();
+    int dSize = fillPage(b, ls, g);
 
-  o2::Header::RAWDataHeader defaultRDH; // a default RDH
+    b->header.blockType = DataBlockType::H_BASE;
+    b->header.headerSize = sizeof(DataBlockHeaderBase);
+    b->header.dataSize = dSize;
+    b->header.linkId = ls.linkId;
 
-  unsigned int nowOrbit = LHCorbit;
-  unsigned int nowBc = LHCbc;
+    g.readyBlocks->push(ls.pendingBlock);
+    ls.pendingBlock = nullptr;
+    g.nPages++;
+  }
 
-  for (int currentLink = 0; currentLink < cfgNumberOfLinks; currentLink++) {
+  return Thread::CallbackResult::Ok;
+}
 
-    // fill the new data page for this link
-    DataBlock *b = pendingBlocks[currentLink]->getData();
+int ReadoutEquipmentCruEmulator::fillPage(DataBlock *b, linkState &ls,
+                                          linkGroup &g) {
 
-    // printf ("data block %p data=%p\n",b,b->data);
+  const int rdhSize = sizeof(o2::Header::RAWDataHeader);
 
-    int offset; // number of bytes used in page
-    int nBlocksInPage = 0;
+  int offset; // number of bytes used in page
 
-    nowOrbit = LHCorbit;
-    nowBc = LHCbc;
-    uint64_t nowId = currentTimeframeId;
+  unsigned int nowOrbit = ls.LHCorbit;
+  unsigned int nowBc = ls.LHCbc;
+  // same numbering as the TF id assigned to the page afterwards
+  // (timeframe 1 starts at orbit 0)
+  uint64_t nowId = 1 + nowOrbit / timeframePeriod;
 
-    int linkId = cfgLinkId + currentLink;
-    int bytesAvailableInPage =
-        b->header.dataSize; // a bit less than memoryPoolPageSize;
-    // printf("bytes available: %d bytes\n",bytesAvailableInPage);
+  int bytesAvailableInPage =
+      b->header.dataSize; // a bit less than memoryPoolPageSize;
 
-    linkState &ls = perLinkState[linkId];
-    // printf("link %d: %d\n",linkId,ls.payloadBytesLeft);
+  for (offset = 0; offset + cruBlockSize <= bytesAvailableInPage;
+       offset += cruBlockSize) {
 
-    for (offset = 0; offset + cruBlockSize <= bytesAvailableInPage;
-         offset += cruBlockSize) {
+    if ((ls.payloadBytesLeft < 0) && (ls.feeIndex + 1 < cfgFeeIdsPerLink)) {
+      // payload of next FEE, in the same HB frame
+      ls.feeIndex++;
+      ls.HBpagecount = 0;
+      ls.payloadBytesLeft = ls.isEmpty ? 0 : getPayloadSize(ls, g);
 
-      if ((ls.payloadBytesLeft < 0)) {
-        // this is a new HB frame
+    } else if ((ls.payloadBytesLeft < 0)) {
+      // this is a new HB frame
 
-        unsigned int nextBc = nowBc + bcStep;
-        unsigned int nextOrbit = nowOrbit;
-        if (nextBc >= LHCBunches) {
-          nextOrbit += nextBc / LHCBunches;
-          nextBc = nextBc % LHCBunches;
-          unsigned int nextId = 1 + nextOrbit / cfgTFperiod; // timeframe ID
-          if (nextId != nowId) {
-            if (offset) {
-              // force page change on timeframe boundary
-              // printf("TF boundary : %d != %d\n",nextId,nowId);
-              break;
-            } else {
-              // ok to change TFid when it's the first clock step
-              nowId = nextId;
-            }
+      unsigned int nextBc = nowBc + bcStep;
+      unsigned int nextOrbit = nowOrbit;
+      if (nextBc >= LHCBunches) {
+        nextOrbit += nextBc / LHCBunches;
+        nextBc = nextBc % LHCBunches;
+        uint64_t nextId = 1 + nextOrbit / timeframePeriod; // timeframe ID
+        if (nextId != nowId) {
+          if (offset) {
+            // force page change on timeframe boundary
+            break;
+          } else {
+            // ok to change TFid when it's the first clock step
+            nowId = nextId;
           }
         }
-        nowBc = nextBc;
-        nowOrbit = nextOrbit;
-
-        ls.HBpagecount = 0;
-
-        // create empty HB?
-        if (rand() < cfgEmptyHbRatio * RAND_MAX) {
-          ls.isEmpty = 1;
-          ls.payloadBytesLeft = 0;
-        } else {
-          // HB with random payload size
-          ls.isEmpty = 0;
-          ls.payloadBytesLeft = cfgPayloadSize * (rand() * 1.0 / RAND_MAX);
-        }
-
-      } else {
-        // continue with current HB
-        ls.HBpagecount++;
       }
+      nowBc = nextBc;
+      nowOrbit = nextOrbit;
 
-      int nowHb = nowOrbit / cfgHBperiod;
-      // printf("orbit=%d bc=%d HB=%d\n",nowOrbit,nowBc,nowHb);
-
-      // rdh as defined in:
-      // https://docs.google.com/document/d/1KUoLnEw5PndVcj4FKR5cjV-MBN3Bqfx_B0e6wQOIuVE/edit#heading=h.5q65he8hp62c
-
-      o2::Header::RAWDataHeader *rdh =
-          (o2::Header::RAWDataHeader *)&b->data[offset];
-      // printf("rdh=%p block=%p delta=%d\n",rdh,b->data,(int)((char *)rdh-(char
-      // *)b->data));
-
-      *rdh = defaultRDH; // reset fields to defaults
-      rdh->blockLength = (uint16_t)cruBlockSize;
-      rdh->triggerOrbit = nowOrbit;
-      rdh->triggerBC = nowBc;
-      rdh->heartbeatOrbit = nowHb;
-      rdh->feeId = cfgFeeId;
-      rdh->linkId = linkId;
-      rdh->offsetNextPacket = cruBlockSize;
-
-      rdh->pagesCounter = ls.HBpagecount;
-      if (ls.payloadBytesLeft > 0) {
-        int bytesNow = ls.payloadBytesLeft;
-        if (bytesNow + (int)sizeof(o2::Header::RAWDataHeader) > cruBlockSize) {
-          bytesNow = cruBlockSize - sizeof(o2::Header::RAWDataHeader);
-        }
-        ls.payloadBytesLeft -= bytesNow;
-        rdh->memorySize = sizeof(o2::Header::RAWDataHeader) + bytesNow;
-        if (ls.payloadBytesLeft <= 0) {
-          ls.payloadBytesLeft = 0;
-          rdh->stopBit = 1;
-          ls.payloadBytesLeft = -1;
-        }
-      } else {
-        rdh->memorySize = sizeof(o2::Header::RAWDataHeader);
-        if (!((ls.isEmpty) && (ls.HBpagecount == 0))) {
-          rdh->stopBit = 1;
-          ls.payloadBytesLeft = -1;
-        }
-      }
+      ls.HBpagecount = 0;
+      ls.feeIndex = 0;
+      startHb(ls, g, nowOrbit);
+      ls.payloadBytesLeft = ls.isEmpty ? 0 : getPayloadSize(ls, g);
 
-      // printf("block %p offset %d / %d, link %d @ %p
-      // data=%p\n",b,offset,memPoolElementSize,linkId,rdh,b->data);
-      // dumpRDH(rdh);
-      nBlocksInPage++;
+    } else {
+      // continue with current HB
+      ls.HBpagecount++;
     }
 
-    // size used (bytes) in page is last offset
-    int dSize = offset;
+    // orbit of current HB
+    unsigned int nowHb = (nowOrbit / cfgHBperiod) * cfgHBperiod;
 
-    // printf("wrote %d bytes\n",dSize);
+    // rdh as defined in:
+    // https://docs.google.com/document/d/1KUoLnEw5PndVcj4FKR5cjV-MBN3Bqfx_B0e6wQOIuVE/edit#heading=h.5q65he8hp62c
 
-    b->header.blockType = DataBlockType::H_BASE;
-    b->header.headerSize = sizeof(DataBlockHeaderBase);
-    b->header.dataSize = dSize;
-    b->header.timeframeId = nowId;
-    b->header.linkId = linkId;
-
-    readyBlocks->push(pendingBlocks[currentLink]);
-    pendingBlocks[currentLink] = nullptr;
-  }
-  LHCorbit = nowOrbit;
-  LHCbc = nowBc;
-  currentTimeframeId = 1 + LHCorbit / cfgTFperiod; // timeframe ID
-
-  /*
-      // this block is a superpage.
-      // let's fill it with data
-      if (currentLink==0) {
-        // starting new iteration over data link
-        // update current trigger ID
-        double t=elapsedTime.getTime();
-        if (currentId==0) {
-          t0=t;
-        }
-        LHCorbit=(uint32_t)((t-t0)*11000); // LHC orbit 11KHz
-        LHCbc=((uint16_t)((t-t0)*40018000)) & 0xFFF; // LHC BC 40MHz (multiple
-  of LHC orbit rate to make sure BC 0 on each new orbit) if
-  ((HBid==0)||(LHCorbit>HBid+HBperiod)) { HBid=LHCorbit;
-        }
-  /
-        LHCbc+=1000;
-        if (LHCbc>=4096) {
-          LHCorbit++;
-          LHCbc=0;
-        }
-  /
-        currentLink++;
-        pagesToGoForCurrentLink=0;
+    int memorySize = rdhSize;
+    uint8_t stopBit = 0;
+    if (ls.payloadBytesLeft > 0) {
+      int bytesNow = ls.payloadBytesLeft;
+      if (bytesNow + rdhSize > cruBlockSize) {
+        bytesNow = cruBlockSize - rdhSize;
       }
-
-      if (pagesToGoForCurrentLink==0) {
-        pagesToGoForCurrentLink=2; // TODO: random number of pages per trigger
+      ls.payloadBytesLeft -= bytesNow;
+      memorySize = rdhSize + bytesNow;
+      if (ls.payloadBytesLeft <= 0) {
+        stopBit = 1;
+        ls.payloadBytesLeft = -1;
+      }
+    } else {
+      if (!((ls.isEmpty) && (ls.HBpagecount == 0))) {
+        stopBit = 1;
+        ls.payloadBytesLeft = -1;
       }
+    }
 
-      o2::Header::RAWDataHeader defaultRDH; // a default RDH
-      // fill the new data page
-      int offset; // number of bytes used in page
-      int nBlocksInPage=0;
-      for
-  (offset=0;offset+cruBlockSize<=memPoolElementSize;offset+=cruBlockSize) {
-
-        // should we continue to fill the page, or limit reached?
-        nBlocksInPage++;
-        if (cfgMaxBlocksPerPage) {
-          if (nBlocksInPage>cfgMaxBlocksPerPage) {
-            break;
-          }
-        }
+    ls.rdhTemplates[ls.feeIndex].write(
+        &b->data[offset], nowOrbit, nowHb, nowBc, (uint16_t)memorySize,
+        (uint16_t)ls.HBpagecount, stopBit);
 
-        // rdh as defined in:
-        //
-  https://docs.google.com/document/d/1KUoLnEw5PndVcj4FKR5cjV-MBN3Bqfx_B0e6wQOIuVE/edit#heading=h.5q65he8hp62c
-
-        o2::Header::RAWDataHeader *rdh=(o2::Header::RAWDataHeader
-  *)&b->data[offset]; *rdh=defaultRDH; // reset fields to defaults
-        rdh->blockLength=(uint16_t)cruBlockSize;
-        rdh->triggerOrbit=LHCorbit;
-        rdh->triggerBC=LHCbc;
-        rdh->heartbeatOrbit=HBid;
-        rdh->feeId=cfgFeeId;
-        rdh->linkId=currentLink;
-
-        printf("RDH @ %d / %d\n",offset,memPoolElementSize);
-        dumpRDH(rdh);
-      }
+    if (cfgFillPayload) {
+      uint64_t pattern = (((uint64_t)nowOrbit) << 32) |
+                         (((uint64_t)nowBc) << 16) | (uint16_t)ls.linkId;
+      fillNonTemporal(&b->data[offset + rdhSize], memorySize - rdhSize,
+                      pattern);
+    }
+  }
+
+#ifdef __SSE2__
+  if (cfgFillPayload) {
+    _mm_sfence(); // payload visible before page is published
+  }
+#endif
 
-      // size used (bytes) in page is last offset
-      int dSize=offset;
+  ls.LHCorbit = nowOrbit;
+  ls.LHCbc = nowBc;
 
-      // fill header
-      currentId++;  // don't start from 0
-      b->header.blockType=DataBlockType::H_BASE;
-      b->header.headerSize=sizeof(DataBlockHeaderBase);
-      b->header.dataSize=dSize;
-      b->header.id=currentId;
+  // size used (bytes) in page is last offset
+  return offset;
+}
 
-      // b->data is set when creating block
+void ReadoutEquipmentCruEmulator::startHb(linkState &ls, linkGroup &g,
+                                          uint32_t orbit) {
+  // bursts defined from orbit, to be simultaneous on all links
+  ls.isBurst = false;
+  if (cfgBurstProbability > 0) {
+    ls.isBurst = FastRandom::getUniformFromKey(orbit / cfgBurstLength) <
+                 cfgBurstProbability;
+  }
 
-      // have pushed one more page
-      pagesToGoForCurrentLink--;
-      if (pagesToGoForCurrentLink==0) {
-        currentLink++;
-        if (currentLink>cfgNumberOfLinks) {
-          currentLink=0;
-        }
-      }
+  if (cfgTriggersPerHb > 0) {
+    ls.hbTriggers = g.random.getPoisson(cfgTriggersPerHb);
+    ls.isEmpty = (ls.hbTriggers == 0);
+  } else {
+    ls.isEmpty = (g.random.getUniform() < cfgEmptyHbRatio);
+    ls.hbTriggers = ls.isEmpty ? 0 : 1;
+  }
+
+  g.stats.nHb++;
+  if (ls.isEmpty) {
+    g.stats.nHbEmpty++;
+  }
+  if (ls.isBurst) {
+    g.stats.nHbBurst++;
+  }
+  g.stats.nTriggers += ls.hbTriggers;
+  g.stats.triggersHistogram[(ls.hbTriggers < loadStats::maxTriggers)
+                                ? ls.hbTriggers
+                                : loadStats::maxTriggers]++;
+}
+
+int ReadoutEquipmentCruEmulator::getPayloadSize(linkState &ls, linkGroup &g) {
+  // random payload for each trigger
+  double size = 0;
+  for (int i = 0; i < ls.hbTriggers; i++) {
+    size += cfgPayloadSize * g.random.getUniform();
+  }
+  size *= ls.occupancy;
+  if (ls.isBurst) {
+    size *= cfgBurstFactor;
+  }
+  if (size > 0x3FFFFFFF) {
+    size = 0x3FFFFFFF;
+  }
+
+  g.stats.nPayload++;
+  g.stats.payloadBytes += (uint64_t)size;
+  if ((uint64_t)size > g.stats.payloadMax) {
+    g.stats.payloadMax = (uint64_t)size;
+  }
+  return (int)size;
+}
+
+void ReadoutEquipmentCruEmulator::loadStats::add(const loadStats &s) {
+  nHb += s.nHb;
+  nHbEmpty += s.nHbEmpty;
+  nHbBurst += s.nHbBurst;
+  nTriggers += s.nTriggers;
+  for (int i = 0; i <= maxTriggers; i++) {
+    triggersHistogram[i] += s.triggersHistogram[i];
+  }
+  nPayload += s.nPayload;
+  payloadBytes += s.payloadBytes;
+  if (s.payloadMax > payloadMax) {
+    payloadMax = s.payloadMax;
+  }
+}
 
+void ReadoutEquipmentCruEmulator::runGenerator(linkGroup &g,
+                                               const std::string &threadName) {
+  threadPlacement.apply(threadName);
+  while (isGeneratorRunning) {
+    if (generateBlocks(g) == Thread::CallbackResult::Idle) {
+      usleep(generatorIdleSleepTime);
     }
-  */
-  return Thread::CallbackResult::Ok;
+  }
+}
+
+void ReadoutEquipmentCruEmulator::startGenerators() {
+  if ((cfgNumberOfThreads == 0) || (isGeneratorRunning)) {
+    return;
+  }
+  isGeneratorRunning = true;
+  for (int i = 0; i < (int)linkGroups.size(); i++) {
+    linkGroup &g = linkGroups[i];
+    std::string threadName = name + "-generator-" + std::to_string(i);
+    g.generatorThread = std::make_unique<std::thread>(
+        &ReadoutEquipmentCruEmulator::runGenerator, this, std::ref(g),
+        threadName);
+  }
+  theLog.log("Equipment %s: %d threads generating data", name.c_str(),
+             (int)linkGroups.size());
+}
+
+void ReadoutEquipmentCruEmulator::stopGenerators() {
+  isGeneratorRunning = false;
+  for (auto &g : linkGroups) {
+    if (g.generatorThread != nullptr) {
+      g.generatorThread->join();
+      g.generatorThread = nullptr;
+    }
+  }
+}
+
+void ReadoutEquipmentCruEmulator::setDataOn() {
+  ReadoutEquipment::setDataOn();
+  startGenerators();
+}
+
+void ReadoutEquipmentCruEmulator::setDataOff() {
+  stopGenerators();
+  ReadoutEquipment::setDataOff();
 }
 
 DataBlockContainerReference ReadoutEquipmentCruEmulator::getNextBlock() {
 
+  // look for a page in each group, round-robin
   DataBlockContainerReference nextBlock = nullptr;
-  readyBlocks->pop(nextBlock);
+  int nGroups = (int)linkGroups.size();
+  for (int i = 0; i < nGroups; i++) {
+    linkGroup &g = linkGroups[nextGroup];
+    nextGroup++;
+    if (nextGroup == nGroups) {
+      nextGroup = 0;
+    }
+    if (g.readyBlocks->pop(nextBlock) == 0) {
+      break;
+    }
+  }
   return nextBlock;
 }
 
 void ReadoutEquipmentCruEmulator::initCounters() {
   // init variables
-  currentTimeframeId = 1; // TFid starts on 1
-
-  for (auto &b : pendingBlocks) {
-    b = nullptr;
-  }
-
-  readyBlocks->clear();
-
   elapsedTime.reset();
-  t0 = 0;
+  nextGroup = 0;
 
-  LHCorbit = 0;
-  LHCbc = 0;
-
-  for (auto &ls : perLinkState) {
-    ls.second.HBpagecount = 0;
-    ls.second.isEmpty = 0;
-    ls.second.payloadBytesLeft = -1;
+  // timeframe 1 starts at orbit 0, so that generating threads can compute
+  // timeframe boundaries without the (not thread-safe) assigner
+  timeframePeriod = timeframeIdAssigner.getPeriod();
+  if (timeframePeriod == 0) {
+    timeframePeriod = 1;
+  }
+  timeframeIdAssigner.setFirstOrbit(0);
+
+  for (auto &g : linkGroups) {
+    g.readyBlocks->clear();
+    g.t0 = -1;
+    g.nPages = 0;
+    g.stats = loadStats();
+    for (auto &ls : g.links) {
+      ls.pendingBlock = nullptr;
+      ls.LHCorbit = 0;
+      ls.LHCbc = 0;
+      ls.HBpagecount = 0;
+      ls.isEmpty = 0;
+      ls.payloadBytesLeft = -1;
+      ls.feeIndex = cfgFeeIdsPerLink - 1; // next packet starts a new HB
+      ls.hbTriggers = 0;
+      ls.isBurst = false;
+    }
   }
 }
 
 void ReadoutEquipmentCruEmulator::finalCounters() {
-  // flush queue of prepared blocks
-  DataBlockContainerReference nextBlock = nullptr;
-  for (;;) {
-    if (readyBlocks->pop(nextBlock)) {
-      break;
+  stopGenerators();
+
+  // flush queues of prepared blocks
+  loadStats stats;
+  for (int i = 0; i < (int)linkGroups.size(); i++) {
+    linkGroup &g = linkGroups[i];
+    g.readyBlocks->clear();
+    for (auto &ls : g.links) {
+      ls.pendingBlock = nullptr;
+    }
+    if (cfgNumberOfThreads > 0) {
+      theLog.log("Equipment %s: generator thread %d: %d links, %llu pages",
+                 name.c_str(), i, (int)g.links.size(),
+                 (unsigned long long)g.nPages);
+    }
+    stats.add(g.stats);
+  }
+
+  // realized load distribution
+  if (stats.nHb == 0) {
+    return;
+  }
+  theLog.log("Equipment %s: %llu HB frames, %.1f%% empty, %.1f%% in bursts",
+             name.c_str(), (unsigned long long)stats.nHb,
+             stats.nHbEmpty * 100.0 / stats.nHb,
+             stats.nHbBurst * 100.0 / stats.nHb);
+  if (stats.nPayload) {
+    theLog.log("Equipment %s: payload per HB and FEE: avg=%.0f max=%llu bytes",
+               name.c_str(), stats.payloadBytes * 1.0 / stats.nPayload,
+               (unsigned long long)stats.payloadMax);
+  }
+  if (cfgTriggersPerHb > 0) {
+    std::string histo;
+    for (int i = 0; i <= loadStats::maxTriggers; i++) {
+      if (stats.triggersHistogram[i] == 0) {
+        continue;
+      }
+      char buf[64];
+      snprintf(buf, sizeof(buf), " %d%s:%.1f%%", i,
+               (i == loadStats::maxTriggers) ? "+" : "",
+               stats.triggersHistogram[i] * 100.0 / stats.nHb);
+      histo += buf;
     }
+    theLog.log("Equipment %s: triggers per HB: avg=%.2f, distribution%s",
+               name.c_str(), stats.nTriggers * 1.0 / stats.nHb, histo.c_str());
   }
 }
 
@@ -9,6 +9,7 @@
 // or submit itself to any jurisdiction.
 
 #include "MemoryBankManager.h"
+#include "MemoryPagesPoolSizeClasses.h"
 #include "ReadoutEquipment.h"
 #include "ReadoutUtils.h"
 
@@ -22,6 +23,9 @@ public:
   ReadoutEquipmentDummy(ConfigFile &cfg, std::string name = "dummyReadout");
   ~ReadoutEquipmentDummy();
   DataBlockContainerReference getNextBlock();
+  void finalCounters();
+  int getMemoryUsage(size_t &numberOfPagesAvailable,
+                     size_t &numberOfPagesInPool);
 
 private:
   Thread::CallbackResult populateFifoOut(); // iterative callback
@@ -29,6 +33,9 @@ private:
   int eventMaxSize; // maximum data block size
   int eventMinSize; // minimum data block size
   int fillData;     // if set, data pages filled with incremental values
+
+  std::shared_ptr<MemoryPagesPoolSizeClasses>
+      mpSizeClasses; // if defined, a set of pools used instead of mp
 };
 
 ReadoutEquipmentDummy::ReadoutEquipmentDummy(ConfigFile &cfg,
@@ -60,9 +67,60 @@ ReadoutEquipmentDummy::ReadoutEquipmentDummy(ConfigFile &cfg,
   theLog.log("Equipment %s: eventSize: %d -> %d, fillData=%d", name.c_str(),
              eventMinSize, eventMaxSize, fillData);
 
+  // configuration parameter: | equipment-dummy-* | memoryPoolSizeClasses |
+  // string | | If set, a set of pools with different page sizes is created
+  // from the equipment memory bank, and each event uses the smallest page big
+  // enough, instead of a page of the equipment memory pool (which is then not
+  // used, memoryPoolNumberOfPages can be set to 1). Format: comma-separated
+  // list of pageSize:numberOfPages, e.g. 16k:1000,32k:1000. If outputFifoSize
+  // is not set, it is set to the total number of pages. |
+  std::string cfgMemoryPoolSizeClasses = "";
+  cfg.getOptionalValue<std::string>(cfgEntryPoint + ".memoryPoolSizeClasses",
+                                    cfgMemoryPoolSizeClasses);
+  if (cfgMemoryPoolSizeClasses.length() > 0) {
+    std::vector<std::pair<size_t, size_t>> sizeClasses;
+    if (ReadoutUtils::getSizeClassesFromString(cfgMemoryPoolSizeClasses,
+                                               sizeClasses)) {
+      theLog.log(InfoLogger::Severity::Error,
+                 "Equipment %s: wrong memoryPoolSizeClasses %s", name.c_str(),
+                 cfgMemoryPoolSizeClasses.c_str());
+      throw __LINE__;
+    }
+    try {
+      mpSizeClasses = theMemoryBankManager.getPagedPoolSizeClasses(
+          sizeClasses, memoryBankName);
+    } catch (...) {
+    }
+    if (mpSizeClasses == nullptr) {
+      theLog.log(InfoLogger::Severity::Error,
+                 "Equipment %s: failed to create memory pools for %s",
+                 name.c_str(), cfgMemoryPoolSizeClasses.c_str());
+      throw __LINE__;
+    }
+    // output fifo sized for the pages of all classes, unless set otherwise
+    int cfgOutputFifoSize = -1;
+    cfg.getOptionalValue<int>(cfgEntryPoint + ".outputFifoSize",
+                              cfgOutputFifoSize);
+    if (cfgOutputFifoSize == -1) {
+      size_t nPagesFree = 0, nPagesTotal = 0;
+      mpSizeClasses->getNumberOfPages(nPagesFree, nPagesTotal);
+      dataOut = std::make_shared<FifoSPSC<DataBlockContainerReference>>(
+          (int)nPagesTotal);
+    }
+    theLog.log("Equipment %s: using memory pools with size classes %s",
+               name.c_str(), cfgMemoryPoolSizeClasses.c_str());
+  }
+
   // ensure generated events will fit in blocks allocated from memory pool
   int maxElementSize = eventMaxSize + sizeof(DataBlockHeaderBase);
-  if (maxElementSize > memoryPoolPageSize) {
+  if (mpSizeClasses != nullptr) {
+    if ((size_t)eventMaxSize > mpSizeClasses->getMaxBlockSize()) {
+      theLog.log("memoryPoolSizeClasses too small, need a page size of at "
+                 "least %d bytes",
+                 (int)(eventMaxSize + sizeof(DataBlock)));
+      throw __LINE__;
+    }
+  } else if (maxElementSize > memoryPoolPageSize) {
     theLog.log("memoryPoolPageSize too small, need at least %d bytes",
                maxElementSize);
     throw __LINE__;
@@ -71,16 +129,43 @@ ReadoutEquipmentDummy::ReadoutEquipmentDummy(ConfigFile &cfg,
 
 ReadoutEquipmentDummy::~ReadoutEquipmentDummy() {}
 
+void ReadoutEquipmentDummy::finalCounters() {
+  if (mpSizeClasses != nullptr) {
+    mpSizeClasses->logStats();
+  }
+}
+
+int ReadoutEquipmentDummy::getMemoryUsage(size_t &numberOfPagesAvailable,
+                                          size_t &numberOfPagesInPool) {
+  if (mpSizeClasses != nullptr) {
+    mpSizeClasses->getNumberOfPages(numberOfPagesAvailable,
+                                    numberOfPagesInPool);
+    return 0;
+  }
+  return ReadoutEquipment::getMemoryUsage(numberOfPagesAvailable,
+                                          numberOfPagesInPool);
+}
+
 DataBlockContainerReference ReadoutEquipmentDummy::getNextBlock() {
 
   if (!isDataOn) {
     return nullptr;
   }
 
+  // size of next event
+  int dSize = (int)(eventMinSize + (int)((eventMaxSize - eventMinSize) *
+                                         (rand() * 1.0 / RAND_MAX)));
+
   // query memory pool for a free block
+  // no need to check size fits in page, this was done once for all at
+  // configure time
   DataBlockContainerReference nextBlock = nullptr;
   try {
-    nextBlock = mp->getNewDataBlockContainer();
+    if (mpSizeClasses != nullptr) {
+      nextBlock = mpSizeClasses->getNewDataBlockContainer(dSize);
+    } else {
+      nextBlock = mp->getNewDataBlockContainer();
+    }
   } catch (...) {
   }
 
@@ -88,13 +173,6 @@ DataBlockContainerReference ReadoutEquipmentDummy::getNextBlock() {
   if (nextBlock != nullptr) {
     DataBlock *b = nextBlock->getData();
 
-    // set size
-    int dSize = (int)(eventMinSize + (int)((eventMaxSize - eventMinSize) *
-                                           (rand() * 1.0 / RAND_MAX)));
-
-    // no need to check size fits in page, this was done once for all at
-    // configure time
-
     // fill header
     b->header.blockType = DataBlockType::H_BASE;
     b->header.headerSize = sizeof(DataBlockHeaderBase);
@@ -8,11 +8,25 @@
 // granted to it by virtue of its status as an Intergovernmental Organization
 // or submit itself to any jurisdiction.
 
+#include "FifoSPSC.h"
+#include "FileReadAhead.h"
 #include "MemoryBankManager.h"
 #include "RdhUtils.h"
 #include "ReadoutEquipment.h"
 #include "ReadoutUtils.h"
+#include <atomic>
+#include <chrono>
+#include <glob.h>
+#include <sstream>
+#include <string.h>
 #include <string>
+#include <sys/mman.h>
+#include <thread>
+#include <unistd.h>
+
+#ifdef WITH_LZ4
+#include <lz4.h>
+#endif
 
 #include <InfoLogger/InfoLogger.hxx>
 using namespace AliceO2::InfoLogger;
@@ -28,42 +42,192 @@ public:
 
 private:
   void initCounters();
+  void finalCounters();
+
+  DataBlockContainerReference readNextBlock(); // get next page from file(s)
 
   Thread::CallbackResult populateFifoOut(); // iterative callback
 
-  std::string filePath = "";        // path to data file
+  std::string filePath = "";        // path to data file(s), as configured
   size_t fileSize = 0;              // data file size
   std::unique_ptr<char[]> fileData; // copy of file content
+  const char *fileContent = nullptr; // file content (copy or mapping)
 
-  int preLoad;   // if set, data preloaded in the memory pool
-  int fillPage;  // if set, page is filled multiple time
-  int autoChunk; // if set, page boundary extracted from RDH info
+  // how the file is accessed
+  enum ReadMode {
+    ReadModeFread, // file read with fread()
+    ReadModeMmap,  // file mapped in memory
+    ReadModeAsync  // file read by a separate thread in staging buffers
+  };
+  ReadMode readMode = ReadModeFread;
+  char *fileMap = nullptr;     // file mapping (readMode=mmap)
+  size_t fileMapAdvised = 0;   // offset up to which read-ahead was requested
+  RdhPageIndex chunkIndex;     // index of the packets at current offset
+  static const size_t fileMapReadAhead = 64 * 1024 * 1024; // in bytes
 
-  size_t bytesPerPage = 0;      // number of bytes per data page
-  FILE *fp = nullptr;           // file handle
-  bool fpOk = false;            // flag to say if fp can be used
-  unsigned long fileOffset = 0; // current file offset
+  // request read-ahead of the file mapping, if not done yet for the given
+  // range and for fileMapReadAhead bytes after it
+  void adviseFileMap(size_t offset, size_t nBytes);
 
   struct PacketHeader {
     uint64_t timeframeId = 0;
     int linkId = undefinedLinkId;
     int equipmentId = undefinedEquipmentId; // used to store CRU id
   };
-  PacketHeader lastPacketHeader; // keep track of last packet header
 
-  uint32_t timeframePeriodOrbits =
-      256; // timeframe interval duration in number of LHC orbits
-  uint32_t firstTimeframeHbOrbitBegin =
-      0; // HbOrbit of beginning of first timeframe
+  // replay position in a file
+  struct ReplayPosition {
+    unsigned long fileOffset = 0;  // current file offset
+    PacketHeader lastPacketHeader; // keep track of last packet header
+  };
+  ReplayPosition position; // position in file (readMode=fread/mmap)
+
+  // files replayed with readMode=async. Each file is read by its own thread
+  // into staging buffers, and pages are taken from the file with the lowest
+  // heartbeat orbit on next packet, so that data from files recorded
+  // separately (e.g. one per link) are merged in timeframe order.
+  struct ReplayFile {
+    std::string path;                      // path to file
+    std::unique_ptr<FileReadAhead> reader; // reading thread and buffers
+    ReplayPosition position;               // position in file
+    bool isDone = false;                   // set when end of file reached
+  };
+  std::vector<ReplayFile> replayFiles;
+  int currentReplayFile = -1;  // file selected for next page
+  bool isReplayStarted = false; // set when read threads started
+
+  // select file for next page, i.e. the one with lowest orbit, after data
+  // for at least a page (or what is left before end of file) is available
+  // from all files not completed yet.
+  // returns 0 on success, 1 if data not available yet, -1 if replay should
+  // stop (all files completed, or error)
+  int selectReplayFile();
+  void stopReplayFiles(); // stop read threads
+
+  // replay paced on the orbits of the data (replaySpeed > 0)
+  // pages are released when the time elapsed since the first page matches the
+  // orbit of their first RDH, at LHC orbit rate multiplied by replaySpeed.
+  double replaySpeed = 0;             // replay speed, relative to LHC rate
+  bool isPacedOnTriggerOrbit = false; // if set, trigger orbit used instead of
+                                      // heartbeat orbit
+  double pacingNsPerOrbit = 0;        // time between orbits, in nanoseconds
+  bool isPacingStarted = false;       // set when first page released
+  uint32_t pacingLastOrbit = 0;       // orbit of last page
+  int64_t pacingOrbits = 0; // orbits elapsed since first page, extended to
+                            // 64 bits (orbits wrap, e.g. in replay loops)
+  uint64_t pacingT0 = 0;              // time of first page, in nanoseconds
+  DataBlockContainerReference pacedBlock; // next page, waiting for its time
+  CounterStats pacingDelay; // delay of pages released, in nanoseconds
+  // pages due within this time are released by busy waiting, instead of
+  // returning to the (sleeping) readout thread loop
+  static const uint64_t pacingSpinTime = 500000; // in nanoseconds
+
+  // returns true if page can be released now, waiting a bit if it is due soon
+  bool isPageDue(DataBlock *b);
+
+  // replay in loop (replayLoops != 1)
+  // on each new pass, orbits are shifted by the duration of the data, rounded
+  // to a whole number of timeframes, so that orbits and timeframe ids keep
+  // increasing.
+  int replayLoops = 1;             // number of passes (0: infinite)
+  int replayPass = 1;              // current pass
+  uint32_t loopOrbitOffset = 0;    // orbit shift of current pass
+  bool isLoopOrbitRangeSet = false; // set when loopFirst/LastOrbit valid
+  uint32_t loopFirstOrbit = 0;     // lowest orbit in data (first pass)
+  uint32_t loopLastOrbit = 0;      // highest orbit in data (first pass)
+
+  // start a new pass on the data, if configured
+  // returns 0 on success, -1 if replay should stop
+  int startNextPass();
+
+  // update page with orbit shift of current pass (RDH and index), and keep
+  // track of orbit range on first pass
+  void shiftPageOrbits(DataBlock *b, RdhPageIndex &index);
+
+  // compressed file (fileType=lz4)
+  // the file is mapped in memory, and each LZ4 block (one per page, as written
+  // by ProcessorLZ4Compress) is decompressed directly into a page by a pool of
+  // threads. Blocks are dispatched and collected round-robin on the threads,
+  // so that pages come out in file order.
+  bool isLz4 = false;
+  struct DecompressJob {
+    DataBlockContainerReference block = nullptr; // destination page
+    const char *src = nullptr;                   // LZ4 block data
+    size_t srcSize = 0;                          // LZ4 block size
+    bool isCompressed = true; // if not set, block data stored as-is
+    int err = 0;              // set by worker on decompression error
+  };
+  struct DecompressWorker {
+    std::unique_ptr<FifoSPSC<DecompressJob>> jobs; // blocks to decompress
+    std::unique_ptr<FifoSPSC<DecompressJob>> done; // blocks decompressed
+    std::unique_ptr<std::thread> thread;
+  };
+  std::vector<DecompressWorker> decompressWorkers;
+  static const int decompressQueueSize = 4; // max jobs in flight per worker
+  std::atomic<bool> isDecompressRunning;    // cleared to stop workers
+  int decompressNextIn = 0;     // worker for next job
+  int decompressNextOut = 0;    // worker with next page to be returned
+  int decompressPending = 0;    // number of jobs in flight
+  DecompressJob decompressNextJob; // next LZ4 block, waiting for a page
+  bool isLz4InFrame = false;       // set when reading blocks of a frame
+  bool isLz4BlockChecksum = false; // frame with block checksums
+  bool isLz4ContentChecksum = false; // frame with content checksum
+  bool isLz4Done = false;            // set on end of file or error
+  uint64_t lz4BytesIn = 0;           // compressed bytes replayed
+  uint64_t lz4BytesOut = 0;          // decompressed bytes replayed
+
+  // find next LZ4 block in file, at current position
+  // returns 0 on success (job source set), 1 on end of file, -1 on error
+  int getNextLz4Block(DecompressJob &job);
+  DataBlockContainerReference readLz4Block(); // get next page decompressed
+  void runDecompressWorker(int workerIndex);
+  void startDecompressWorkers();
+  void stopDecompressWorkers();
+
+  int preLoad;   // if set, data preloaded in the memory pool
+  int fillPage;  // if set, page is filled multiple time
+  int autoChunk; // if set, page boundary extracted from RDH info
+
+  size_t bytesPerPage = 0;      // number of bytes per data page
+  FILE *fp = nullptr;           // file handle
+  bool fpOk = false;            // flag to say if fp can be used
 
   void copyFileDataToPage(void *page); // fill given page with file data
                                        // according to current settings
+
+  // find the end of next page in a block of data read at given file position,
+  // from the index of its RDH packets. Page is cut on link, CRU or timeframe
+  // change. Link and CRU of the page are set in block header.
+  // returns 0 on success (pageSize and nPackets set), -1 on error
+  int getPageBoundary(DataBlock *b, ReplayPosition &pos, RdhPageIndex *index,
+                      const char *data, size_t nBytes, size_t &pageSize,
+                      size_t &nPackets);
+
+  // fill next page in autoChunk mode, by fread() or from the file mapping
+  // returns 0 on success, -1 if replay should stop
+  int readChunk(DataBlock *b);
+  int readChunkFromMap(DataBlock *b);
+  int readChunkFromReadBuffer(DataBlock *b);
+
+  // fill next page with the packets of a block of data at given file
+  // position, which is then moved after the page (pageSize set to the number
+  // of bytes used)
+  // returns 0 on success, -1 on error
+  int readChunkFromMemory(DataBlock *b, ReplayPosition &pos, const char *src,
+                          size_t nBytes, size_t &pageSize);
 };
 
+// current time, in nanoseconds
+static inline uint64_t getTimeNs() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
 void ReadoutEquipmentPlayer::copyFileDataToPage(void *page) {
   if (page == nullptr)
     return;
-  if (fileData == nullptr)
+  if (fileContent == nullptr)
     return;
   if (fileSize == 0)
     return;
@@ -73,7 +237,7 @@ void ReadoutEquipmentPlayer::copyFileDataToPage(void *page) {
   }
   char *ptr = (char *)page;
   for (int i = 0; i < nCopy; i++) {
-    memcpy(ptr, fileData.get(), fileSize);
+    memcpy(ptr, fileContent, fileSize);
     ptr += fileSize;
   }
 }
@@ -83,15 +247,25 @@ ReadoutEquipmentPlayer::ReadoutEquipmentPlayer(ConfigFile &cfg,
     : ReadoutEquipment(cfg, cfgEntryPoint) {
 
   auto errorHandler = [&](const std::string &err) {
+    // destructor is not called when constructor throws, release resources here
     if (fp != nullptr) {
       fclose(fp);
+      fp = nullptr;
+    }
+    if (fileMap != nullptr) {
+      munmap(fileMap, fileSize);
+      fileMap = nullptr;
     }
     throw err;
   };
 
   // get configuration values
   // configuration parameter: | equipment-player-* | filePath | string | | Path
-  // of file containing data to be injected in readout. |
+  // of file containing data to be injected in readout. With autoChunk, it can
+  // be a comma-separated list of paths or patterns (e.g.
+  // /data/run_link*.raw), for files recorded separately (e.g. one per link)
+  // to be replayed together: the files are then read in parallel
+  // (readMode=async), and their pages merged in timeframe order. |
   filePath = cfg.getValue<std::string>(cfgEntryPoint + ".filePath");
   // configuration parameter: | equipment-player-* | preLoad | int | 1 | If 1,
   // data pages preloaded with file content on startup. If 0, data is copied at
@@ -108,20 +282,162 @@ ReadoutEquipmentPlayer::ReadoutEquipmentPlayer(ConfigFile &cfg,
   // compatible with memory bank settings and RDH information.
   // In this mode the preLoad and fillPage options have no effect. |
   cfg.getOptionalValue<int>(cfgEntryPoint + ".autoChunk", autoChunk, 0);
-  // configuration parameter: | equipment-player-* | TFperiod | int | 256 |
-  // Duration of a timeframe, in number of LHC orbits. |
-  int cfgTFperiod = 256;
-  cfg.getOptionalValue<int>(name + ".TFperiod", cfgTFperiod);
-  timeframePeriodOrbits = cfgTFperiod;
+  // configuration parameter: | equipment-player-* | fileType | string | plain
+  // | Format of the file. One of: plain (raw data, as recorded by readout), lz4
+  // (LZ4 frames, as written by ProcessorLZ4Compress: each LZ4 block is
+  // decompressed directly in a data page; the file is mapped in memory and
+  // autoChunk, preLoad and fillPage are not used). |
+  // configuration parameter: | equipment-player-* | decompressThreads | int |
+  // 2 | Number of threads decompressing the data, for fileType=lz4. |
+  std::string cfgFileType = "plain";
+  cfg.getOptionalValue<std::string>(cfgEntryPoint + ".fileType", cfgFileType);
+  int cfgDecompressThreads = 2;
+  cfg.getOptionalValue<int>(cfgEntryPoint + ".decompressThreads",
+                            cfgDecompressThreads);
+  if (cfgFileType == "lz4") {
+#ifdef WITH_LZ4
+    isLz4 = true;
+    autoChunk = 0;
+    if (cfgDecompressThreads < 1) {
+      cfgDecompressThreads = 1;
+    }
+#else
+    errorHandler(std::string("fileType=lz4 not supported in this build"));
+#endif
+  } else if (cfgFileType != "plain") {
+    errorHandler(std::string("wrong fileType ") + cfgFileType);
+  }
+  // configuration parameter: | equipment-player-* | readMode | string | fread
+  // | How the file is read. One of: fread (file content loaded with buffered
+  // reads), mmap (file mapped in memory, and data copied directly from the
+  // mapping to the pages, with sequential read-ahead: no intermediate buffer
+  // nor backward seek in autoChunk mode, and no copy of the file in memory
+  // otherwise), async (only with autoChunk: file read sequentially in a
+  // separate thread into large staging buffers, with direct I/O if possible,
+  // while pages are filled from the buffers in the equipment thread). |
+  // configuration parameter: | equipment-player-* | readBufferSize | bytes |
+  // 16M | Size of each staging buffer, for readMode=async. |
+  // configuration parameter: | equipment-player-* | readBufferCount | int |
+  // 3 | Number of staging buffers, for readMode=async (for each file). |
+  // configuration parameter: | equipment-player-* | readDirect | int | 1 |
+  // For readMode=async, if 1, the file is opened with O_DIRECT to bypass the
+  // page cache (buffered reads are used if not supported). |
+  std::string cfgReadMode = "fread";
+  cfg.getOptionalValue<std::string>(cfgEntryPoint + ".readMode", cfgReadMode);
+  if (cfgReadMode == "fread") {
+    readMode = ReadModeFread;
+  } else if (cfgReadMode == "mmap") {
+    readMode = ReadModeMmap;
+  } else if ((cfgReadMode == "async") && (autoChunk)) {
+    readMode = ReadModeAsync;
+  } else {
+    errorHandler(std::string("wrong readMode ") + cfgReadMode);
+  }
+  if ((isLz4) && (readMode != ReadModeMmap)) {
+    readMode = ReadModeMmap;
+    cfgReadMode = "mmap";
+    theLog.log("Equipment %s: LZ4 file, using readMode=mmap", name.c_str());
+  }
+  std::string cfgReadBufferSize = "16M";
+  cfg.getOptionalValue<std::string>(cfgEntryPoint + ".readBufferSize",
+                                    cfgReadBufferSize);
+  int cfgReadBufferCount = 3;
+  cfg.getOptionalValue<int>(cfgEntryPoint + ".readBufferCount",
+                            cfgReadBufferCount);
+  int cfgReadDirect = 1;
+  cfg.getOptionalValue<int>(cfgEntryPoint + ".readDirect", cfgReadDirect);
+  // configuration parameter: | equipment-player-* | replaySpeed | double | 0
+  // | Only with autoChunk or fileType=lz4. If set, data is replayed with the
+  // time structure of the recording: each page is released when the time
+  // elapsed since the first page corresponds to the orbit of its first RDH, at
+  // LHC orbit rate multiplied by this factor (1 = original rate, 2 = twice
+  // faster, etc). If 0, data is replayed as fast as possible. |
+  cfg.getOptionalValue<double>(cfgEntryPoint + ".replaySpeed", replaySpeed,
+                               0.0);
+  // configuration parameter: | equipment-player-* | replayOrbit | string | hb
+  // | Orbit used for the pacing of replaySpeed. One of: hb (RDH heartbeat
+  // orbit), trigger (RDH trigger orbit). |
+  std::string cfgReplayOrbit = "hb";
+  cfg.getOptionalValue<std::string>(cfgEntryPoint + ".replayOrbit",
+                                    cfgReplayOrbit);
+  if (cfgReplayOrbit == "trigger") {
+    isPacedOnTriggerOrbit = true;
+  } else if (cfgReplayOrbit != "hb") {
+    errorHandler(std::string("wrong replayOrbit ") + cfgReplayOrbit);
+  }
+  // configuration parameter: | equipment-player-* | replayLoops | int | 1 |
+  // Only with autoChunk. Number of times the data is replayed (0 = forever).
+  // On each new pass, the RDH heartbeat and trigger orbits are shifted by the
+  // duration of the data, rounded to a whole number of timeframes, so that
+  // orbits and timeframe ids keep increasing. |
+  cfg.getOptionalValue<int>(cfgEntryPoint + ".replayLoops", replayLoops, 1);
+  if (replayLoops != 1) {
+    if (!autoChunk) {
+      errorHandler(std::string("replayLoops needs autoChunk=1"));
+    }
+    if (replayLoops < 0) {
+      replayLoops = 0;
+    }
+    std::string passes = "forever";
+    if (replayLoops > 0) {
+      passes = std::to_string(replayLoops) + " passes";
+    }
+    theLog.log("Equipment %s: replay in loop, %s", name.c_str(),
+               passes.c_str());
+  }
+  if (replaySpeed > 0) {
+    if ((!autoChunk) && (!isLz4)) {
+      errorHandler(std::string("replaySpeed needs autoChunk=1"));
+    }
+    pacingNsPerOrbit = 1E9 / (LHCOrbitRate * replaySpeed);
+    theLog.log("Equipment %s: replay paced on %s orbit, speed x%.3g",
+               name.c_str(), cfgReplayOrbit.c_str(), replaySpeed);
+  }
+
+  // get list of files, expanding patterns
+  std::vector<std::string> filePaths;
+  std::istringstream filePathList(filePath);
+  std::string filePattern;
+  while (std::getline(filePathList, filePattern, ',')) {
+    if (filePattern.length() == 0) {
+      continue;
+    }
+    glob_t g;
+    if (glob(filePattern.c_str(), GLOB_NOCHECK, nullptr, &g) == 0) {
+      for (size_t i = 0; i < g.gl_pathc; i++) {
+        filePaths.push_back(g.gl_pathv[i]);
+      }
+    }
+    globfree(&g);
+  }
+  if (filePaths.size() == 0) {
+    errorHandler(std::string("no file to replay"));
+  }
+  if (filePaths.size() > 1) {
+    if (!autoChunk) {
+      errorHandler(std::string("replay of multiple files needs autoChunk=1"));
+    }
+    if (readMode != ReadModeAsync) {
+      readMode = ReadModeAsync;
+      cfgReadMode = "async";
+      theLog.log("Equipment %s: replay of %d files, using readMode=async",
+                 name.c_str(), (int)filePaths.size());
+    }
+  }
+
+  // pages cut on timeframe boundaries, TF id from RDH
+  if ((autoChunk) || (isLz4)) {
+    defaultTimeframeIdSource = TimeframeIdAssigner::FirstRdhInPage;
+  }
 
   // log config summary
   theLog.log("Equipment %s: using data source file=%s preLoad=%d fillPage=%d "
-             "autoChunk=%d TFperiod=%d",
+             "autoChunk=%d TFperiod=%d readMode=%s",
              name.c_str(), filePath.c_str(), preLoad, fillPage, autoChunk,
-             timeframePeriodOrbits);
+             (int)timeframeIdAssigner.getPeriod(), cfgReadMode.c_str());
 
   // open data file
-  fp = fopen(filePath.c_str(), "rb");
+  fp = fopen(filePaths[0].c_str(), "rb");
   if (fp == nullptr) {
     errorHandler(std::string("open failed: ") + strerror(errno));
   }
@@ -140,9 +456,67 @@ ReadoutEquipmentPlayer::ReadoutEquipmentPlayer(ConfigFile &cfg,
   }
   fileSize = (size_t)fs;
 
+  // map file in memory, the file handle is not needed afterwards
+  if (readMode == ReadModeMmap) {
+    void *ptr = mmap(nullptr, fileSize, PROT_READ, MAP_PRIVATE, fileno(fp), 0);
+    if (ptr == MAP_FAILED) {
+      errorHandler(std::string("mmap failed: ") + strerror(errno));
+    }
+    fileMap = (char *)ptr;
+    fileContent = fileMap;
+    madvise(fileMap, fileSize, MADV_SEQUENTIAL);
+    fclose(fp);
+    fp = nullptr;
+  }
+
+  // allocate staging buffers and open files for the read threads
+  if (readMode == ReadModeAsync) {
+    fclose(fp);
+    fp = nullptr;
+    size_t maxPageSize = memoryPoolPageSize - sizeof(DataBlock);
+    size_t bufferSize =
+        ReadoutUtils::getNumberOfBytesFromString(cfgReadBufferSize.c_str());
+    fileSize = 0;
+    for (const auto &path : filePaths) {
+      ReplayFile f;
+      f.path = path;
+      try {
+        f.reader = std::make_unique<FileReadAhead>(
+            path, bufferSize, cfgReadBufferCount, maxPageSize, cfgReadDirect);
+      } catch (const std::string &err) {
+        errorHandler(err);
+      }
+      fileSize += f.reader->getFileSize();
+      replayFiles.push_back(std::move(f));
+    }
+    FileReadAhead *reader = replayFiles[0].reader.get();
+    theLog.log("Equipment %s: reading %d file(s) with %d buffers of %s%s",
+               name.c_str(), (int)replayFiles.size(), cfgReadBufferCount,
+               ReadoutUtils::NumberOfBytesToString(reader->getBufferSize(),
+                                                   "Bytes")
+                   .c_str(),
+               reader->isDirectIO() ? ", direct I/O" : "");
+  }
+
+  // create decompression threads (started on first page request)
+  isDecompressRunning = false;
+  if (isLz4) {
+    decompressWorkers.resize(cfgDecompressThreads);
+    for (auto &w : decompressWorkers) {
+      w.jobs = std::make_unique<FifoSPSC<DecompressJob>>(decompressQueueSize);
+      w.done = std::make_unique<FifoSPSC<DecompressJob>>(decompressQueueSize);
+    }
+  }
+
   // reset counters
   initCounters();
 
+  if (isLz4) {
+    theLog.log("Will decompress LZ4 file = %lu bytes with %d threads",
+               (unsigned long)fileSize, cfgDecompressThreads);
+    return;
+  }
+
   if (autoChunk) {
     bytesPerPage = memoryPoolPageSize - sizeof(DataBlock);
     theLog.log("Will load file = %lu bytes in chunks of maximum %lu bytes",
@@ -160,18 +534,24 @@ ReadoutEquipmentPlayer::ReadoutEquipmentPlayer(ConfigFile &cfg,
                  std::string(" bytes"));
   }
 
-  // allocate a buffer
-  fileData = std::make_unique<char[]>(fileSize);
-  if (fileData == nullptr) {
-    errorHandler(std::string("memory allocation failure"));
-  }
+  if (readMode == ReadModeMmap) {
+    // whole file used for each page
+    madvise(fileMap, fileSize, MADV_WILLNEED);
+  } else {
+    // allocate a buffer
+    fileData = std::make_unique<char[]>(fileSize);
+    if (fileData == nullptr) {
+      errorHandler(std::string("memory allocation failure"));
+    }
 
-  // load file
-  if (fread(fileData.get(), fileSize, 1, fp) != 1) {
-    errorHandler(std::string("Failed to load file"));
-  };
-  fclose(fp);
-  fp = nullptr;
+    // load file
+    if (fread(fileData.get(), fileSize, 1, fp) != 1) {
+      errorHandler(std::string("Failed to load file"));
+    };
+    fileContent = fileData.get();
+    fclose(fp);
+    fp = nullptr;
+  }
   fpOk = false;
 
   // init variables
@@ -204,9 +584,83 @@ ReadoutEquipmentPlayer::~ReadoutEquipmentPlayer() {
   if (fp != nullptr) {
     fclose(fp);
   }
+  if (fileMap != nullptr) {
+    munmap(fileMap, fileSize);
+  }
+  stopReplayFiles();
+  stopDecompressWorkers();
 }
 
 DataBlockContainerReference ReadoutEquipmentPlayer::getNextBlock() {
+  if (replaySpeed <= 0) {
+    return readNextBlock();
+  }
+  // keep page aside until its time comes
+  if (pacedBlock == nullptr) {
+    pacedBlock = readNextBlock();
+    if (pacedBlock == nullptr) {
+      return nullptr;
+    }
+  }
+  if (!isPageDue(pacedBlock->getData())) {
+    return nullptr;
+  }
+  DataBlockContainerReference nextBlock = std::move(pacedBlock);
+  pacedBlock = nullptr;
+  return nextBlock;
+}
+
+bool ReadoutEquipmentPlayer::isPageDue(DataBlock *b) {
+  if (b->header.dataSize < sizeof(o2::Header::RAWDataHeader)) {
+    return true;
+  }
+  RdhHandle h(b->data);
+  uint32_t orbit =
+      isPacedOnTriggerOrbit ? h.getTriggerOrbit() : h.getHbOrbit();
+  uint64_t now = getTimeNs();
+  if (!isPacingStarted) {
+    pacingLastOrbit = orbit;
+    pacingOrbits = 0;
+    pacingT0 = now;
+    isPacingStarted = true;
+  }
+  // consecutive pages are close in orbit: the 32-bit difference with the
+  // previous page is used to keep track of the orbits elapsed, over any
+  // number of orbit counter wraps
+  pacingOrbits += (int32_t)(orbit - pacingLastOrbit);
+  pacingLastOrbit = orbit;
+  // orbits before the first one (unordered data) are released immediately
+  uint64_t dueTime = pacingT0;
+  if (pacingOrbits > 0) {
+    dueTime += (uint64_t)(pacingOrbits * pacingNsPerOrbit);
+  }
+  if (now + pacingSpinTime < dueTime) {
+    return false;
+  }
+  while (now < dueTime) {
+    now = getTimeNs();
+  }
+  pacingDelay.set(now - dueTime);
+  return true;
+}
+
+DataBlockContainerReference ReadoutEquipmentPlayer::readNextBlock() {
+  if (isLz4) {
+    return readLz4Block();
+  }
+
+  // wait data ready in staging buffers, before using a page
+  if ((readMode == ReadModeAsync) && (fpOk)) {
+    int status = selectReplayFile();
+    if (status > 0) {
+      return nullptr;
+    }
+    if (status < 0) {
+      fpOk = false;
+      return nullptr;
+    }
+  }
+
   // query memory pool for a free block
   DataBlockContainerReference nextBlock = nullptr;
   try {
@@ -228,117 +682,17 @@ DataBlockContainerReference ReadoutEquipmentPlayer::getNextBlock() {
     b->data = &(((char *)b)[sizeof(DataBlock)]);
 
     if (autoChunk) {
-      bool isOk = 1;
-      // read from file
-      if ((fp != nullptr) && (fpOk)) {
-        size_t nBytes = fread(b->data, 1, bytesPerPage, fp);
-        if (nBytes == 0) {
-          if (ferror(fp)) {
-            theLog.log(InfoLogger::Severity::Error,
-                       "File %s read error, aborting replay", name.c_str());
-          }
-          if (feof(fp)) {
-            theLog.log("File %s replay completed", name.c_str());
-          }
-          isOk = 0;
+      int err = -1;
+      if (fpOk) {
+        if (readMode == ReadModeMmap) {
+          err = readChunkFromMap(b);
+        } else if (readMode == ReadModeAsync) {
+          err = readChunkFromReadBuffer(b);
         } else {
-          // printf ("read %d bytes\n",nBytes);
-          // scan the data to find a page boundary
-          size_t pageOffset = 0;
-          for (; pageOffset < nBytes;) {
-            if (pageOffset + sizeof(o2::Header::RAWDataHeader) > nBytes) {
-              break;
-            }
-            RdhHandle h(((uint8_t *)b->data) + pageOffset);
-            std::string errorDescription;
-            int nErr = h.validateRdh(errorDescription);
-            if (nErr) {
-              theLog.log(InfoLogger::Severity::Error,
-                         "File %s RDH error, aborting replay @ 0x%lX: %s",
-                         name.c_str(), (unsigned long)(fileOffset + pageOffset),
-                         errorDescription.c_str());
-              isOk = 0;
-              break;
-            }
-            // printf ("RDH @ %lu+ %d\n",fileOffset,pageOffset);
-            PacketHeader currentPacketHeader;
-            currentPacketHeader.linkId = (int)h.getLinkId();
-            currentPacketHeader.equipmentId = (int)h.getCruId();
-
-            bool isFirst = (fileOffset == 0) && (pageOffset == 0);
-
-            int hbOrbit = h.getHbOrbit();
-            ;
-            if (isFirst) {
-              firstTimeframeHbOrbitBegin = hbOrbit;
-            }
-            currentPacketHeader.timeframeId =
-                1 +
-                (hbOrbit - firstTimeframeHbOrbitBegin) / timeframePeriodOrbits;
-
-            // fill page metadata
-            if (pageOffset == 0) {
-              // printf("link %d TF
-              // %d\n",(int)currentPacketHeader.linkId,(int)currentPacketHeader.timeframeId);
-              b->header.linkId = currentPacketHeader.linkId;
-              b->header.equipmentId = currentPacketHeader.equipmentId;
-              b->header.timeframeId = currentPacketHeader.timeframeId;
-            }
-
-            // changing link/cruid or TF -> change page
-            bool changePage = 0;
-            if (!isFirst) {
-              if ((currentPacketHeader.linkId != lastPacketHeader.linkId) ||
-                  (currentPacketHeader.equipmentId !=
-                   lastPacketHeader.equipmentId) ||
-                  (currentPacketHeader.timeframeId !=
-                   lastPacketHeader.timeframeId)) {
-                // printf("%d : %d -> %d :
-                // %d\n",currentPacketHeader.linkId,currentPacketHeader.timeframeId,lastPacketHeader.linkId,lastPacketHeader.timeframeId);
-                changePage = 1;
-              }
-            }
-            lastPacketHeader = currentPacketHeader;
-            if (changePage) {
-              // printf("force new page\n");
-              break;
-            }
-
-            uint16_t offsetNextPacket = h.getOffsetNextPacket();
-            if (offsetNextPacket == 0) {
-              break;
-            }
-            if (pageOffset + offsetNextPacket > nBytes) {
-              break;
-            }
-            pageOffset += offsetNextPacket;
-          }
-
-          if (pageOffset == 0) {
-            theLog.log(InfoLogger::Severity::Error,
-                       "File %s stopping replay @ 0x%lX, last packet invalid",
-                       name.c_str(), (unsigned long)(fileOffset + pageOffset));
-            isOk = 0;
-          }
-          int delta = nBytes - pageOffset;
-          nBytes = pageOffset;
-          b->header.dataSize = nBytes;
-          fileOffset += nBytes;
-          // printf ("bytes = %d    delta = %d    new file Offset = %lu\n",
-          // nBytes, delta, fileOffset);
-          if (delta > 0) {
-            // rewind if necessary
-            if (fseek(fp, fileOffset, SEEK_SET)) {
-              theLog.log(InfoLogger::Severity::Error,
-                         "Failed to seek in file, aborting replay");
-              isOk = 0;
-            }
-          }
+          err = readChunk(b);
         }
-      } else {
-        isOk = 0;
       }
-      if (!isOk) {
+      if (err) {
         fpOk = false;
         return nullptr;
       }
@@ -353,8 +707,546 @@ DataBlockContainerReference ReadoutEquipmentPlayer::getNextBlock() {
   return nextBlock;
 }
 
+int ReadoutEquipmentPlayer::getPageBoundary(DataBlock *b, ReplayPosition &pos,
+                                            RdhPageIndex *index,
+                                            const char *data, size_t nBytes,
+                                            size_t &pageSize,
+                                            size_t &nPackets) {
+  int err = 0;
+  size_t pageOffset = 0;
+  nPackets = 0;
+  bool isPageComplete = false;
+  for (const RdhPacketInfo &p : index->packets) {
+    PacketHeader currentPacketHeader;
+    currentPacketHeader.linkId = (int)p.linkId;
+    currentPacketHeader.equipmentId = (int)p.cruId;
+
+    bool isFirst = (pos.fileOffset == 0) && (pageOffset == 0);
+
+    // same numbering as the TF id assigned to the page afterwards
+    currentPacketHeader.timeframeId =
+        timeframeIdAssigner.getTimeframeFromOrbit(p.hbOrbit + loopOrbitOffset);
+
+    // fill page metadata
+    if (pageOffset == 0) {
+      b->header.linkId = currentPacketHeader.linkId;
+      b->header.equipmentId = currentPacketHeader.equipmentId;
+    }
+
+    // changing link/cruid or TF -> change page
+    bool changePage = 0;
+    if (!isFirst) {
+      const PacketHeader &last = pos.lastPacketHeader;
+      if ((currentPacketHeader.linkId != last.linkId) ||
+          (currentPacketHeader.equipmentId != last.equipmentId) ||
+          (currentPacketHeader.timeframeId != last.timeframeId)) {
+        changePage = 1;
+      }
+    }
+    pos.lastPacketHeader = currentPacketHeader;
+    if (changePage) {
+      isPageComplete = true;
+      break;
+    }
+
+    if (p.offsetNextPacket == 0) {
+      isPageComplete = true;
+      break;
+    }
+    pageOffset += p.size;
+    nPackets++;
+  }
+
+  // index stopped before end of buffer: distinguish a packet
+  // truncated by the end of the buffer from an invalid packet
+  if ((!isPageComplete) && (index->error) &&
+      (pageOffset + sizeof(o2::Header::RAWDataHeader) <= nBytes)) {
+    RdhHandle h((void *)(data + pageOffset));
+    std::string errorDescription;
+    if (h.validateRdh(errorDescription)) {
+      theLog.log(InfoLogger::Severity::Error,
+                 "File %s RDH error, aborting replay @ 0x%lX: %s",
+                 name.c_str(), (unsigned long)(pos.fileOffset + pageOffset),
+                 errorDescription.c_str());
+      err = -1;
+    }
+  }
+
+  if (pageOffset == 0) {
+    theLog.log(InfoLogger::Severity::Error,
+               "File %s stopping replay @ 0x%lX, last packet invalid",
+               name.c_str(), (unsigned long)(pos.fileOffset + pageOffset));
+    err = -1;
+  }
+  pageSize = pageOffset;
+  return err;
+}
+
+int ReadoutEquipmentPlayer::readChunk(DataBlock *b) {
+  int err = 0;
+  // read from file
+  size_t nBytes = fread(b->data, 1, bytesPerPage, fp);
+  if ((nBytes == 0) && (!ferror(fp)) && (startNextPass() == 0)) {
+    // read again from beginning
+    position = ReplayPosition();
+    if (fseek(fp, 0L, SEEK_SET) == 0) {
+      nBytes = fread(b->data, 1, bytesPerPage, fp);
+    }
+  }
+  if (nBytes == 0) {
+    if (ferror(fp)) {
+      theLog.log(InfoLogger::Severity::Error,
+                 "File %s read error, aborting replay", name.c_str());
+    }
+    if (feof(fp)) {
+      theLog.log("File %s replay completed", name.c_str());
+    }
+    return -1;
+  }
+
+  // scan the data to find a page boundary
+  // the index is kept with the page for the next processing stages
+  b->header.dataSize = nBytes;
+  RdhPageIndex *index = getRdhPageIndex(b);
+  size_t pageSize = 0;
+  size_t nPackets = 0;
+  if (getPageBoundary(b, position, index, b->data, nBytes, pageSize,
+                      nPackets)) {
+    err = -1;
+  }
+
+  // keep index consistent with the page content
+  index->packets.resize(nPackets);
+  index->blockSize = pageSize;
+  index->error = 0;
+  index->errorDescription.clear();
+  shiftPageOrbits(b, *index);
+
+  int delta = nBytes - pageSize;
+  b->header.dataSize = pageSize;
+  position.fileOffset += pageSize;
+  if (delta > 0) {
+    // rewind if necessary
+    if (fseek(fp, position.fileOffset, SEEK_SET)) {
+      theLog.log(InfoLogger::Severity::Error,
+                 "Failed to seek in file, aborting replay");
+      err = -1;
+    }
+  }
+  return err;
+}
+
+int ReadoutEquipmentPlayer::readChunkFromMap(DataBlock *b) {
+  if ((position.fileOffset >= fileSize) && (startNextPass() == 0)) {
+    position = ReplayPosition();
+    fileMapAdvised = 0;
+  }
+  unsigned long fileOffset = position.fileOffset;
+  if (fileOffset >= fileSize) {
+    theLog.log("File %s replay completed", name.c_str());
+    return -1;
+  }
+  size_t nBytes = fileSize - fileOffset;
+  if (nBytes > bytesPerPage) {
+    nBytes = bytesPerPage;
+  }
+  const char *src = &fileMap[fileOffset];
+  adviseFileMap(fileOffset, nBytes);
+
+  size_t pageSize = 0;
+  return readChunkFromMemory(b, position, src, nBytes, pageSize);
+}
+
+void ReadoutEquipmentPlayer::adviseFileMap(size_t offset, size_t nBytes) {
+  if (offset + nBytes <= fileMapAdvised) {
+    return;
+  }
+  size_t begin = offset & ~((size_t)getpagesize() - 1);
+  size_t end = offset + nBytes + fileMapReadAhead;
+  if (end > fileSize) {
+    end = fileSize;
+  }
+  madvise(&fileMap[begin], end - begin, MADV_WILLNEED);
+  fileMapAdvised = end;
+}
+
+int ReadoutEquipmentPlayer::readChunkFromMemory(DataBlock *b,
+                                                ReplayPosition &pos,
+                                                const char *src, size_t nBytes,
+                                                size_t &pageSize) {
+  // scan the data in place to find a page boundary, and copy only the
+  // packets of the page. The index is then kept with the page.
+  RdhBlockHandle h((void *)src, nBytes);
+  h.scan(chunkIndex);
+  size_t nPackets = 0;
+  int err =
+      getPageBoundary(b, pos, &chunkIndex, src, nBytes, pageSize, nPackets);
+  memcpy(b->data, src, pageSize);
+  b->header.dataSize = pageSize;
+  chunkIndex.packets.resize(nPackets);
+  chunkIndex.error = 0;
+  chunkIndex.errorDescription.clear();
+  shiftPageOrbits(b, chunkIndex);
+  setRdhPageIndex(b, chunkIndex);
+  pos.fileOffset += pageSize;
+  return err;
+}
+
+int ReadoutEquipmentPlayer::readChunkFromReadBuffer(DataBlock *b) {
+  // data availability checked before
+  ReplayFile &f = replayFiles[currentReplayFile];
+  size_t nBytes = f.reader->getDataSize();
+  if (nBytes > bytesPerPage) {
+    nBytes = bytesPerPage;
+  }
+  size_t pageSize = 0;
+  int err = readChunkFromMemory(b, f.position, f.reader->getDataPointer(),
+                                nBytes, pageSize);
+  f.reader->consume(pageSize);
+  return err;
+}
+
+int ReadoutEquipmentPlayer::selectReplayFile() {
+  if (!isReplayStarted) {
+    for (auto &f : replayFiles) {
+      f.reader->start();
+    }
+    isReplayStarted = true;
+  }
+  int selected = -1;
+  uint32_t selectedOrbit = 0;
+  for (int i = 0; i < (int)replayFiles.size(); i++) {
+    ReplayFile &f = replayFiles[i];
+    if (f.isDone) {
+      continue;
+    }
+    int status = f.reader->getData(bytesPerPage);
+    if (status > 0) {
+      // wait data from all files, to keep ordering
+      return 1;
+    }
+    if (status < 0) {
+      if (f.reader->isError()) {
+        theLog.log(InfoLogger::Severity::Error,
+                   "File %s read error, aborting replay", f.path.c_str());
+        return -1;
+      }
+      f.isDone = true;
+      if (replayLoops == 1) {
+        theLog.log("File %s replay completed", f.path.c_str());
+      }
+      continue;
+    }
+    // orbit of next packet. A truncated packet is selected immediately, so
+    // that the replay stops on it.
+    uint32_t orbit = 0;
+    if (f.reader->getDataSize() >= sizeof(o2::Header::RAWDataHeader)) {
+      RdhHandle h((void *)f.reader->getDataPointer());
+      orbit = h.getHbOrbit();
+    }
+    if ((selected < 0) || (orbit < selectedOrbit)) {
+      selected = i;
+      selectedOrbit = orbit;
+    }
+  }
+  if (selected < 0) {
+    if (startNextPass() == 0) {
+      // read files again from beginning
+      for (auto &f : replayFiles) {
+        f.position = ReplayPosition();
+        f.isDone = false;
+        f.reader->start();
+      }
+      return 1;
+    }
+    if (replayFiles.size() > 1) {
+      theLog.log("Equipment %s: replay of %d files completed", name.c_str(),
+                 (int)replayFiles.size());
+    }
+    return -1;
+  }
+  currentReplayFile = selected;
+  return 0;
+}
+
+int ReadoutEquipmentPlayer::startNextPass() {
+  if ((replayLoops == 1) || (!isLoopOrbitRangeSet)) {
+    return -1;
+  }
+  if ((replayLoops > 0) && (replayPass >= replayLoops)) {
+    theLog.log("Equipment %s: replay completed after %d passes", name.c_str(),
+               replayPass);
+    return -1;
+  }
+  uint32_t period = timeframeIdAssigner.getPeriod();
+  uint32_t duration = loopLastOrbit - loopFirstOrbit + 1;
+  if (period > 0) {
+    duration = ((duration + period - 1) / period) * period;
+  }
+  loopOrbitOffset += duration;
+  replayPass++;
+  return 0;
+}
+
+void ReadoutEquipmentPlayer::shiftPageOrbits(DataBlock *b,
+                                             RdhPageIndex &index) {
+  if (replayLoops == 1) {
+    return;
+  }
+  if (replayPass == 1) {
+    for (const RdhPacketInfo &p : index.packets) {
+      if ((!isLoopOrbitRangeSet) || (p.hbOrbit < loopFirstOrbit)) {
+        loopFirstOrbit = p.hbOrbit;
+      }
+      if ((!isLoopOrbitRangeSet) || (p.hbOrbit > loopLastOrbit)) {
+        loopLastOrbit = p.hbOrbit;
+      }
+      isLoopOrbitRangeSet = true;
+    }
+    return;
+  }
+  // patch in place the orbits of each packet
+  for (RdhPacketInfo &p : index.packets) {
+    o2::Header::RAWDataHeader *rdh =
+        (o2::Header::RAWDataHeader *)&b->data[p.offset];
+    rdh->heartbeatOrbit += loopOrbitOffset;
+    rdh->triggerOrbit += loopOrbitOffset;
+    p.hbOrbit += loopOrbitOffset;
+  }
+}
+
+int ReadoutEquipmentPlayer::getNextLz4Block(DecompressJob &job) {
+  const uint32_t frameMagic = 0x184D2204;
+  const uint32_t skippableFrameMagic = 0x184D2A50; // 16 values, low bits free
+  auto read32 = [](const char *p) {
+    uint32_t v;
+    memcpy(&v, p, sizeof(v)); // little endian
+    return v;
+  };
+  for (;;) {
+    size_t offset = position.fileOffset;
+    size_t bytesLeft = fileSize - offset;
+    const char *p = &fileMap[offset];
+    if (!isLz4InFrame) {
+      if (bytesLeft == 0) {
+        return 1;
+      }
+      if (bytesLeft < 8) {
+        return -1;
+      }
+      uint32_t magic = read32(p);
+      if ((magic & 0xFFFFFFF0) == skippableFrameMagic) {
+        position.fileOffset += 8 + (size_t)read32(&p[4]);
+        if (position.fileOffset > fileSize) {
+          return -1;
+        }
+        continue;
+      }
+      if (magic != frameMagic) {
+        return -1;
+      }
+      // frame descriptor: FLG, BD, [content size], [dictionary id], HC
+      uint8_t flg = (uint8_t)p[4];
+      if ((flg >> 6) != 1) {
+        return -1; // unknown version
+      }
+      if ((!(flg & 0x20)) || (flg & 0x01)) {
+        return -1; // linked blocks or dictionary: not independent blocks
+      }
+      isLz4BlockChecksum = flg & 0x10;
+      isLz4ContentChecksum = flg & 0x04;
+      size_t headerSize = 7 + ((flg & 0x08) ? 8 : 0);
+      if (bytesLeft < headerSize) {
+        return -1;
+      }
+      position.fileOffset += headerSize;
+      isLz4InFrame = true;
+      continue;
+    }
+    if (bytesLeft < 4) {
+      return -1;
+    }
+    uint32_t blockSize = read32(p);
+    if (blockSize == 0) {
+      // end mark
+      position.fileOffset += 4 + (isLz4ContentChecksum ? 4 : 0);
+      isLz4InFrame = false;
+      if (position.fileOffset > fileSize) {
+        return -1;
+      }
+      continue;
+    }
+    job.isCompressed = !(blockSize & 0x80000000);
+    blockSize &= 0x7FFFFFFF;
+    size_t nBytes = 4 + (size_t)blockSize + (isLz4BlockChecksum ? 4 : 0);
+    if (nBytes > bytesLeft) {
+      return -1;
+    }
+    job.src = &p[4];
+    job.srcSize = blockSize;
+    adviseFileMap(offset, nBytes);
+    position.fileOffset += nBytes;
+    return 0;
+  }
+}
+
+DataBlockContainerReference ReadoutEquipmentPlayer::readLz4Block() {
+  if (!fpOk) {
+    return nullptr;
+  }
+  if (!isDecompressRunning) {
+    startDecompressWorkers();
+  }
+
+  // dispatch next blocks to the workers
+  while ((!isLz4Done) && (decompressPending <
+                          decompressQueueSize * (int)decompressWorkers.size())) {
+    if (decompressNextJob.src == nullptr) {
+      int status = getNextLz4Block(decompressNextJob);
+      if (status) {
+        if (status > 0) {
+          theLog.log("File %s replay completed", name.c_str());
+        } else {
+          theLog.log(InfoLogger::Severity::Error,
+                     "File %s LZ4 format error, aborting replay @ 0x%lX",
+                     name.c_str(), (unsigned long)position.fileOffset);
+        }
+        isLz4Done = true;
+        break;
+      }
+    }
+    DataBlockContainerReference nextBlock = nullptr;
+    try {
+      nextBlock = mp->getNewDataBlockContainer();
+    } catch (...) {
+    }
+    if (nextBlock == nullptr) {
+      break;
+    }
+    DataBlock *b = nextBlock->getData();
+    b->header.blockType = DataBlockType::H_BASE;
+    b->header.headerSize = sizeof(DataBlockHeaderBase);
+    b->header.dataSize = 0;
+    b->data = &(((char *)b)[sizeof(DataBlock)]);
+    decompressNextJob.block = nextBlock;
+    decompressWorkers[decompressNextIn].jobs->push(decompressNextJob);
+    decompressNextJob = DecompressJob();
+    decompressNextIn = (decompressNextIn + 1) % decompressWorkers.size();
+    decompressPending++;
+  }
+
+  // get next page, in file order
+  if (decompressPending == 0) {
+    if (isLz4Done) {
+      fpOk = false;
+    }
+    return nullptr;
+  }
+  DecompressJob job;
+  if (decompressWorkers[decompressNextOut].done->pop(job)) {
+    return nullptr;
+  }
+  decompressNextOut = (decompressNextOut + 1) % decompressWorkers.size();
+  decompressPending--;
+  if (job.err) {
+    theLog.log(InfoLogger::Severity::Error,
+               "File %s LZ4 decompression failed, aborting replay",
+               name.c_str());
+    isLz4Done = true;
+    fpOk = false;
+    return nullptr;
+  }
+  // link and CRU of the page from its first RDH
+  DataBlock *b = job.block->getData();
+  b->header.linkId = undefinedLinkId;
+  b->header.equipmentId = undefinedEquipmentId;
+  if (b->header.dataSize >= sizeof(o2::Header::RAWDataHeader)) {
+    RdhHandle h(b->data);
+    b->header.linkId = h.getLinkId();
+    b->header.equipmentId = h.getCruId();
+  }
+  lz4BytesIn += job.srcSize;
+  lz4BytesOut += b->header.dataSize;
+  return job.block;
+}
+
+void ReadoutEquipmentPlayer::runDecompressWorker(int workerIndex) {
+  threadPlacement.apply(name + "-lz4-" + std::to_string(workerIndex));
+  DecompressWorker &w = decompressWorkers[workerIndex];
+  int maxSize = (int)(memoryPoolPageSize - sizeof(DataBlock));
+  while (isDecompressRunning) {
+    DecompressJob job;
+    if (w.jobs->pop(job)) {
+      usleep(100);
+      continue;
+    }
+    DataBlock *b = job.block->getData();
+    if (job.isCompressed) {
+#ifdef WITH_LZ4
+      int nBytes =
+          LZ4_decompress_safe(job.src, b->data, (int)job.srcSize, maxSize);
+#else
+      int nBytes = -1;
+#endif
+      if (nBytes < 0) {
+        job.err = -1;
+      } else {
+        b->header.dataSize = nBytes;
+      }
+    } else if (job.srcSize > (size_t)maxSize) {
+      job.err = -1;
+    } else {
+      memcpy(b->data, job.src, job.srcSize);
+      b->header.dataSize = job.srcSize;
+    }
+    w.done->push(job);
+  }
+}
+
+void ReadoutEquipmentPlayer::startDecompressWorkers() {
+  stopDecompressWorkers();
+  isDecompressRunning = true;
+  for (int i = 0; i < (int)decompressWorkers.size(); i++) {
+    decompressWorkers[i].thread = std::make_unique<std::thread>(
+        &ReadoutEquipmentPlayer::runDecompressWorker, this, i);
+  }
+}
+
+void ReadoutEquipmentPlayer::stopDecompressWorkers() {
+  isDecompressRunning = false;
+  for (auto &w : decompressWorkers) {
+    if (w.thread != nullptr) {
+      w.thread->join();
+      w.thread = nullptr;
+    }
+    // release pages in flight
+    w.jobs->clear();
+    w.done->clear();
+  }
+}
+
+void ReadoutEquipmentPlayer::stopReplayFiles() {
+  for (auto &f : replayFiles) {
+    f.reader->stop();
+  }
+}
+
 void ReadoutEquipmentPlayer::initCounters() {
   fpOk = false;
+  if (fileMap != nullptr) {
+    fpOk = true;
+  }
+  if (readMode == ReadModeAsync) {
+    // files read again from beginning on first page request
+    stopReplayFiles();
+    for (auto &f : replayFiles) {
+      f.position = ReplayPosition();
+      f.isDone = false;
+    }
+    currentReplayFile = -1;
+    isReplayStarted = false;
+    fpOk = true;
+  }
   if (fp != nullptr) {
     if (fseek(fp, 0L, SEEK_SET) != 0) {
       theLog.log(InfoLogger::Severity::Error,
@@ -363,10 +1255,52 @@ void ReadoutEquipmentPlayer::initCounters() {
       fpOk = true;
     }
   }
-  fileOffset = 0;
-  lastPacketHeader.timeframeId = 0;
-  lastPacketHeader.linkId = undefinedLinkId;
-  firstTimeframeHbOrbitBegin = 0;
+  position = ReplayPosition();
+  fileMapAdvised = 0;
+  pacedBlock = nullptr;
+  isPacingStarted = false;
+  pacingDelay.reset();
+  replayPass = 1;
+  loopOrbitOffset = 0;
+  isLoopOrbitRangeSet = false;
+  if (isLz4) {
+    // file decompressed again from beginning on first page request
+    stopDecompressWorkers();
+    decompressNextIn = 0;
+    decompressNextOut = 0;
+    decompressPending = 0;
+    decompressNextJob = DecompressJob();
+    isLz4InFrame = false;
+    isLz4Done = false;
+    lz4BytesIn = 0;
+    lz4BytesOut = 0;
+  }
+}
+
+void ReadoutEquipmentPlayer::finalCounters() {
+  stopReplayFiles();
+  pacedBlock = nullptr;
+  if (isLz4) {
+    stopDecompressWorkers();
+    decompressPending = 0;
+    decompressNextJob = DecompressJob();
+    theLog.log("Equipment %s: LZ4 data replayed, %s decompressed to %s",
+               name.c_str(),
+               ReadoutUtils::NumberOfBytesToString(lz4BytesIn, "Bytes").c_str(),
+               ReadoutUtils::NumberOfBytesToString(lz4BytesOut, "Bytes")
+                   .c_str());
+  }
+  if (replayLoops != 1) {
+    theLog.log("Equipment %s: data replayed %d times, last orbit shift %u",
+               name.c_str(), replayPass, loopOrbitOffset);
+  }
+  if ((replaySpeed > 0) && (pacingDelay.getCount())) {
+    theLog.log("Equipment %s: paced replay of %llu pages, release delay "
+               "average %.1f us, maximum %.1f us",
+               name.c_str(), (unsigned long long)pacingDelay.getCount(),
+               pacingDelay.getAverage() / 1000.0,
+               pacingDelay.getMaximum() / 1000.0);
+  }
 }
 
 std::unique_ptr<ReadoutEquipment>
@@ -79,26 +79,6 @@ private:
       0; // number of empty pages read out
   unsigned long long statsNumberOfPagesLost =
       0; // number of pages read out but lost
-  unsigned long long statsNumberOfTimeframes =
-      0; // number of timeframes read out
-
-  AliceO2::Common::Timer
-      timeframeClock; // timeframe id should be increased at each clock cycle
-  uint64_t currentTimeframe = 0; // id of current timeframe
-  bool usingSoftwareClock =
-      false; // if set, using internal software clock to generate timeframe id
-
-  const unsigned int LHCBunches = 3564; // number of bunches in LHC
-  const unsigned int LHCOrbitRate =
-      11246; // LHC orbit rate, in Hz. 299792458 / 26659
-  uint32_t timeframePeriodOrbits =
-      256; // timeframe interval duration in number of LHC orbits
-  double timeframeRate = 0; // timeframe rate, when generated internally
-
-  uint32_t currentTimeframeHbOrbitBegin =
-      0; // HbOrbit of beginning of timeframe
-  uint32_t firstTimeframeHbOrbitBegin =
-      0; // HbOrbit of beginning of first timeframe
 
   uint8_t RdhLastPacketCounter[RdhMaxLinkId + 1]; // last value of packetCounter
                                                   // RDH field for each link id
@@ -187,12 +167,6 @@ ReadoutEquipmentRORC::ReadoutEquipmentRORC(ConfigFile &cfg, std::string name)
           "Superpages will be cleaned before each DMA - this may be slow!");
     }
 
-    // configuration parameter: | equipment-rorc-* | TFperiod | int | 256 |
-    // Duration of a timeframe, in number of LHC orbits. |
-    int cfgTFperiod = 256;
-    cfg.getOptionalValue<int>(name + ".TFperiod", cfgTFperiod);
-    timeframePeriodOrbits = cfgTFperiod;
-
     /*    // get readout memory buffer parameters
         std::string sMemorySize=cfg.getValue<std::string>(name +
        ".memoryBufferSize"); std::string
@@ -245,6 +219,27 @@ ReadoutEquipmentRORC::ReadoutEquipmentRORC(ConfigFile &cfg, std::string name)
     }
     */
 
+    // in auto placement mode, readout thread and memory pool go on the NUMA
+    // node of the card. The node is found here from the PCI address, if given
+    // as card id, so that the pool can still be moved before it is registered
+    // for DMA.
+    int cardNumaNode = -1;
+    if (threadPlacement.isAuto()) {
+      cardNumaNode = ThreadPlacement::getPciDeviceNumaNode(cardId);
+      if (cardNumaNode >= 0) {
+        threadPlacement.setAutoNumaNode(cardNumaNode);
+        if (mp->bindToNumaNode(cardNumaNode) == 0) {
+          theLog.log("Equipment %s : memory pool placed on NUMA node %d",
+                     name.c_str(), cardNumaNode);
+        } else {
+          theLog.log(InfoLogger::Severity::Warning,
+                     "Equipment %s : memory pool could not be placed on NUMA "
+                     "node %d",
+                     name.c_str(), cardNumaNode);
+        }
+      }
+    }
+
     // register the memory block for DMA
     void *baseAddress = (void *)mp->getBaseBlockAddress();
     size_t blockSize = mp->getBaseBlockSize();
@@ -277,22 +272,24 @@ ReadoutEquipmentRORC::ReadoutEquipmentRORC(ConfigFile &cfg, std::string name)
                name.c_str(), infoPciAddress.c_str(), infoNumaNode,
                infoSerialNumber.c_str(), infoFirmwareVersion.c_str(),
                infoCardId.c_str());
+    if ((threadPlacement.isAuto()) && (infoNumaNode >= 0) &&
+        (infoNumaNode != cardNumaNode)) {
+      // memory already registered for DMA, only the thread can be placed
+      threadPlacement.setAutoNumaNode(infoNumaNode);
+      theLog.log(InfoLogger::Severity::Warning,
+                 "Equipment %s : memory pool not placed on NUMA node %d of the "
+                 "card, use a PCI address as cardId or set numaNode of the "
+                 "memory bank",
+                 name.c_str(), infoNumaNode);
+    }
 
     // todo: log parameters ?
 
-    if (!cfgRdhUseFirstInPageEnabled) {
-      usingSoftwareClock =
-          true; // if RDH disabled, use internal clock for TF id
-    }
-    theLog.log("Timeframe length = %d orbits", (int)timeframePeriodOrbits);
-    if (usingSoftwareClock) {
-      timeframeRate =
-          LHCOrbitRate * 1.0 / timeframePeriodOrbits; // timeframe rate, in Hz
-      theLog.log("Timeframe IDs generated by software, %.2lf Hz",
-                 timeframeRate);
-    } else {
-      theLog.log("Timeframe IDs generated from RDH trigger counters");
+    // TF id from RDH if enabled, from internal clock otherwise
+    if (cfgRdhUseFirstInPageEnabled) {
+      defaultTimeframeIdSource = TimeframeIdAssigner::FirstRdhInPage;
     }
+    timeframeIdAssigner.setNonContiguousWarning(cfgRdhDumpErrorEnabled);
 
   } catch (const std::exception &e) {
     std::cout << "Error: " << e.what() << '\n'
@@ -450,19 +447,10 @@ DataBlockContainerReference ReadoutEquipmentRORC::getNextBlock() {
 
         // printf("\nPage %llu\n",statsNumberOfPages);
 
-        // in software clock mode, set timeframe id based on current timestamp
-        if (usingSoftwareClock) {
-          if (timeframeClock.isTimeout()) {
-            currentTimeframe++;
-            statsNumberOfTimeframes++;
-            timeframeClock.increment();
-          }
-        }
-
         // default values for metadata
         int equipmentId = undefinedEquipmentId;
         int linkId = undefinedLinkId;
-        int hbOrbit = -1;
+        uint64_t timeframeId = undefinedTimeframeId;
 
         // retrieve metadata from RDH, if configured to do so
         if ((cfgRdhUseFirstInPageEnabled) || (cfgRdhCheckEnabled)) {
@@ -486,39 +474,10 @@ DataBlockContainerReference ReadoutEquipmentRORC::getNextBlock() {
             // linkId
             linkId = h.getLinkId();
 
-            // timeframe ID
-            hbOrbit = h.getHbOrbit();
-            // printf("HB orbit %u\n",hbOrbit);
-            // printf("Page %llu, link %d, orbit
-            // %u\n",statsNumberOfPages,linkId,hbOrbit);
-            if ((statsNumberOfPages == 1) ||
-                ((uint32_t)hbOrbit >=
-                 currentTimeframeHbOrbitBegin + timeframePeriodOrbits)) {
-              if (statsNumberOfPages == 1) {
-                firstTimeframeHbOrbitBegin = hbOrbit;
-              }
-              statsNumberOfTimeframes++;
-              currentTimeframeHbOrbitBegin =
-                  hbOrbit - ((hbOrbit - firstTimeframeHbOrbitBegin) %
-                             timeframePeriodOrbits); // keep it periodic and
-                                                     // aligned to 1st timeframe
-              uint64_t newTimeframe = 1 + (currentTimeframeHbOrbitBegin -
-                                           firstTimeframeHbOrbitBegin) /
-                                              timeframePeriodOrbits;
-              if (newTimeframe != currentTimeframe + 1) {
-                if (cfgRdhDumpErrorEnabled) {
-                  theLog.log(InfoLogger::Severity::Warning,
-                             "Non-contiguous timeframe IDs %llu ... %llu",
-                             (unsigned long long)currentTimeframe,
-                             (unsigned long long)newTimeframe);
-                }
-              }
-              currentTimeframe = newTimeframe;
-              // printf("Starting timeframe %llu @ orbit %d (actual:
-              // %d)\n",currentTimeframe,(int)currentTimeframeHbOrbitBegin,(int)hbOrbit);
-            } else {
-              // printf("HB orbit %d\n",hbOrbit);
-            }
+            // timeframe ID, to check all packets in page are in same timeframe
+            // (the one of the page is set afterwards in ReadoutEquipment)
+            timeframeId = timeframeIdAssigner.getTimeframeFromOrbit(
+                h.getHbOrbit());
           }
         }
 
@@ -526,7 +485,6 @@ DataBlockContainerReference ReadoutEquipmentRORC::getNextBlock() {
         d->getData()->header.dataSize = superpage.getReceived();
         d->getData()->header.equipmentId = equipmentId;
         d->getData()->header.linkId = linkId;
-        d->getData()->header.timeframeId = currentTimeframe;
 
         // Dump RDH if configured to do so
         if (cfgRdhDumpEnabled) {
@@ -544,81 +502,66 @@ DataBlockContainerReference ReadoutEquipmentRORC::getNextBlock() {
         // validate RDH structure, if configured to do so
         if (cfgRdhCheckEnabled) {
           std::string errorDescription;
-          size_t blockSize = d->getData()->header.dataSize;
           uint8_t *baseAddress = (uint8_t *)(d->getData()->data);
+
+          // the page is parsed once, the index is kept with the page for the
+          // next processing stages
+          RdhPageIndex *index = getRdhPageIndex(d->getData());
+          bool isPageOk = true;
           int rdhIndexInPage = 0;
 
-          for (size_t pageOffset = 0; pageOffset < blockSize;) {
-            RdhHandle h(baseAddress + pageOffset);
+          for (const RdhPacketInfo &p : index->packets) {
+            size_t pageOffset = p.offset;
             rdhIndexInPage++;
 
-            // printf("RDH #%d @ 0x%X : next block @ +%d
-            // bytes\n",rdhIndexInPage,(unsigned
-            // int)pageOffset,h.getOffsetNextPacket());
-
-            // data format:
-            // RDH v3 =
-            // https://docs.google.com/document/d/1otkSDYasqpVBDnxplBI7dWNxaZohctA-bvhyrzvtLoQ/edit?usp=sharing
-            if (h.validateRdh(errorDescription)) {
-              if ((cfgRdhDumpEnabled) || (cfgRdhDumpErrorEnabled)) {
-                for (int i = 0; i < 16; i++) {
-                  printf("%08X ", (int)(((uint32_t *)baseAddress)[i]));
-                }
-                printf("\n");
-                printf("Page 0x%p + %ld\n%s", (void *)baseAddress, pageOffset,
-                       errorDescription.c_str());
-                h.dumpRdh(pageOffset, 1);
-                errorDescription.clear();
-              }
-              statsRdhCheckErr++;
-              // stop on first RDH error (should distinguich valid/invalid block
-              // length)
-              break;
-            } else {
-              statsRdhCheckOk++;
-
-              if (cfgRdhDumpEnabled) {
-                h.dumpRdh(pageOffset, 1);
-                for (int i = 0; i < 16; i++) {
-                  printf("%08X ",
-                         (int)(((uint32_t *)baseAddress + pageOffset)[i]));
-                }
-                printf("\n");
+            // RDH format checked when building index
+            statsRdhCheckOk++;
+            if (cfgRdhDumpEnabled) {
+              RdhHandle h(baseAddress + pageOffset);
+              h.dumpRdh(pageOffset, 1);
+              for (int i = 0; i < 16; i++) {
+                printf("%08X ",
+                       (int)(((uint32_t *)baseAddress + pageOffset)[i]));
               }
+              printf("\n");
             }
 
             // linkId should be same everywhere in page
-            if (linkId != h.getLinkId()) {
+            if (linkId != p.linkId) {
               if (cfgRdhDumpErrorEnabled) {
                 theLog.log(InfoLogger::Severity::Warning,
                            "RDH #%d @ 0x%X : inconsistent link ids: %d != %d",
                            rdhIndexInPage, (unsigned int)pageOffset, linkId,
-                           h.getLinkId());
+                           (int)p.linkId);
               }
               statsRdhCheckStreamErr++;
+              isPageOk = false;
               break; // stop checking this page
             }
 
             // check no timeframe overlap in page
-            if ((uint32_t)hbOrbit >=
-                currentTimeframeHbOrbitBegin + timeframePeriodOrbits) {
+            uint64_t packetTimeframeId =
+                timeframeIdAssigner.getTimeframeFromOrbit(p.hbOrbit);
+            if (packetTimeframeId != timeframeId) {
               if (cfgRdhDumpErrorEnabled) {
                 theLog.log(InfoLogger::Severity::Warning,
                            "RDH #%d @ 0x%X : TimeFrame ID change in page not "
-                           "allowed : hbOrbit %u > %u + %u",
+                           "allowed : hbOrbit %u in TF %llu != %llu",
                            rdhIndexInPage, (unsigned int)pageOffset,
-                           (uint32_t)hbOrbit, currentTimeframeHbOrbitBegin,
-                           timeframePeriodOrbits);
+                           p.hbOrbit, (unsigned long long)packetTimeframeId,
+                           (unsigned long long)timeframeId);
               }
               statsRdhCheckStreamErr++;
+              isPageOk = false;
               break; // stop checking this page
             }
 
             // check packetCounter is contiguous
             if (cfgRdhCheckPacketCounterContiguous) {
+              RdhHandle h(baseAddress + pageOffset);
               uint8_t newCount = h.getPacketCounter();
               // no boundary check necessary to verify linkId<=RdhMaxLinkId,
-              // this was done in validateRDH()
+              // this was done when building index
               if (newCount != RdhLastPacketCounter[linkId]) {
                 if (newCount !=
                     (uint8_t)(RdhLastPacketCounter[linkId] + (uint8_t)1)) {
@@ -636,12 +579,32 @@ DataBlockContainerReference ReadoutEquipmentRORC::getNextBlock() {
             // TODO
             // check counter increasing
             // all have same TF id
+          }
 
-            uint16_t offsetNextPacket = h.getOffsetNextPacket();
-            if (offsetNextPacket == 0) {
-              break;
+          // index stopped on an invalid packet
+          if ((isPageOk) && (index->error)) {
+            if ((cfgRdhDumpEnabled) || (cfgRdhDumpErrorEnabled)) {
+              for (int i = 0; i < 16; i++) {
+                printf("%08X ", (int)(((uint32_t *)baseAddress)[i]));
+              }
+              printf("\n");
+              size_t pageOffset = 0;
+              if (index->packets.size()) {
+                pageOffset = index->packets.back().offset +
+                             index->packets.back().size;
+              }
+              printf("Page 0x%p + %ld\n%s\n", (void *)baseAddress,
+                     (long)pageOffset, index->errorDescription.c_str());
+              if (pageOffset + sizeof(o2::Header::RAWDataHeader) <=
+                  d->getData()->header.dataSize) {
+                RdhHandle h(baseAddress + pageOffset);
+                if (h.validateRdh(errorDescription)) {
+                  printf("%s", errorDescription.c_str());
+                }
+                h.dumpRdh(pageOffset, 1);
+              }
             }
-            pageOffset += offsetNextPacket;
+            statsRdhCheckErr++;
           }
         }
       } else {
@@ -709,15 +672,6 @@ void ReadoutEquipmentRORC::initCounters() {
   statsNumberOfPages = 0;
   statsNumberOfPagesEmpty = 0;
   statsNumberOfPagesLost = 0;
-  statsNumberOfTimeframes = 0;
-
-  // reset timeframe id
-  currentTimeframe = 0;
-
-  // reset timeframe clock
-  if (usingSoftwareClock) {
-    timeframeClock.reset(1000000 / timeframeRate);
-  }
 
   // reset packetCounter monitor
   for (unsigned int i = 0; i <= RdhMaxLinkId; i++) {
@@ -730,9 +684,11 @@ void ReadoutEquipmentRORC::finalCounters() {
     theLog.log("Equipment %s : %llu timeframes, %llu pages (+ %llu lost + %llu "
                "empty), RDH checks %llu ok, %llu "
                "errors, %llu stream inconsistencies %d packets dropped by CRU",
-               name.c_str(), statsNumberOfTimeframes, statsNumberOfPages,
-               statsNumberOfPagesLost, statsNumberOfPagesEmpty, statsRdhCheckOk,
-               statsRdhCheckErr, statsRdhCheckStreamErr, lastPacketDropped);
+               name.c_str(),
+               (unsigned long long)timeframeIdAssigner.getLastTimeframeId(),
+               statsNumberOfPages, statsNumberOfPagesLost,
+               statsNumberOfPagesEmpty, statsRdhCheckOk, statsRdhCheckErr,
+               statsRdhCheckStreamErr, lastPacketDropped);
   } else {
     theLog.log("Equipment %s : %llu pages (+ %llu lost + %llu empty)",
                name.c_str(), statsNumberOfPages, statsNumberOfPagesLost,
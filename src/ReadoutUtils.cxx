@@ -11,6 +11,7 @@
 #include "ReadoutUtils.h"
 #include <math.h>
 #include <sstream>
+#include <stdlib.h>
 
 #include "RAWDataHeader.h"
 
@@ -78,6 +79,29 @@ std::string ReadoutUtils::NumberOfBytesToString(double value,
   return std::string(bufStr);
 }
 
+int ReadoutUtils::getSizeClassesFromString(
+    const std::string &input, std::vector<std::pair<size_t, size_t>> &output) {
+  output.clear();
+  std::istringstream is(input);
+  std::string s;
+  while (std::getline(is, s, ',')) {
+    std::size_t ix = s.find(":");
+    if (ix == std::string::npos) {
+      return -1;
+    }
+    long long pageSize = getNumberOfBytesFromString(s.substr(0, ix).c_str());
+    long long numberOfPages = atoll(s.substr(ix + 1).c_str());
+    if ((pageSize <= 0) || (numberOfPages <= 0)) {
+      return -1;
+    }
+    output.push_back({(size_t)pageSize, (size_t)numberOfPages});
+  }
+  if (output.size() == 0) {
+    return -1;
+  }
+  return 0;
+}
+
 void dumpRDH(o2::Header::RAWDataHeader *rdh) {
   printf("RDH:\tversion=%d\theader size=%d\tblock length=%d\n",
          (int)rdh->version, (int)rdh->headerSize, (int)rdh->blockLength);
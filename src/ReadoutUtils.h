@@ -13,6 +13,8 @@
 
 #include <map>
 #include <string>
+#include <utility>
+#include <vector>
 
 #include <Common/Configuration.h>
 
@@ -29,6 +31,16 @@ long long getNumberOfBytesFromString(const char *inputString);
 // suffix is the "base unit" to add after calculated prefix, e.g. Byte-> kBytes
 std::string NumberOfBytesToString(double value, const char *suffix);
 
+// function to parse a list of memory pool size classes
+// format: comma-separated list of pageSize:numberOfPages, with pageSize in
+// bytes (allowing suffixes as for getNumberOfBytesFromString),
+// e.g. 4k:1000,64k:100,1M:10
+// output: list of (pageSize, numberOfPages) pairs
+// returns 0 on success, -1 on error
+int getSizeClassesFromString(
+    const std::string &input,
+    std::vector<std::pair<size_t, size_t>> &output);
+
 } // namespace ReadoutUtils
 
 // print RDH struct content to stdout
@@ -30,11 +30,13 @@
 using namespace AliceO2::InfoLogger;
 extern InfoLogger theLog; // hook to global infologger handle
 
-SocketTx::SocketTx(std::string name, std::string host, int port) {
+SocketTx::SocketTx(std::string name, std::string host, int port,
+                   ThreadPlacement placement) {
   shutdownRequest = 0;
   clientName = name;
   serverHost = host;
   serverPort = port;
+  threadPlacement = placement;
 
   isSending = 0;
   currentBlock = nullptr;
@@ -58,6 +60,11 @@ SocketTx::~SocketTx() {
 
 void SocketTx::run() {
 
+  if (threadPlacement.isEnabled()) {
+    threadPlacement.apply(clientName + " -> " + serverHost + ":" +
+                          std::to_string(serverPort));
+  }
+
   // connect remote server
 
   int sockfd = socket(AF_INET, SOCK_STREAM, 0);
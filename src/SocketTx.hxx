@@ -19,6 +19,8 @@
 #include <Common/DataSet.h>
 #include <Common/Fifo.h>
 
+#include "ThreadPlacement.h"
+
 // class to send data blocks remotely over a TCP/IP socket
 class SocketTx {
 public:
@@ -26,7 +28,9 @@ public:
   // name: name given to this client, for logging purpose
   // serverHost: IP of remote server to connect to
   // serverPort: port number of remote server to connect to
-  SocketTx(std::string name, std::string serverHost, int serverPort);
+  // placement: placement of the sending thread (CPU affinity / NUMA node)
+  SocketTx(std::string name, std::string serverHost, int serverPort,
+           ThreadPlacement placement = ThreadPlacement());
 
   // destructor
   ~SocketTx();
@@ -50,6 +54,8 @@ private:
   std::string serverHost; // remote server IP
   int serverPort;         // remote server port
 
+  ThreadPlacement threadPlacement; // placement of the sending thread
+
 private:
   std::atomic<int> isSending; // if set, thread busy sending. if not set, new
                               // block can be pushed
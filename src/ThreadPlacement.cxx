@@ -0,0 +1,224 @@
+// Copyright CERN and copyright holders of ALICE O2. This software is
+// distributed under the terms of the GNU General Public License v3 (GPL
+// Version 3), copied verbatim in the file "COPYING".
+//
+// See http://alice-o2.web.cern.ch/license for full licensing information.
+//
+// In applying this license CERN does not waive the privileges and immunities
+// granted to it by virtue of its status as an Intergovernmental Organization
+// or submit itself to any jurisdiction.
+
+#include "ThreadPlacement.h"
+
+#include <fstream>
+#include <initializer_list>
+#include <pthread.h>
+#include <sched.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef WITH_NUMA
+#include <numa.h>
+#endif
+
+#include <InfoLogger/InfoLogger.hxx>
+using namespace AliceO2::InfoLogger;
+extern InfoLogger theLog;
+
+// convert a list of CPUs (e.g. "0-3,8") to a cpu set
+// returns 0 on success, -1 on error
+static int getCpuSetFromString(const std::string &input, cpu_set_t &cpus) {
+  CPU_ZERO(&cpus);
+  int nCpus = 0;
+  const char *ptr = input.c_str();
+  while (*ptr != 0) {
+    char *end;
+    long first = strtol(ptr, &end, 10);
+    if (end == ptr) {
+      return -1;
+    }
+    long last = first;
+    ptr = end;
+    if (*ptr == '-') {
+      ptr++;
+      last = strtol(ptr, &end, 10);
+      if (end == ptr) {
+        return -1;
+      }
+      ptr = end;
+    }
+    if ((first < 0) || (last < first) || (last >= CPU_SETSIZE)) {
+      return -1;
+    }
+    for (long i = first; i <= last; i++) {
+      CPU_SET(i, &cpus);
+      nCpus++;
+    }
+    while ((*ptr == ',') || (*ptr == ' ') || (*ptr == '\n')) {
+      ptr++;
+    }
+  }
+  if (nCpus == 0) {
+    return -1;
+  }
+  return 0;
+}
+
+// convert a cpu set to a list of CPUs (e.g. "0-3,8")
+static std::string getStringFromCpuSet(const cpu_set_t &cpus) {
+  std::string s;
+  for (int i = 0; i < CPU_SETSIZE; i++) {
+    if (!CPU_ISSET(i, &cpus)) {
+      continue;
+    }
+    int j = i;
+    while ((j + 1 < CPU_SETSIZE) && (CPU_ISSET(j + 1, &cpus))) {
+      j++;
+    }
+    if (s.length()) {
+      s += ",";
+    }
+    s += std::to_string(i);
+    if (j > i) {
+      s += "-" + std::to_string(j);
+    }
+    i = j;
+  }
+  return s;
+}
+
+int ThreadPlacement::setFromString(const std::string &spec) {
+  if ((spec.length() == 0) || (spec == "none")) {
+    mode = None;
+    description = "none";
+    return 0;
+  }
+  if (spec == "auto") {
+    mode = Auto;
+    description = spec;
+    return 0;
+  }
+  if (spec.compare(0, 5, "numa:") == 0) {
+    char *end;
+    long node = strtol(&spec.c_str()[5], &end, 10);
+    if ((*end != 0) || (end == &spec.c_str()[5]) || (node < 0)) {
+      return -1;
+    }
+    mode = Numa;
+    numaNode = (int)node;
+    description = spec;
+    return 0;
+  }
+  cpu_set_t cpuSet;
+  if (getCpuSetFromString(spec, cpuSet)) {
+    return -1;
+  }
+  mode = Cpus;
+  cpus = spec;
+  description = spec;
+  return 0;
+}
+
+void ThreadPlacement::setAutoNumaNode(int node) { autoNumaNode = node; }
+
+bool ThreadPlacement::isEnabled() { return mode != None; }
+
+bool ThreadPlacement::isAuto() { return mode == Auto; }
+
+int ThreadPlacement::getNumaNode() {
+  if (mode == Numa) {
+    return numaNode;
+  }
+  if (mode == Auto) {
+    return autoNumaNode;
+  }
+  return -1;
+}
+
+const std::string &ThreadPlacement::getDescription() { return description; }
+
+int ThreadPlacement::apply(const std::string &threadName) {
+  int err = 0;
+  int node = getNumaNode();
+  std::string cpuList = cpus;
+  if (node >= 0) {
+    if (getNumaNodeCpus(node, cpuList)) {
+      theLog.log(InfoLogger::Severity::Error,
+                 "Thread %s : can not get CPUs of NUMA node %d",
+                 threadName.c_str(), node);
+      cpuList = "";
+      node = -1;
+      err = -1;
+    }
+  }
+
+  if (cpuList.length()) {
+    cpu_set_t cpuSet;
+    if (getCpuSetFromString(cpuList, cpuSet)) {
+      err = -1;
+    } else {
+      int errAffinity =
+          pthread_setaffinity_np(pthread_self(), sizeof(cpuSet), &cpuSet);
+      if (errAffinity) {
+        theLog.log(InfoLogger::Severity::Error,
+                   "Thread %s : failed to set CPU affinity %s: %s",
+                   threadName.c_str(), cpuList.c_str(), strerror(errAffinity));
+        err = -1;
+      }
+    }
+  }
+
+#ifdef WITH_NUMA
+  if ((node >= 0) && (numa_available() >= 0)) {
+    numa_set_preferred(node);
+  }
+#endif
+
+  std::string placement = "CPU " + getCurrentCpus();
+  if (node >= 0) {
+    placement += " (NUMA node " + std::to_string(node) + ")";
+  }
+  if ((mode == Auto) && (autoNumaNode < 0)) {
+    placement += " (auto: NUMA node unknown, not pinned)";
+  }
+  theLog.log("Thread %s : placement %s, running on %s", threadName.c_str(),
+             description.c_str(), placement.c_str());
+  return err;
+}
+
+std::string ThreadPlacement::getCurrentCpus() {
+  cpu_set_t cpuSet;
+  CPU_ZERO(&cpuSet);
+  if (pthread_getaffinity_np(pthread_self(), sizeof(cpuSet), &cpuSet)) {
+    return "unknown";
+  }
+  return getStringFromCpuSet(cpuSet);
+}
+
+int ThreadPlacement::getNumaNodeCpus(int node, std::string &cpus) {
+  std::ifstream f("/sys/devices/system/node/node" + std::to_string(node) +
+                  "/cpulist");
+  std::string s;
+  if (!std::getline(f, s)) {
+    return -1;
+  }
+  cpu_set_t cpuSet;
+  if (getCpuSetFromString(s, cpuSet)) {
+    return -1;
+  }
+  cpus = getStringFromCpuSet(cpuSet);
+  return 0;
+}
+
+int ThreadPlacement::getPciDeviceNumaNode(const std::string &pciAddress) {
+  // try address as given, and with default PCI domain
+  for (auto const &prefix : {"", "0000:"}) {
+    std::ifstream f("/sys/bus/pci/devices/" + std::string(prefix) +
+                    pciAddress + "/numa_node");
+    int node;
+    if (f >> node) {
+      return (node >= 0) ? node : -1;
+    }
+  }
+  return -1;
+}
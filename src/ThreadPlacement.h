@@ -0,0 +1,74 @@
+// Copyright CERN and copyright holders of ALICE O2. This software is
+// distributed under the terms of the GNU General Public License v3 (GPL
+// Version 3), copied verbatim in the file "COPYING".
+//
+// See http://alice-o2.web.cern.ch/license for full licensing information.
+//
+// In applying this license CERN does not waive the privileges and immunities
+// granted to it by virtue of its status as an Intergovernmental Organization
+// or submit itself to any jurisdiction.
+
+/// \file ThreadPlacement.h
+/// \brief Placement of threads on a set of CPU cores, or on a NUMA node.
+/// \descr The placement is defined from a configuration string, and applied
+/// by the thread itself (it works for any kind of thread, including those
+/// created by Common::Thread). CPU lists of NUMA nodes and NUMA node of PCI
+/// devices are read from sysfs, so that they are available also when readout
+/// is built without NUMA library.
+
+#ifndef _THREADPLACEMENT_H
+#define _THREADPLACEMENT_H
+
+#include <string>
+
+class ThreadPlacement {
+public:
+  // set placement from a configuration string. One of:
+  // - empty, or "none": thread not pinned.
+  // - "auto": thread pinned on the CPUs of the NUMA node defined with
+  // setAutoNumaNode(), if any (e.g. NUMA node of the readout card).
+  // - "numa:N": thread pinned on the CPUs of NUMA node N.
+  // - a list of CPU indexes, e.g. "0-3,8,10-11".
+  // returns 0 on success, -1 on error
+  int setFromString(const std::string &spec);
+
+  // set NUMA node to be used in "auto" mode (-1 if unknown)
+  void setAutoNumaNode(int node);
+
+  bool isEnabled(); // true if some placement is requested
+  bool isAuto();    // true if in "auto" mode
+
+  // get the NUMA node where the thread should run (-1 if none)
+  int getNumaNode();
+
+  // get placement as configured
+  const std::string &getDescription();
+
+  // apply placement to the calling thread, and log the resulting placement.
+  // When a NUMA node is defined, memory allocations of the thread are also
+  // done preferably on this node (if built with NUMA support).
+  // threadName: name used in logs
+  // returns 0 on success, -1 on error
+  int apply(const std::string &threadName);
+
+  // get the list of CPUs where the calling thread may run, e.g. "0-3,8"
+  static std::string getCurrentCpus();
+
+  // get the list of CPUs of a NUMA node
+  // returns 0 on success, -1 on error
+  static int getNumaNodeCpus(int node, std::string &cpus);
+
+  // get the NUMA node of a PCI device, from its address, e.g. "3b:00.0"
+  // returns -1 if unknown (or if not a PCI address)
+  static int getPciDeviceNumaNode(const std::string &pciAddress);
+
+private:
+  enum Mode { None, Auto, Numa, Cpus };
+  Mode mode = None;
+  std::string description = "none"; // placement, as configured
+  std::string cpus;                 // list of CPUs (mode Cpus)
+  int numaNode = -1;                // NUMA node (mode Numa)
+  int autoNumaNode = -1;            // NUMA node (mode Auto)
+};
+
+#endif // #ifndef _THREADPLACEMENT_H
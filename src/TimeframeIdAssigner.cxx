@@ -0,0 +1,132 @@
+// Copyright CERN and copyright holders of ALICE O2. This software is
+// distributed under the terms of the GNU General Public License v3 (GPL
+// Version 3), copied verbatim in the file "COPYING".
+//
+// See http://alice-o2.web.cern.ch/license for full licensing information.
+//
+// In applying this license CERN does not waive the privileges and immunities
+// granted to it by virtue of its status as an Intergovernmental Organization
+// or submit itself to any jurisdiction.
+
+#include "TimeframeIdAssigner.h"
+
+#include <InfoLogger/InfoLogger.hxx>
+using namespace AliceO2::InfoLogger;
+extern InfoLogger theLog;
+
+int TimeframeIdAssigner::getSourceFromString(const std::string &s,
+                                             Source &source) {
+  if (s == "software") {
+    source = SoftwareClock;
+    return 0;
+  }
+  if (s == "rdh") {
+    source = FirstRdhInPage;
+    return 0;
+  }
+  return -1;
+}
+
+const char *TimeframeIdAssigner::getSourceName(Source source) {
+  if (source == FirstRdhInPage) {
+    return "rdh";
+  }
+  return "software";
+}
+
+void TimeframeIdAssigner::setPeriod(uint32_t vPeriodOrbits) {
+  periodOrbits = (vPeriodOrbits > 0) ? vPeriodOrbits : 1;
+}
+
+uint32_t TimeframeIdAssigner::getPeriod() { return periodOrbits; }
+
+void TimeframeIdAssigner::setSource(Source vSource) { source = vSource; }
+
+TimeframeIdAssigner::Source TimeframeIdAssigner::getSource() { return source; }
+
+void TimeframeIdAssigner::reset() {
+  clockTimeframeId = 1;
+  if (source == SoftwareClock) {
+    double timeframeRate = LHCOrbitRate * 1.0 / periodOrbits; // in Hz
+    clock.reset(1000000 / timeframeRate);
+  }
+  isFirstOrbitSet = false;
+  firstOrbit = 0;
+  for (auto &l : links) {
+    l = LinkState();
+  }
+  lastTimeframeId = undefinedTimeframeId;
+}
+
+int TimeframeIdAssigner::assign(DataBlock *b) {
+  uint64_t timeframeId;
+
+  if (source == SoftwareClock) {
+    if (clock.isTimeout()) {
+      clockTimeframeId++;
+      clock.increment();
+    }
+    timeframeId = clockTimeframeId;
+  } else {
+    // read first RDH in page
+    if (b->header.dataSize < sizeof(o2::Header::RAWDataHeader)) {
+      return -1;
+    }
+    RdhHandle h(b->data);
+    uint8_t linkId = h.getLinkId();
+    if ((linkId > RdhMaxLinkId) ||
+        ((h.getHeaderVersion() != 3) && (h.getHeaderVersion() != 4))) {
+      return -1;
+    }
+    uint32_t hbOrbit = h.getHbOrbit();
+
+    // same timeframe as previous page of this link ?
+    LinkState &l = links[linkId];
+    if ((l.isValid) && ((uint32_t)(hbOrbit - l.beginOrbit) < periodOrbits)) {
+      timeframeId = l.timeframeId;
+    } else {
+      timeframeId = getTimeframeFromOrbit(hbOrbit);
+      if (timeframeId == undefinedTimeframeId) {
+        return -1;
+      }
+      if ((isNonContiguousWarningEnabled) && (l.isValid) &&
+          (timeframeId != l.timeframeId + 1)) {
+        theLog.log(InfoLogger::Severity::Warning,
+                   "Link %d : non-contiguous timeframe IDs %llu ... %llu",
+                   (int)linkId, (unsigned long long)l.timeframeId,
+                   (unsigned long long)timeframeId);
+      }
+      l.isValid = true;
+      l.timeframeId = timeframeId;
+      l.beginOrbit = firstOrbit + (uint32_t)((timeframeId - 1) * periodOrbits);
+    }
+  }
+
+  b->header.timeframeId = timeframeId;
+  if (timeframeId > lastTimeframeId) {
+    lastTimeframeId = timeframeId;
+  }
+  return 0;
+}
+
+uint64_t TimeframeIdAssigner::getTimeframeFromOrbit(uint32_t hbOrbit) {
+  if (!isFirstOrbitSet) {
+    firstOrbit = hbOrbit;
+    isFirstOrbitSet = true;
+  }
+  if (hbOrbit < firstOrbit) {
+    return undefinedTimeframeId;
+  }
+  return 1 + (hbOrbit - firstOrbit) / periodOrbits;
+}
+
+void TimeframeIdAssigner::setFirstOrbit(uint32_t hbOrbit) {
+  firstOrbit = hbOrbit;
+  isFirstOrbitSet = true;
+}
+
+uint64_t TimeframeIdAssigner::getLastTimeframeId() { return lastTimeframeId; }
+
+void TimeframeIdAssigner::setNonContiguousWarning(bool enabled) {
+  isNonContiguousWarningEnabled = enabled;
+}
@@ -0,0 +1,108 @@
+// Copyright CERN and copyright holders of ALICE O2. This software is
+// distributed under the terms of the GNU General Public License v3 (GPL
+// Version 3), copied verbatim in the file "COPYING".
+//
+// See http://alice-o2.web.cern.ch/license for full licensing information.
+//
+// In applying this license CERN does not waive the privileges and immunities
+// granted to it by virtue of its status as an Intergovernmental Organization
+// or submit itself to any jurisdiction.
+
+/// \file TimeframeIdAssigner.h
+/// \brief Assignment of timeframe ids to data pages, common to all equipments.
+/// \descr Timeframe ids are either generated by a software clock running at
+/// the LHC timeframe rate, or computed from the heartbeat orbit of the first
+/// RDH in page. In the latter case, ids are aligned on the first orbit seen
+/// after reset (timeframe 1 starts there), and the current timeframe of each
+/// link is kept, so that in most cases a page gets its id from a single
+/// comparison, without division nor further parsing of the page.
+/// The first orbit is common to all links on purpose: pages from different
+/// links covering the same orbit range must get the same timeframe id, so
+/// that they can be aggregated downstream. With a per-link baseline, a link
+/// starting later than the others would be numbered from 1 again, and its
+/// timeframes would not match those of the other links.
+
+#ifndef _TIMEFRAMEIDASSIGNER_H
+#define _TIMEFRAMEIDASSIGNER_H
+
+#include <Common/DataBlock.h>
+#include <Common/Timer.h>
+#include <stdint.h>
+#include <string>
+
+#include "RdhUtils.h"
+
+class TimeframeIdAssigner {
+public:
+  // where timeframe ids are taken from
+  enum Source { SoftwareClock, FirstRdhInPage };
+
+  // convert a string to a source ("software" or "rdh")
+  // returns 0 on success, -1 on error
+  static int getSourceFromString(const std::string &s, Source &source);
+
+  // get name of a source
+  static const char *getSourceName(Source source);
+
+  // set duration of a timeframe, in number of LHC orbits
+  void setPeriod(uint32_t periodOrbits);
+  uint32_t getPeriod();
+
+  // set source of timeframe ids
+  void setSource(Source source);
+  Source getSource();
+
+  // reset state, e.g. before a new run
+  void reset();
+
+  // set timeframe id of a data page, according to source
+  // returns 0 on success, -1 if timeframe id could not be found from page
+  // content (in which case the page is left unchanged)
+  int assign(DataBlock *b);
+
+  // get timeframe id corresponding to a heartbeat orbit. The first orbit seen
+  // after reset defines the beginning of timeframe 1. Can be used by the
+  // equipments to cut pages on timeframe boundaries, consistently with the ids
+  // assigned to pages.
+  // returns undefinedTimeframeId for orbits before the first orbit.
+  uint64_t getTimeframeFromOrbit(uint32_t hbOrbit);
+
+  // define the first orbit of timeframe 1, instead of the first orbit seen
+  // after reset. To be called after reset(), e.g. by equipments computing
+  // timeframe boundaries on their own (from other threads) consistently with
+  // the ids assigned to pages.
+  void setFirstOrbit(uint32_t hbOrbit);
+
+  // get highest timeframe id assigned since reset
+  uint64_t getLastTimeframeId();
+
+  // if set, a warning is logged when the timeframe id of a link does not
+  // follow the previous one (ids from RDH only). Disabled by default.
+  void setNonContiguousWarning(bool enabled);
+
+private:
+  Source source = SoftwareClock;
+  uint32_t periodOrbits = 256; // timeframe duration, in number of LHC orbits
+
+  // software clock
+  AliceO2::Common::Timer clock; // timeframe id incremented at each cycle
+  uint64_t clockTimeframeId = 1; // current timeframe id
+
+  // timeframe from RDH
+  bool isFirstOrbitSet = false; // set when first orbit known
+  uint32_t firstOrbit = 0;      // orbit of the beginning of timeframe 1
+                                // (same for all links, see above)
+
+  // current timeframe of each link
+  struct LinkState {
+    bool isValid = false;
+    uint32_t beginOrbit = 0; // first orbit of current timeframe
+    uint64_t timeframeId = undefinedTimeframeId; // current timeframe
+  };
+  LinkState links[RdhMaxLinkId + 1];
+
+  uint64_t lastTimeframeId = undefinedTimeframeId; // highest id assigned
+  bool isNonContiguousWarningEnabled = false;
+};
+
+#endif // #ifndef _TIMEFRAMEIDASSIGNER_H
@@ -0,0 +1,49 @@
+// Copyright CERN and copyright holders of ALICE O2. This software is
+// distributed under the terms of the GNU General Public License v3 (GPL
+// Version 3), copied verbatim in the file "COPYING".
+//
+// See http://alice-o2.web.cern.ch/license for full licensing information.
+//
+// In applying this license CERN does not waive the privileges and immunities
+// granted to it by virtue of its status as an Intergovernmental Organization
+// or submit itself to any jurisdiction.
+
+#include "TokenBucket.h"
+
+#include <chrono>
+
+// current time, in nanoseconds
+static inline uint64_t getTimeNs() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+void TokenBucket::configure(double vRate, uint64_t vBurst) {
+  rate = (vRate > 0) ? vRate / 1e9 : 0;
+  burst = (vBurst > 0) ? (double)vBurst : 1;
+  reset();
+}
+
+bool TokenBucket::isEnabled() { return rate > 0; }
+
+void TokenBucket::reset() {
+  tokens = burst;
+  lastTime = getTimeNs();
+}
+
+void TokenBucket::refill() {
+  uint64_t now = getTimeNs();
+  tokens += (now - lastTime) * rate;
+  lastTime = now;
+  if (tokens > burst) {
+    tokens = burst;
+  }
+}
+
+bool TokenBucket::isAvailable() {
+  refill();
+  return tokens > 0;
+}
+
+void TokenBucket::consume(uint64_t bytes) { tokens -= (double)bytes; }
@@ -0,0 +1,51 @@
+// Copyright CERN and copyright holders of ALICE O2. This software is
+// distributed under the terms of the GNU General Public License v3 (GPL
+// Version 3), copied verbatim in the file "COPYING".
+//
+// See http://alice-o2.web.cern.ch/license for full licensing information.
+//
+// In applying this license CERN does not waive the privileges and immunities
+// granted to it by virtue of its status as an Intergovernmental Organization
+// or submit itself to any jurisdiction.
+
+/// \file TokenBucket.h
+/// \brief Token bucket, to limit a data rate in bytes per second.
+/// \descr Tokens (bytes) are added continuously at the configured rate, up to
+/// the burst size. As the size of the next item is usually not known before
+/// it is read, an item can be taken as soon as the bucket is not empty, and
+/// its size is then removed from the bucket, possibly leaving it negative.
+/// The average rate is exact, and the burst is limited to the burst size plus
+/// one item.
+
+#ifndef _TOKENBUCKET_H
+#define _TOKENBUCKET_H
+
+#include <stdint.h>
+
+class TokenBucket {
+public:
+  // set rate (bytes per second, 0 for unlimited) and burst size (bytes)
+  void configure(double rate, uint64_t burst);
+
+  // true if a rate limit is set
+  bool isEnabled();
+
+  // fill the bucket, e.g. at start of run
+  void reset();
+
+  // returns true if there are tokens available
+  bool isAvailable();
+
+  // remove given number of bytes from the bucket
+  void consume(uint64_t bytes);
+
+private:
+  void refill(); // add tokens for the time elapsed since last refill
+
+  double rate = 0;       // bytes per nanosecond
+  double burst = 0;      // maximum number of tokens
+  double tokens = 0;     // current number of tokens
+  uint64_t lastTime = 0; // time of last refill, in nanoseconds
+};
+
+#endif // #ifndef _TOKENBUCKET_H
@@ -46,16 +46,13 @@
 #include "ReadoutEquipment.h"
 #include "ReadoutStats.h"
 #include "ReadoutUtils.h"
+#include "ThreadPlacement.h"
 
 #include <fcntl.h>
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <termios.h>
 
-#ifdef WITH_NUMA
-#include <numa.h>
-#endif
-
 // option to add callgrind instrumentation
 // to use: valgrind --tool=callgrind --instr-atstart=no --dump-instr=yes ./a.out
 // to display stats: kcachegrind
@@ -138,6 +135,11 @@ static void signalHandler(int signalId) {
   ShutdownRequest = 1;
 }
 
+// signal handler to request a report of memory pages in use
+static volatile sig_atomic_t MemoryReportRequest =
+    0; // set to 1 to request a report, on SIGUSR1
+static void signalHandlerMemoryReport(int) { MemoryReportRequest = 1; }
+
 class Readout {
 
 public:
@@ -164,6 +166,8 @@ private:
   double cfgFlushEquipmentTimeout;
   int cfgDisableAggregatorSlicing;
   double cfgAggregatorSliceTimeout;
+  ThreadPlacement mainLoopPlacement;   // placement of main loop thread
+  ThreadPlacement aggregatorPlacement; // placement of aggregator thread
   int cfgLogbookEnabled;
   std::string cfgLogbookUrl;
   std::string cfgLogbookApiToken;
@@ -177,7 +181,7 @@ private:
                        // to push data
   std::vector<std::unique_ptr<ReadoutEquipment>> readoutDevices;
   std::unique_ptr<DataBlockAggregator> agg;
-  std::unique_ptr<AliceO2::Common::Fifo<DataSetReference>> agg_output;
+  std::unique_ptr<FifoSPSC<DataSetReference>> agg_output;
 
   int isRunning =
       0; // set to 1 when running, 0 when not running (or should stop running)
@@ -255,6 +259,9 @@ int Readout::init(int argc, char *argv[]) {
   sigaction(SIGTERM, &signalSettings, NULL);
   sigaction(SIGQUIT, &signalSettings, NULL);
   sigaction(SIGINT, &signalSettings, NULL);
+  signalSettings.sa_handler = signalHandlerMemoryReport;
+  signalSettings.sa_flags = SA_RESTART;
+  sigaction(SIGUSR1, &signalSettings, NULL);
 
   // log startup and options
   theLog.log("Readout process starting, pid %d", getpid());
@@ -436,6 +443,29 @@ int Readout::configure(const boost::property_tree::ptree &properties) {
   cfgAggregatorSliceTimeout = 0;
   cfg.getOptionalValue<double>("readout.aggregatorSliceTimeout",
                                cfgAggregatorSliceTimeout);
+  // configuration parameter: | readout | cpuAffinity | string | | Placement
+  // of the main readout loop thread, pushing data to the consumers. One of:
+  // none (default, not pinned), numa:N (pinned on the CPUs of NUMA node N), or
+  // a list of CPU indexes (e.g. 0-3,8). Actual placement is logged at start of
+  // run. |
+  std::string cfgCpuAffinity;
+  cfg.getOptionalValue<std::string>("readout.cpuAffinity", cfgCpuAffinity);
+  if (mainLoopPlacement.setFromString(cfgCpuAffinity)) {
+    theLog.log(InfoLogger::Severity::Error, "Wrong readout.cpuAffinity %s",
+               cfgCpuAffinity.c_str());
+    return -1;
+  }
+  // configuration parameter: | readout | aggregatorCpuAffinity | string | |
+  // Placement of the aggregator thread. Same syntax as readout.cpuAffinity. |
+  std::string cfgAggregatorCpuAffinity;
+  cfg.getOptionalValue<std::string>("readout.aggregatorCpuAffinity",
+                                    cfgAggregatorCpuAffinity);
+  if (aggregatorPlacement.setFromString(cfgAggregatorCpuAffinity)) {
+    theLog.log(InfoLogger::Severity::Error,
+               "Wrong readout.aggregatorCpuAffinity %s",
+               cfgAggregatorCpuAffinity.c_str());
+    return -1;
+  }
   // configuration parameter: | readout | logbookEnabled | int | 0 | When set,
   // the logbook is enabled and populated with readout stats at runtime. |
   cfgLogbookEnabled = 0;
@@ -470,7 +500,6 @@ int Readout::configure(const boost::property_tree::ptree &properties) {
   }
 
   // configuration of memory banks
-  int numaNodeChanged = 0;
   for (auto kName : ConfigFileBrowser(&cfg, "bank-")) {
     // skip disabled
     int enabled = 1;
@@ -498,7 +527,8 @@ int Readout::configure(const boost::property_tree::ptree &properties) {
 
     // bank type
     // configuration parameter: | bank-* | type | string| | Support used to
-    // allocate memory. Possible values: malloc, MemoryMappedFile. |
+    // allocate memory. Possible values: malloc, MemoryMappedFile,
+    // MemoryMappedAnonymous, memfd. |
     std::string cfgType = "";
     try {
       cfgType = cfg.getValue<std::string>(kName + ".type");
@@ -512,31 +542,53 @@ int Readout::configure(const boost::property_tree::ptree &properties) {
 
     // numa node
     // configuration parameter: | bank-* | numaNode | int | -1| Numa node where
-    // memory should be allocated. -1 means unspecified (system will choose). |
+    // memory should be allocated. -1 means unspecified (system will choose).
+    // The memory range of the bank is bound to this node (for malloc type,
+    // memory is then allocated with mmap() instead of malloc(), and for
+    // MemoryMappedFile type, pages already allocated which can not be moved
+    // are left in place). Actual placement is checked and reported in the
+    // logs. |
     int cfgNumaNode = -1;
     cfg.getOptionalValue<int>(kName + ".numaNode", cfgNumaNode);
 
+    // configuration parameter: | bank-* | populate | int | 0 | For
+    // MemoryMappedAnonymous and memfd types: if set, memory is allocated
+    // immediately (MAP_POPULATE). |
+    int cfgPopulate = 0;
+    cfg.getOptionalValue<int>(kName + ".populate", cfgPopulate);
+    // configuration parameter: | bank-* | lock | int | 0 | For
+    // MemoryMappedAnonymous and memfd types: if set, memory is locked in RAM
+    // (mlock). This may need to increase the process limit of locked memory. |
+    int cfgLock = 0;
+    cfg.getOptionalValue<int>(kName + ".lock", cfgLock);
+
+    // configuration parameter: | bank-* | prefaultMode | string | zero | How
+    // memory of the bank is initialized: zero (write zeroes into the whole
+    // bank), touch (write one byte per page, to allocate memory), skip (do
+    // nothing, memory is allocated on first access). |
+    std::string cfgPrefaultMode = "zero";
+    cfg.getOptionalValue<std::string>(kName + ".prefaultMode",
+                                      cfgPrefaultMode);
+    // configuration parameter: | bank-* | prefaultThreads | int | 0 | Number
+    // of threads used in parallel to initialize the memory of the bank. They
+    // run on the NUMA node of the bank, if defined. If 0, set automatically
+    // (number of cores of the node, up to 16). |
+    int cfgPrefaultThreads = 0;
+    cfg.getOptionalValue<int>(kName + ".prefaultThreads", cfgPrefaultThreads);
+    // configuration parameter: | bank-* | prefaultNonTemporal | int | 0 | If
+    // set, zeroes are written with non-temporal stores (bypassing the CPU
+    // caches). |
+    int cfgPrefaultNonTemporal = 0;
+    cfg.getOptionalValue<int>(kName + ".prefaultNonTemporal",
+                              cfgPrefaultNonTemporal);
+
     // instanciate new memory pool
-    if (cfgNumaNode >= 0) {
-#ifdef WITH_NUMA
-      struct bitmask *nodemask;
-      nodemask = numa_allocate_nodemask();
-      if (nodemask == NULL) {
-        return -1;
-      }
-      numa_bitmask_clearall(nodemask);
-      numa_bitmask_setbit(nodemask, cfgNumaNode);
-      numa_set_membind(nodemask);
-      numa_free_nodemask(nodemask);
-      theLog.log("Enforcing memory allocated on NUMA node %d", cfgNumaNode);
-      numaNodeChanged = 1;
-#endif
-    }
-    theLog.log("Creating memory bank %s: type %s size %lld", kName.c_str(),
-               cfgType.c_str(), mSize);
+    theLog.log("Creating memory bank %s: type %s size %lld numa node %d",
+               kName.c_str(), cfgType.c_str(), mSize, cfgNumaNode);
     std::shared_ptr<MemoryBank> b = nullptr;
     try {
-      b = getMemoryBank(mSize, cfgType, kName);
+      b = getMemoryBank(mSize, cfgType, kName, cfgNumaNode, cfgPopulate,
+                        cfgLock);
     } catch (...) {
     }
     if (b == nullptr) {
@@ -545,24 +597,20 @@ int Readout::configure(const boost::property_tree::ptree &properties) {
       continue;
     }
     // cleanup the memory range
-    b->clear();
+    if (b->prefault(cfgPrefaultMode, cfgPrefaultThreads,
+                    cfgPrefaultNonTemporal)) {
+      theLog.log(InfoLogger::Severity::Error,
+                 "Failed to initialize memory bank %s", kName.c_str());
+      continue;
+    }
+    // report where memory is
+    b->checkNumaPlacement();
+    b->checkHugePages();
     // add bank to list centrally managed
     theMemoryBankManager.addBank(b, kName);
     theLog.log("Bank %s added", kName.c_str());
   }
 
-  // releasing memory bind policy
-  if (numaNodeChanged) {
-#ifdef WITH_NUMA
-    struct bitmask *nodemask;
-    nodemask = numa_get_mems_allowed();
-    numa_set_membind(nodemask);
-    // is this needed? not specified in doc...
-    // numa_free_nodemask(nodemask);
-    theLog.log("Releasing memory NUMA node enforcment");
-#endif
-  }
-
   // configuration of data consumers
   for (auto kName : ConfigFileBrowser(&cfg, "consumer-")) {
 
@@ -594,7 +642,8 @@ int Readout::configure(const boost::property_tree::ptree &properties) {
     try {
       // configuration parameter: | consumer-* | consumerType | string |  | The
       // type of consumer to be instanciated. One of:stats, FairMQDevice,
-      // DataSampling, FairMQChannel, fileRecorder, checker, processor, tcp. |
+      // DataSampling, FairMQChannel, fileRecorder, checker, processor, tcp,
+      // memfd. |
       std::string cfgType = "";
       cfgType = cfg.getValue<std::string>(kName + ".consumerType");
       theLog.log("Configuring consumer %s: %s", kName.c_str(), cfgType.c_str());
@@ -630,6 +679,8 @@ int Readout::configure(const boost::property_tree::ptree &properties) {
         newConsumer = getUniqueConsumerDataProcessor(cfg, kName);
       } else if (!cfgType.compare("tcp")) {
         newConsumer = getUniqueConsumerTCP(cfg, kName);
+      } else if (!cfgType.compare("memfd")) {
+        newConsumer = getUniqueConsumerMemfd(cfg, kName);
       } else if (!cfgType.compare("rdma")) {
 #ifdef WITH_RDMA
         newConsumer = getUniqueConsumerRDMA(cfg, kName);
@@ -768,7 +819,7 @@ int Readout::configure(const boost::property_tree::ptree &properties) {
 
   // aggregator
   theLog.log("Creating aggregator");
-  agg_output = std::make_unique<AliceO2::Common::Fifo<DataSetReference>>(1000);
+  agg_output = std::make_unique<FifoSPSC<DataSetReference>>(1000);
   int nEquipmentsAggregated = 0;
   agg = std::make_unique<DataBlockAggregator>(agg_output.get(), "Aggregator");
 
@@ -779,6 +830,9 @@ int Readout::configure(const boost::property_tree::ptree &properties) {
   }
   theLog.log("Aggregator: %d equipments", nEquipmentsAggregated);
 
+  // report memory banks usage
+  theMemoryBankManager.logBanksUsage();
+
   theLog.log("Readout completed CONFIGURE");
   return 0;
 }
@@ -805,6 +859,7 @@ int Readout::start() {
                cfgAggregatorSliceTimeout);
     agg->cfgSliceTimeout = cfgAggregatorSliceTimeout;
   }
+  agg->threadPlacement = aggregatorPlacement;
 
   agg->start();
 
@@ -842,21 +897,26 @@ int Readout::start() {
 void Readout::loopRunning() {
 
   theLog.log("Entering main loop");
+  mainLoopPlacement.apply("readout");
 #ifdef CALLGRIND
   theLog.log("Starting callgrind instrumentation");
   CALLGRIND_START_INSTRUMENTATION;
 #endif
 
+  const int maxDataSetBatchSize = 16;
+  DataSetReference dataSetBatch[maxDataSetBatchSize];
+
   for (;;) {
     if ((!isRunning) &&
         ((cfgFlushEquipmentTimeout <= 0) || (stopTimer.isTimeout()))) {
       break;
     }
 
-    DataSetReference bc = nullptr;
-    agg_output->pop(bc);
+    // get data sets by batches
+    int nDataSets = agg_output->popBatch(dataSetBatch, maxDataSetBatchSize);
 
-    if (bc != nullptr) {
+    for (int ix = 0; ix < nDataSets; ix++) {
+      DataSetReference bc = std::move(dataSetBatch[ix]);
       // count number of subtimeframes
       if (bc->size() > 0) {
         if (bc->at(0)->getData() != nullptr) {
@@ -868,6 +928,11 @@ void Readout::loopRunning() {
         }
       }
 
+      for (auto &b : *bc) {
+        MemoryPagesPool::setPageStage(b->getData(),
+                                      MemoryPagesPool::StageConsumers);
+      }
+
       for (auto &c : dataConsumers) {
         // push only to "prime" consumers, not to those getting data directly
         // forwarded from another consumer
@@ -885,7 +950,9 @@ void Readout::loopRunning() {
           isError = 1;
         }
       }
-    } else {
+    }
+
+    if (nDataSets == 0) {
       // we are idle...
       // todo: set configurable idling time
       usleep(1000);
@@ -927,6 +994,11 @@ int Readout::iterateRunning() {
   if (isError) {
     return -1;
   }
+  // report of memory pages in use, on request
+  if (MemoryReportRequest) {
+    MemoryReportRequest = 0;
+    MemoryPagesPool::logTrackingReportAll();
+  }
   // regular logbook stats update
   if (logbookTimer.isTimeout()) {
     publishLogbookStats();
@@ -988,6 +1060,8 @@ int Readout::stop() {
                  (int)nPagesTotal, nPagesUsed * 100.0 / nPagesTotal);
     }
   }
+  // details of pages in use, for pools with tracking enabled
+  MemoryPagesPool::logTrackingReportAll();
 
   // publish final logbook statistics
   publishLogbookStats();
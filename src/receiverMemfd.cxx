@@ -0,0 +1,193 @@
+// Copyright CERN and copyright holders of ALICE O2. This software is
+// distributed under the terms of the GNU General Public License v3 (GPL
+// Version 3), copied verbatim in the file "COPYING".
+//
+// See http://alice-o2.web.cern.ch/license for full licensing information.
+//
+// In applying this license CERN does not waive the privileges and immunities
+// granted to it by virtue of its status as an Intergovernmental Organization
+// or submit itself to any jurisdiction.
+
+// Simple data receiver program for the memfd consumer
+// Connects to readout unix socket, maps the shared memory bank read-only,
+// reads the data pages (without copy) and gives them back to readout.
+// Prints statistics.
+// usage: receiverMemfd.exe [socketPath] [maxPages]
+// If maxPages is set, the program exits after having received and released
+// this number of pages (e.g. for tests).
+
+#include <InfoLogger/InfoLogger.hxx>
+#include <chrono>
+#include <errno.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "MemfdProtocol.h"
+
+// definition of a global for logging
+using namespace AliceO2::InfoLogger;
+InfoLogger theLog;
+
+// signal handlers
+static int ShutdownRequest =
+    0; // set to 1 to request termination, e.g. on SIGTERM/SIGQUIT signals
+static void signalHandler(int) {
+  theLog.log("*** break ***");
+  if (ShutdownRequest) {
+    // immediate exit if pending exit request
+    exit(1);
+  }
+  ShutdownRequest = 1;
+}
+
+// program main
+int main(int argc, const char **argv) {
+
+  std::string socketPath = "/tmp/readout-memfd";
+  if (argc > 1) {
+    socketPath = argv[1];
+  }
+  uint64_t maxPages = 0; // number of pages to receive, unlimited if zero
+  if (argc > 2) {
+    maxPages = strtoull(argv[2], nullptr, 10);
+  }
+
+  // connect to readout
+  struct sockaddr_un addr;
+  bzero(&addr, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  if (socketPath.length() >= sizeof(addr.sun_path)) {
+    theLog.log("Socket path too long");
+    return -1;
+  }
+  strcpy(addr.sun_path, socketPath.c_str());
+  int fd = socket(AF_UNIX, SOCK_SEQPACKET, 0);
+  if (fd < 0) {
+    theLog.log("Failed to create socket: %s", strerror(errno));
+    return -1;
+  }
+  if (connect(fd, (struct sockaddr *)&addr, sizeof(addr))) {
+    theLog.log("Failed to connect to %s: %s", socketPath.c_str(),
+               strerror(errno));
+    return -1;
+  }
+  theLog.log("Connected to %s", socketPath.c_str());
+
+  // get bank info and file descriptor
+  MemfdProtocol::Message msg;
+  struct iovec iov;
+  iov.iov_base = &msg;
+  iov.iov_len = sizeof(msg);
+  char control[CMSG_SPACE(sizeof(int))];
+  struct msghdr mh;
+  bzero(&mh, sizeof(mh));
+  mh.msg_iov = &iov;
+  mh.msg_iovlen = 1;
+  mh.msg_control = control;
+  mh.msg_controllen = sizeof(control);
+  if ((recvmsg(fd, &mh, 0) != sizeof(msg)) ||
+      (msg.type != MemfdProtocol::BankInfo) ||
+      (msg.version != MemfdProtocol::protocolVersion)) {
+    theLog.log("Failed to get bank info");
+    return -1;
+  }
+  struct cmsghdr *cm = CMSG_FIRSTHDR(&mh);
+  if ((cm == nullptr) || (cm->cmsg_level != SOL_SOCKET) ||
+      (cm->cmsg_type != SCM_RIGHTS)) {
+    theLog.log("Failed to get bank file descriptor");
+    return -1;
+  }
+  int bankFd;
+  memcpy(&bankFd, CMSG_DATA(cm), sizeof(int));
+  size_t bankSize = msg.size;
+  msg.bankName[sizeof(msg.bankName) - 1] = 0;
+
+  // map bank memory, read-only
+  void *bankAddress =
+      mmap(nullptr, bankSize, PROT_READ, MAP_SHARED, bankFd, 0);
+  if (bankAddress == MAP_FAILED) {
+    theLog.log("Failed to map bank: %s", strerror(errno));
+    return -1;
+  }
+  theLog.log("Bank %s mapped: %ld bytes @ %p", msg.bankName, (long)bankSize,
+             bankAddress);
+
+  // configure signal handlers for clean exit
+  struct sigaction signalSettings;
+  bzero(&signalSettings, sizeof(signalSettings));
+  signalSettings.sa_handler = signalHandler;
+  sigaction(SIGTERM, &signalSettings, NULL);
+  sigaction(SIGQUIT, &signalSettings, NULL);
+  sigaction(SIGINT, &signalSettings, NULL);
+
+  // receive pages
+  uint64_t nPages = 0, nBytes = 0, nPagesLast = 0, nBytesLast = 0;
+  uint64_t checksum = 0;
+  auto t0 = std::chrono::steady_clock::now();
+  struct timeval tv = {0, 100000};
+  setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+  while (!ShutdownRequest) {
+    if ((maxPages) && (nPages >= maxPages)) {
+      break;
+    }
+    ssize_t n = recv(fd, &msg, sizeof(msg), 0);
+    if ((n < 0) && ((errno == EAGAIN) || (errno == EWOULDBLOCK) ||
+                    (errno == EINTR))) {
+      n = -1;
+    } else if (n != sizeof(msg)) {
+      theLog.log("Disconnected");
+      break;
+    }
+    if (n == sizeof(msg)) {
+      if (msg.type == MemfdProtocol::Page) {
+        if (msg.offset + msg.size > bankSize) {
+          theLog.log("Page %llu out of bank range",
+                     (unsigned long long)msg.pageId);
+        } else {
+          // read data in place
+          const uint64_t *data =
+              (const uint64_t *)&((char *)bankAddress)[msg.offset];
+          for (size_t i = 0; i < msg.size / sizeof(uint64_t); i++) {
+            checksum += data[i];
+          }
+          nPages++;
+          nBytes += msg.size;
+        }
+        // give page back
+        msg.type = MemfdProtocol::Release;
+        if (send(fd, &msg, sizeof(msg), MSG_NOSIGNAL) != sizeof(msg)) {
+          theLog.log("Failed to release page: %s", strerror(errno));
+          break;
+        }
+      } else if (msg.type == MemfdProtocol::EndOfRun) {
+        theLog.log("End of run");
+      }
+    }
+
+    // print stats
+    auto t1 = std::chrono::steady_clock::now();
+    double t = std::chrono::duration<double>(t1 - t0).count();
+    if (t >= 1.0) {
+      theLog.log("%.1f pages/s, %.3f MB/s",
+                 (nPages - nPagesLast) / t,
+                 (nBytes - nBytesLast) / t / (1024.0 * 1024.0));
+      nPagesLast = nPages;
+      nBytesLast = nBytes;
+      t0 = t1;
+    }
+  }
+
+  theLog.log("Received %llu pages, %llu bytes, checksum 0x%llX",
+             (unsigned long long)nPages, (unsigned long long)nBytes,
+             (unsigned long long)checksum);
+  munmap(bankAddress, bankSize);
+  close(bankFd);
+  close(fd);
+  return 0;
+}
@@ -0,0 +1,249 @@
+// Copyright CERN and copyright holders of ALICE O2. This software is
+// distributed under the terms of the GNU General Public License v3 (GPL
+// Version 3), copied verbatim in the file "COPYING".
+//
+// See http://alice-o2.web.cern.ch/license for full licensing information.
+//
+// In applying this license CERN does not waive the privileges and immunities
+// granted to it by virtue of its status as an Intergovernmental Organization
+// or submit itself to any jurisdiction.
+
+// test program to check the memfd consumer and its protocol.
+// Data pages are allocated from a memfd bank and pushed to the consumer.
+// - a receiverMemfd.exe process is started: it connects, receives pages and
+// releases them, and disconnects after a given number of pages. All pages
+// should then be back in the pool.
+// - a client connects, but does not read its socket: stop() should not be
+// blocked, and all pages should be back in the pool after stop().
+// usage: testConsumerMemfd.exe [receiverMemfdPath]
+
+#include "Consumer.h"
+#include "MemfdProtocol.h"
+#include "MemoryBankManager.h"
+
+#include <InfoLogger/InfoLogger.hxx>
+#include <chrono>
+#include <libgen.h>
+#include <signal.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+using namespace AliceO2::InfoLogger;
+InfoLogger theLog;
+
+const size_t pageSize = 16 * 1024;
+const int numberOfPages = 1024;           // pages in pool
+const int numberOfPagesReceived = 10000; // pages read by receiver
+const double timeout = 10;               // in seconds
+
+// get time elapsed since t0, in seconds
+double getElapsed(std::chrono::steady_clock::time_point t0) {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - t0)
+      .count();
+}
+
+// wait until all pages are back in pool
+// returns 0 on success, -1 on timeout
+int waitPagesBack(std::shared_ptr<MemoryPagesPool> &pool) {
+  auto t0 = std::chrono::steady_clock::now();
+  while (pool->getNumberOfPagesAvailable() != pool->getTotalNumberOfPages()) {
+    if (getElapsed(t0) > timeout) {
+      printf("Pages not released: %d/%d available\n",
+             (int)pool->getNumberOfPagesAvailable(),
+             (int)pool->getTotalNumberOfPages());
+      return -1;
+    }
+    usleep(1000);
+  }
+  return 0;
+}
+
+// push a new page to consumer, filled with a pattern
+// returns result of pushData(), or 1 if no page available in pool
+int pushPage(std::shared_ptr<MemoryPagesPool> &pool,
+             std::unique_ptr<Consumer> &consumer, uint64_t pageNumber) {
+  DataBlockContainerReference b = pool->getNewDataBlockContainer();
+  if (b == nullptr) {
+    return 1;
+  }
+  uint64_t *data = (uint64_t *)b->getData()->data;
+  size_t n = b->getData()->header.dataSize / sizeof(uint64_t);
+  for (size_t i = 0; i < n; i++) {
+    data[i] = pageNumber + i;
+  }
+  return consumer->pushData(b);
+}
+
+int main(int argc, char **argv) {
+  std::string receiverPath =
+      std::string(dirname(strdup(argv[0]))) + "/receiverMemfd.exe";
+  if (argc > 1) {
+    receiverPath = argv[1];
+  }
+  std::string socketPath =
+      "/tmp/testConsumerMemfd-" + std::to_string(getpid());
+  std::string bankName = "testMemfd";
+  int nErrors = 0;
+
+  // create bank and pool
+  std::shared_ptr<MemoryPagesPool> pool;
+  try {
+    std::shared_ptr<MemoryBank> bank =
+        getMemoryBank(pageSize * numberOfPages * 2, "memfd", bankName);
+    theMemoryBankManager.addBank(bank, bankName);
+    pool = theMemoryBankManager.getPagedPool(pageSize, numberOfPages,
+                                             bankName);
+  } catch (...) {
+  }
+  if (pool == nullptr) {
+    printf("Failed to create memfd bank and pool\n");
+    return -1;
+  }
+
+  // create consumer
+  boost::property_tree::ptree t;
+  t.put("consumer-memfd.socketPath", socketPath);
+  t.put("consumer-memfd.memoryBankName", bankName);
+  t.put("consumer-memfd.maxPagesInFlight", numberOfPages);
+  ConfigFile cfg;
+  cfg.load(t);
+  std::unique_ptr<Consumer> consumer;
+  try {
+    consumer = getUniqueConsumerMemfd(cfg, "consumer-memfd");
+  } catch (const std::string &err) {
+    printf("Failed to create consumer: %s\n", err.c_str());
+  } catch (...) {
+  }
+  if (consumer == nullptr) {
+    return -1;
+  }
+  consumer->start();
+
+  // exchange pages with receiver process, until it disconnects
+  printf("Starting %s\n", receiverPath.c_str());
+  pid_t pid = fork();
+  if (pid == 0) {
+    std::string n = std::to_string(numberOfPagesReceived);
+    execl(receiverPath.c_str(), receiverPath.c_str(), socketPath.c_str(),
+          n.c_str(), (char *)nullptr);
+    _exit(127);
+  }
+  if (pid < 0) {
+    printf("Failed to start receiver\n");
+    return -1;
+  }
+  int status = 0;
+  bool isReceiverDone = false;
+  uint64_t nPushed = 0;
+  auto t0 = std::chrono::steady_clock::now();
+  while (getElapsed(t0) < timeout) {
+    if (waitpid(pid, &status, WNOHANG) == pid) {
+      isReceiverDone = true;
+      break;
+    }
+    // pages pushed before the receiver connects are dropped
+    if (pushPage(pool, consumer, nPushed) == 1) {
+      // all pages in use by receiver
+      usleep(100);
+      continue;
+    }
+    nPushed++;
+  }
+  if (!isReceiverDone) {
+    printf("Receiver timeout\n");
+    kill(pid, SIGKILL);
+    waitpid(pid, &status, 0);
+    nErrors++;
+  } else if ((!WIFEXITED(status)) || (WEXITSTATUS(status) != 0)) {
+    printf("Receiver failed, status %d\n", status);
+    nErrors++;
+  }
+  // pages not released by receiver are released on disconnect
+  if (waitPagesBack(pool)) {
+    nErrors++;
+  }
+  printf("Receiver: %llu pages pushed, %d errors\n",
+         (unsigned long long)nPushed, nErrors);
+
+  // connect a client which does not read its socket
+  struct sockaddr_un addr;
+  bzero(&addr, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  strcpy(addr.sun_path, socketPath.c_str());
+  int fd = socket(AF_UNIX, SOCK_SEQPACKET, 0);
+  if ((fd < 0) || (connect(fd, (struct sockaddr *)&addr, sizeof(addr)))) {
+    printf("Failed to connect to %s\n", socketPath.c_str());
+    return -1;
+  }
+  MemfdProtocol::Message msg;
+  struct iovec iov = {&msg, sizeof(msg)};
+  char control[CMSG_SPACE(sizeof(int))];
+  struct msghdr mh;
+  bzero(&mh, sizeof(mh));
+  mh.msg_iov = &iov;
+  mh.msg_iovlen = 1;
+  mh.msg_control = control;
+  mh.msg_controllen = sizeof(control);
+  struct timeval tv = {(time_t)timeout, 0};
+  setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+  if ((recvmsg(fd, &mh, 0) != sizeof(msg)) ||
+      (msg.type != MemfdProtocol::BankInfo)) {
+    printf("Failed to get bank info\n");
+    return -1;
+  }
+  struct cmsghdr *cm = CMSG_FIRSTHDR(&mh);
+  if (cm != nullptr) {
+    int bankFd;
+    memcpy(&bankFd, CMSG_DATA(cm), sizeof(int));
+    close(bankFd);
+  }
+
+  // push pages until pool is empty, or the client socket is full
+  int nPagesInFlight = 0;
+  t0 = std::chrono::steady_clock::now();
+  while (getElapsed(t0) < timeout) {
+    int err = pushPage(pool, consumer, 0);
+    nPagesInFlight =
+        (int)(pool->getTotalNumberOfPages() - pool->getNumberOfPagesAvailable());
+    if ((err) && (nPagesInFlight > 0)) {
+      break;
+    }
+  }
+  if (nPagesInFlight == 0) {
+    printf("No page sent to client\n");
+    nErrors++;
+  }
+
+  // stop should not wait for client, and release all its pages
+  t0 = std::chrono::steady_clock::now();
+  consumer->stop();
+  double stopTime = getElapsed(t0);
+  if (stopTime > 1.0) {
+    printf("stop() blocked for %.1fs\n", stopTime);
+    nErrors++;
+  }
+  if (pool->getNumberOfPagesAvailable() != pool->getTotalNumberOfPages()) {
+    printf("Pages not released by stop(): %d/%d available\n",
+           (int)pool->getNumberOfPagesAvailable(),
+           (int)pool->getTotalNumberOfPages());
+    nErrors++;
+  }
+  printf("Stalled client: %d pages in flight, stop() in %.3fs\n",
+         nPagesInFlight, stopTime);
+  close(fd);
+
+  consumer = nullptr;
+  pool = nullptr;
+  theMemoryBankManager.reset();
+
+  if (nErrors) {
+    printf("Test failed\n");
+    return -1;
+  }
+  printf("Test successful\n");
+  return 0;
+}
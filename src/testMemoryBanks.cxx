@@ -54,6 +54,48 @@ int main() {
            (int)p->getNumberOfPagesAvailable());
   }
 
+  // check memory is reused when pools are released
+  std::vector<std::shared_ptr<MemoryPagesPool>> pools;
+  for (int j = 0; j < 6; j++) {
+    std::shared_ptr<MemoryPagesPool> p;
+    try {
+      p = bm.getPagedPool(pageSize, poolPages / 5, "malloc:2");
+    } catch (...) {
+    }
+    printf("Pool %d : %s\n", j, (p == nullptr) ? "failed to alloc" : "ok");
+    pools.push_back(p);
+  }
+  if (pools[2] == nullptr) {
+    printf("Pool 2 not available, can not test memory reuse\n");
+    return -1;
+  }
+  void *releasedAddress = pools[2]->getBaseBlockAddress();
+  pools[2] = nullptr;
+  try {
+    pools[2] = bm.getPagedPool(pageSize, poolPages / 5, "malloc:2");
+  } catch (...) {
+  }
+  if (pools[2] == nullptr) {
+    printf("Failed to re-create pool 2\n");
+    return -1;
+  }
+  bool isReused = (pools[2]->getBaseBlockAddress() == releasedAddress);
+  printf("Released pool reused: %s\n", isReused ? "yes" : "no");
+  if (!isReused) {
+    return -1;
+  }
+  pools[1] = nullptr;
+  pools[3] = nullptr;
+  std::vector<MemoryBankManager::bankUsage> usage;
+  bm.getBanksUsage(usage);
+  for (auto &u : usage) {
+    printf("Bank %s: %ld bytes, %ld in use (%ld ranges), %ld free (%ld "
+           "ranges, largest %ld)\n",
+           u.name.c_str(), u.size, u.bytesInUse, u.numberOfRangesInUse,
+           u.bytesFree, u.numberOfFreeRanges, u.largestFreeRange);
+  }
+  pools.clear();
+
   int nTestPages = 5;
   std::shared_ptr<MemoryPagesPool> thePool;
   try {
@@ -0,0 +1,260 @@
+// Copyright CERN and copyright holders of ALICE O2. This software is
+// distributed under the terms of the GNU General Public License v3 (GPL
+// Version 3), copied verbatim in the file "COPYING".
+//
+// See http://alice-o2.web.cern.ch/license for full licensing information.
+//
+// In applying this license CERN does not waive the privileges and immunities
+// granted to it by virtue of its status as an Intergovernmental Organization
+// or submit itself to any jurisdiction.
+
+// test program to benchmark the fifo types of MemoryPagesPool
+// Each thread gets and releases pages in a loop. Consistency is checked by
+// flagging pages in use: a page should never be given twice.
+// The SPSC type is protected by a mutex when used by more than 1 thread,
+// as it was necessary before the MPMC type was available.
+// The MPMC type is tested with and without per-thread cache.
+// Creation of data block containers is also checked to be allocation-free.
+// Page tracking is checked to account pages in each stage.
+// usage: testMemoryPagesPool.exe [maxThreads] [loopsPerThread]
+
+#include "MemoryPagesPool.h"
+
+#include <InfoLogger/InfoLogger.hxx>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <new>
+#include <stdio.h>
+#include <stdlib.h>
+#include <thread>
+#include <vector>
+
+using namespace AliceO2::InfoLogger;
+InfoLogger theLog;
+
+// count heap allocations done by the program
+std::atomic<unsigned long> nAllocations(0);
+void *operator new(size_t sz) {
+  nAllocations++;
+  void *p = malloc(sz);
+  if (p == nullptr) {
+    throw std::bad_alloc();
+  }
+  return p;
+}
+void operator delete(void *p) noexcept { free(p); }
+void operator delete(void *p, size_t) noexcept { free(p); }
+
+const size_t pageSize = 4096;
+const size_t numberOfPages = 1024;
+
+// returns number of errors found
+int runTest(MemoryPagesPool::FifoType fifoType, int nThreads, int nLoops,
+            bool useLock, size_t threadCacheSize = 0) {
+  std::vector<char> block(pageSize * numberOfPages);
+  MemoryPagesPool mp(pageSize, numberOfPages, block.data(), block.size(),
+                     nullptr, 0, fifoType);
+  mp.setThreadCacheSize(threadCacheSize);
+  std::vector<std::atomic<int>> pageInUse(numberOfPages);
+  for (auto &p : pageInUse) {
+    p = 0;
+  }
+  std::atomic<int> nErrors(0);
+  std::mutex lock;
+
+  auto pageIndex = [&](void *p) {
+    return ((char *)p - block.data()) / pageSize;
+  };
+
+  auto worker = [&]() {
+    std::vector<void *> pages;
+    for (int i = 0; i < nLoops; i++) {
+      // get a few pages, and release them
+      for (int j = 0; j < 4; j++) {
+        void *p;
+        if (useLock) {
+          std::unique_lock<std::mutex> l(lock);
+          p = mp.getPage();
+        } else {
+          p = mp.getPage();
+        }
+        if (p == nullptr) {
+          continue;
+        }
+        if (pageInUse[pageIndex(p)].exchange(1) != 0) {
+          nErrors++;
+        }
+        pages.push_back(p);
+      }
+      for (auto p : pages) {
+        if (pageInUse[pageIndex(p)].exchange(0) != 1) {
+          nErrors++;
+        }
+        if (useLock) {
+          std::unique_lock<std::mutex> l(lock);
+          mp.releasePage(p);
+        } else {
+          mp.releasePage(p);
+        }
+      }
+      pages.clear();
+    }
+  };
+
+  auto t0 = std::chrono::steady_clock::now();
+  std::vector<std::thread> threads;
+  for (int i = 0; i < nThreads; i++) {
+    threads.push_back(std::thread(worker));
+  }
+  for (auto &t : threads) {
+    t.join();
+  }
+  double t = std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                           t0)
+                 .count();
+
+  if (mp.getNumberOfPagesAvailable() != mp.getTotalNumberOfPages()) {
+    nErrors++;
+  }
+  double nOps = 2.0 * 4 * nLoops * nThreads;
+  printf("%s%s %2d threads: %8.2f Mops/s, %.0f ns/op, %d errors\n",
+         (fifoType == MemoryPagesPool::MPMC) ? "mpmc" : "spsc",
+         useLock ? "+lock " : (threadCacheSize ? "+cache" : "      "),
+         nThreads, nOps / t / 1000000.0,
+         t * 1000000000.0 / nOps, (int)nErrors);
+  return nErrors;
+}
+
+// create and release data block containers
+// returns number of errors found
+int runTestContainers(int nLoops) {
+  std::vector<char> block(pageSize * numberOfPages);
+  MemoryPagesPool mp(pageSize, numberOfPages, block.data(), block.size());
+  std::vector<DataBlockContainerReference> containers;
+  containers.reserve(8);
+  int nErrors = 0;
+
+  unsigned long nAllocationsBefore = nAllocations;
+  auto t0 = std::chrono::steady_clock::now();
+  for (int i = 0; i < nLoops; i++) {
+    for (int j = 0; j < 8; j++) {
+      auto bc = mp.getNewDataBlockContainer();
+      if (bc == nullptr) {
+        nErrors++;
+        continue;
+      }
+      containers.push_back(bc);
+    }
+    containers.clear();
+  }
+  double t = std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                           t0)
+                 .count();
+  unsigned long nAllocationsUsed = nAllocations - nAllocationsBefore;
+
+  if (mp.getNumberOfPagesAvailable() != mp.getTotalNumberOfPages()) {
+    nErrors++;
+  }
+  if (nAllocationsUsed) {
+    nErrors++;
+  }
+  double nOps = 8.0 * nLoops;
+  printf("containers        : %8.2f Mops/s, %.0f ns/op, %lu heap allocations, "
+         "%d errors\n",
+         nOps / t / 1000000.0, t * 1000000000.0 / nOps, nAllocationsUsed,
+         nErrors);
+  return nErrors;
+}
+
+// get pages, move them through stages, and check tracking statistics
+// returns number of errors found
+int runTestTracking(int nLoops) {
+  std::vector<char> block(pageSize * numberOfPages);
+  MemoryPagesPool mp(pageSize, numberOfPages, block.data(), block.size());
+  mp.enableTracking("test");
+  std::vector<DataBlockContainerReference> containers;
+  int nErrors = 0;
+  const int nPages = 8;
+
+  auto t0 = std::chrono::steady_clock::now();
+  for (int i = 0; i < nLoops; i++) {
+    for (int j = 0; j < nPages; j++) {
+      auto bc = mp.getNewDataBlockContainer();
+      if (bc == nullptr) {
+        nErrors++;
+        continue;
+      }
+      containers.push_back(bc);
+    }
+    for (auto &bc : containers) {
+      MemoryPagesPool::setPageStage(bc->getData(),
+                                    MemoryPagesPool::StageAggregator);
+      MemoryPagesPool::setPageStage(bc->getData(),
+                                    MemoryPagesPool::StageConsumers);
+    }
+    if (i != nLoops - 1) {
+      containers.clear();
+    }
+  }
+  double t = std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                           t0)
+                 .count();
+
+  // last pages kept in use
+  std::vector<MemoryPagesPool::PageStageStats> stats;
+  mp.getTrackingStats(stats);
+  if ((stats.size() != MemoryPagesPool::numberOfPageStages + 1) ||
+      (stats[MemoryPagesPool::StageConsumers].pagesInStage != nPages) ||
+      (stats[MemoryPagesPool::StageConsumers].count !=
+       (uint64_t)nPages * (nLoops - 1)) ||
+      (stats[MemoryPagesPool::StageEquipment].count !=
+       (uint64_t)nPages * nLoops)) {
+    nErrors++;
+  }
+  mp.logTrackingReport(2);
+  containers.clear();
+  mp.getTrackingStats(stats);
+  if ((stats[MemoryPagesPool::numberOfPageStages].pagesInStage != 0) ||
+      (stats[MemoryPagesPool::numberOfPageStages].count !=
+       (uint64_t)nPages * nLoops)) {
+    nErrors++;
+  }
+
+  double nOps = 1.0 * nPages * nLoops;
+  printf("tracking          : %8.2f Mpages/s, %.0f ns/page, %d errors\n",
+         nOps / t / 1000000.0, t * 1000000000.0 / nOps, nErrors);
+  return nErrors;
+}
+
+int main(int argc, char **argv) {
+  int maxThreads = 8;
+  int nLoops = 1000000;
+  if (argc > 1) {
+    maxThreads = atoi(argv[1]);
+  }
+  if (argc > 2) {
+    nLoops = atoi(argv[2]);
+  }
+
+  int nErrors = 0;
+  // single thread, no lock needed
+  nErrors += runTest(MemoryPagesPool::SPSC, 1, nLoops, false);
+  nErrors += runTest(MemoryPagesPool::MPMC, 1, nLoops, false);
+  nErrors += runTest(MemoryPagesPool::MPMC, 1, nLoops, false, 32);
+  // concurrent threads
+  for (int n = 2; n <= maxThreads; n *= 2) {
+    nErrors += runTest(MemoryPagesPool::SPSC, n, nLoops / n, true);
+    nErrors += runTest(MemoryPagesPool::MPMC, n, nLoops / n, false);
+    nErrors += runTest(MemoryPagesPool::MPMC, n, nLoops / n, false, 32);
+  }
+  nErrors += runTestContainers(nLoops);
+  nErrors += runTestTracking(nLoops / 8);
+
+  if (nErrors) {
+    printf("Test failed: %d errors\n", nErrors);
+    return -1;
+  }
+  printf("Test successful\n");
+  return 0;
+}
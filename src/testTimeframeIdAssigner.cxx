@@ -0,0 +1,181 @@
+// Copyright CERN and copyright holders of ALICE O2. This software is
+// distributed under the terms of the GNU General Public License v3 (GPL
+// Version 3), copied verbatim in the file "COPYING".
+//
+// See http://alice-o2.web.cern.ch/license for full licensing information.
+//
+// In applying this license CERN does not waive the privileges and immunities
+// granted to it by virtue of its status as an Intergovernmental Organization
+// or submit itself to any jurisdiction.
+
+// test program to check and benchmark the timeframe id assignment done by
+// equipments on each data page.
+// A set of pages from several links is created, each starting with a RDH,
+// spanning several timeframes. One link starts later than the others, in the
+// middle of a timeframe. Timeframe ids from RDH are checked against the
+// expected values, and the average time to assign a timeframe id is measured
+// for each source and checked against the target.
+// usage: testTimeframeIdAssigner.exe [numberOfLoops]
+
+#include "TimeframeIdAssigner.h"
+
+#include <InfoLogger/InfoLogger.hxx>
+#include <chrono>
+#include <initializer_list>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+
+using namespace AliceO2::InfoLogger;
+InfoLogger theLog;
+
+const int numberOfLinks = 12;
+const int pagesPerOrbit = 3;      // pages per link with same orbit
+const uint32_t firstOrbit = 1000; // orbit of first page
+const uint32_t periodOrbits = 256;
+const int numberOfTimeframes = 5; // timeframes covered by the pages
+const int lateLinkId = numberOfLinks - 1; // link starting after the others
+const uint32_t lateLinkFirstOrbit = firstOrbit + periodOrbits + 100;
+const double maxTimePerPage = 50; // target, in nanoseconds
+
+int main(int argc, char **argv) {
+  int numberOfLoops = 100;
+  if (argc > 1) {
+    numberOfLoops = atoi(argv[1]);
+  }
+
+  // create the pages, round-robin on links, each orbit in sequence
+  // (so that the first orbit of each timeframe is seen by all links)
+  std::vector<DataBlock> blocks;
+  std::vector<o2::Header::RAWDataHeader> rdhs;
+  std::vector<uint64_t> expectedIds;
+  uint32_t numberOfOrbits = numberOfTimeframes * periodOrbits;
+  size_t maxPages = numberOfOrbits * pagesPerOrbit * numberOfLinks;
+  rdhs.reserve(maxPages); // pages point to RDHs, no reallocation allowed
+  for (uint32_t orbit = firstOrbit; orbit < firstOrbit + numberOfOrbits;
+       orbit++) {
+    for (int j = 0; j < pagesPerOrbit; j++) {
+      for (int linkId = 0; linkId < numberOfLinks; linkId++) {
+        if ((linkId == lateLinkId) && (orbit < lateLinkFirstOrbit)) {
+          continue;
+        }
+        o2::Header::RAWDataHeader rdh;
+        rdh.linkId = linkId;
+        rdh.heartbeatOrbit = orbit;
+        rdhs.push_back(rdh);
+        DataBlock b;
+        b.header.dataSize = sizeof(o2::Header::RAWDataHeader);
+        b.data = (char *)&rdhs.back();
+        blocks.push_back(b);
+        expectedIds.push_back(1 + (orbit - firstOrbit) / periodOrbits);
+      }
+    }
+  }
+  int numberOfPages = (int)blocks.size();
+  printf("%d pages, %d links, orbits %u - %u, %d timeframes\n",
+         numberOfPages, numberOfLinks, firstOrbit,
+         firstOrbit + numberOfOrbits - 1, numberOfTimeframes);
+
+  int nErrors = 0;
+  TimeframeIdAssigner tfa;
+  tfa.setPeriod(periodOrbits);
+
+  // check ids from RDH
+  tfa.setSource(TimeframeIdAssigner::FirstRdhInPage);
+  tfa.reset();
+  for (int i = 0; i < numberOfPages; i++) {
+    blocks[i].header.timeframeId = undefinedTimeframeId;
+    if (tfa.assign(&blocks[i])) {
+      nErrors++;
+      continue;
+    }
+    if (blocks[i].header.timeframeId != expectedIds[i]) {
+      printf("Page %d : timeframe %llu, expected %llu\n", i,
+             (unsigned long long)blocks[i].header.timeframeId,
+             (unsigned long long)expectedIds[i]);
+      nErrors++;
+    }
+  }
+  if (tfa.getLastTimeframeId() != (uint64_t)numberOfTimeframes) {
+    printf("Last timeframe %llu, expected %d\n",
+           (unsigned long long)tfa.getLastTimeframeId(), numberOfTimeframes);
+    nErrors++;
+  }
+
+  // check timeframe boundaries, and the late link aligned on other links
+  struct OrbitCheck {
+    uint32_t orbit;
+    uint64_t timeframeId;
+  };
+  for (auto c : std::initializer_list<OrbitCheck>{
+           {firstOrbit - 1, undefinedTimeframeId},
+           {firstOrbit, 1},
+           {firstOrbit + periodOrbits - 1, 1},
+           {firstOrbit + periodOrbits, 2},
+           {lateLinkFirstOrbit, 2},
+           {firstOrbit + 2 * periodOrbits - 1, 2},
+           {firstOrbit + 2 * periodOrbits, 3},
+           {firstOrbit + numberOfOrbits, numberOfTimeframes + 1ULL}}) {
+    uint64_t id = tfa.getTimeframeFromOrbit(c.orbit);
+    if (id != c.timeframeId) {
+      printf("Orbit %u : timeframe %llu, expected %llu\n", c.orbit,
+             (unsigned long long)id, (unsigned long long)c.timeframeId);
+      nErrors++;
+    }
+  }
+  for (int i = 0; i < numberOfPages; i++) {
+    if ((rdhs[i].linkId == lateLinkId) &&
+        (rdhs[i].heartbeatOrbit == lateLinkFirstOrbit)) {
+      if (blocks[i].header.timeframeId != 2) {
+        printf("Late link : first page in timeframe %llu, expected 2\n",
+               (unsigned long long)blocks[i].header.timeframeId);
+        nErrors++;
+      }
+      break;
+    }
+  }
+
+  // check page without RDH is left unchanged
+  DataBlock emptyBlock;
+  emptyBlock.header.dataSize = 0;
+  emptyBlock.header.timeframeId = undefinedTimeframeId;
+  emptyBlock.data = nullptr;
+  if ((tfa.assign(&emptyBlock) == 0) ||
+      (emptyBlock.header.timeframeId != undefinedTimeframeId)) {
+    nErrors++;
+  }
+  printf("Timeframe ids from RDH: %d errors\n", nErrors);
+
+  // benchmark each source
+  for (auto source : {TimeframeIdAssigner::FirstRdhInPage,
+                      TimeframeIdAssigner::SoftwareClock}) {
+    tfa.setSource(source);
+    tfa.reset();
+    auto t0 = std::chrono::steady_clock::now();
+    for (int j = 0; j < numberOfLoops; j++) {
+      for (int i = 0; i < numberOfPages; i++) {
+        tfa.assign(&blocks[i]);
+      }
+      // next loop restarts from first orbit
+      if (source == TimeframeIdAssigner::FirstRdhInPage) {
+        tfa.reset();
+      }
+    }
+    auto t1 = std::chrono::steady_clock::now();
+    double ns = std::chrono::duration<double, std::nano>(t1 - t0).count() /
+                ((double)numberOfLoops * numberOfPages);
+    printf("Source %s: %.1f ns per page %s\n",
+           TimeframeIdAssigner::getSourceName(source), ns,
+           (ns < maxTimePerPage) ? "(ok)" : "(slower than target)");
+    if (ns >= maxTimePerPage) {
+      nErrors++;
+    }
+  }
+
+  if (nErrors) {
+    printf("Test failed\n");
+    return -1;
+  }
+  printf("Test successful\n");
+  return 0;
+}
@@ -0,0 +1,98 @@
+// Copyright CERN and copyright holders of ALICE O2. This software is
+// distributed under the terms of the GNU General Public License v3 (GPL
+// Version 3), copied verbatim in the file "COPYING".
+//
+// See http://alice-o2.web.cern.ch/license for full licensing information.
+//
+// In applying this license CERN does not waive the privileges and immunities
+// granted to it by virtue of its status as an Intergovernmental Organization
+// or submit itself to any jurisdiction.
+
+// test program to check the token bucket used for the byte rate limits of the
+// equipments.
+// The burst cap is checked after an idle period, and the refill rate is
+// measured by consuming items as fast as the bucket allows.
+// usage: testTokenBucket.exe [rate (bytes/s)]
+
+#include "TokenBucket.h"
+
+#include <InfoLogger/InfoLogger.hxx>
+#include <chrono>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <thread>
+
+using namespace AliceO2::InfoLogger;
+InfoLogger theLog;
+
+const uint64_t burstSize = 1024 * 1024;   // bytes
+const uint64_t itemSize = 64 * 1024;      // bytes
+const double measureTime = 0.5;           // seconds
+const double maxRateError = 0.05;         // relative
+
+int main(int argc, char **argv) {
+  double rate = 100 * 1024 * 1024; // bytes per second
+  if (argc > 1) {
+    rate = atof(argv[1]);
+  }
+  int nErrors = 0;
+
+  // check disabled when no rate
+  TokenBucket tb;
+  tb.configure(0, burstSize);
+  if (tb.isEnabled()) {
+    printf("Bucket enabled without rate\n");
+    nErrors++;
+  }
+
+  // check burst cap: after an idle period long enough to refill much more
+  // than the burst size, at most burst size plus one item can be taken
+  tb.configure(rate, burstSize);
+  if (!tb.isEnabled()) {
+    printf("Bucket disabled with rate\n");
+    nErrors++;
+  }
+  tb.reset();
+  std::this_thread::sleep_for(
+      std::chrono::duration<double>(4.0 * burstSize / rate));
+  uint64_t nBurstItems = 0;
+  while (tb.isAvailable()) {
+    tb.consume(itemSize);
+    nBurstItems++;
+  }
+  uint64_t maxBurstItems = (burstSize + itemSize - 1) / itemSize + 1;
+  printf("Burst: %llu items taken after idle period, max %llu\n",
+         (unsigned long long)nBurstItems, (unsigned long long)maxBurstItems);
+  if ((nBurstItems == 0) || (nBurstItems > maxBurstItems)) {
+    nErrors++;
+  }
+
+  // check refill rate: consume items as fast as possible for a while, starting
+  // from an empty bucket
+  uint64_t nBytes = 0;
+  auto t0 = std::chrono::steady_clock::now();
+  double t = 0;
+  while (t < measureTime) {
+    if (tb.isAvailable()) {
+      tb.consume(itemSize);
+      nBytes += itemSize;
+    }
+    t = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0)
+            .count();
+  }
+  double measuredRate = nBytes / t;
+  double rateError = fabs(measuredRate - rate) / rate;
+  printf("Rate: %.3g bytes/s measured, %.3g bytes/s expected (%.1f%%)\n",
+         measuredRate, rate, rateError * 100);
+  if (rateError > maxRateError) {
+    nErrors++;
+  }
+
+  if (nErrors) {
+    printf("Test failed\n");
+    return -1;
+  }
+  printf("Test successful\n");
+  return 0;
+}